@@ -26,6 +26,7 @@
 #include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
+#include <stdio.h>
 
 #if defined(_WIN32) && !defined(SORD_STATIC) && defined(SORD_INTERNAL)
 #  define SORD_API __declspec(dllexport)
@@ -74,6 +75,41 @@ typedef struct SordModelImpl SordModel;
 */
 typedef struct SordInserterImpl SordInserter;
 
+/**
+   External Statement Sorter.
+
+   A sorter writes statements to a sorted and deduplicated stream of N-Triples
+   or N-Quads lines using a bounded amount of memory, by spilling sorted runs
+   to temporary files and merging them.  This is like loading a model and
+   writing it, but works for inputs much larger than memory.
+*/
+typedef struct SordSorterImpl SordSorter;
+
+/**
+   Streaming Statement Deduplicator.
+
+   A deduplicator passes statements through to other sinks, dropping any that
+   were already seen recently.  Only a bounded number of statements are
+   remembered, so duplicates far apart in a large input may be written.
+*/
+typedef struct SordDeduplicatorImpl SordDeduplicator;
+
+/**
+   Compressed Output Stream.
+
+   A compressor is a SerdSink that compresses data and writes it to another
+   sink, for writing compressed output.
+*/
+typedef struct SordCompressorImpl SordCompressor;
+
+/**
+   Buffered Output Stream.
+
+   An output is a SerdSink that writes to a file through a large buffer, with
+   few system calls, and optionally on a separate thread.
+*/
+typedef struct SordOutputImpl SordOutput;
+
 /**
    Model Iterator.
 */
@@ -87,6 +123,15 @@ typedef struct SordIterImpl SordIter;
 */
 typedef struct SordNodeImpl SordNode;
 
+/**
+   Compression format.
+*/
+typedef enum {
+  SORD_COMPRESSION_NONE, ///< Uncompressed
+  SORD_COMPRESSION_GZIP, ///< Gzip (RFC 1952)
+  SORD_COMPRESSION_ZSTD  ///< Zstandard (RFC 8878)
+} SordCompression;
+
 /**
    Quad of nodes (a statement), or a quad pattern.
 
@@ -125,6 +170,15 @@ typedef enum {
   SORD_POS = 1 << 5  /**< Predicate, Object,    Subject */
 } SordIndexOption;
 
+/**
+   Statistics about an index of a model.
+*/
+typedef struct {
+  size_t n_pages; /**< Number of pages */
+  size_t n_bytes; /**< Size of all pages in bytes */
+  double fill;    /**< Fraction of page space that holds quads */
+} SordIndexStats;
+
 /**
    @name World
    @{
@@ -147,6 +201,33 @@ SORD_API
 void
 sord_world_free(SordWorld* world);
 
+/**
+   Set the number of unreferenced nodes to keep for reuse.
+
+   By default, a node is freed as soon as its last reference is dropped.  This
+   is wasteful if the same node is soon created again, for example when a
+   statement is removed then added again.  If a limit is set, then up to
+   `limit` unreferenced nodes are kept, and all of them are freed when there
+   are more.  Since this requires scanning all nodes, the limit should be
+   large enough that this is rare.
+
+   If there are currently more than `limit` unreferenced nodes, they are freed
+   immediately.
+*/
+SORD_API
+void
+sord_world_set_orphan_limit(SordWorld* world, size_t limit);
+
+/**
+   Free all unreferenced nodes kept for reuse.
+
+   @return The number of nodes freed.
+   @see sord_world_set_orphan_limit()
+*/
+SORD_API
+size_t
+sord_world_collect(SordWorld* world);
+
 /**
    Set a function to be called when errors occur.
 
@@ -207,6 +288,77 @@ sord_new_literal(SordWorld*     world,
                  const uint8_t* str,
                  const char*    lang);
 
+/**
+   Get many nodes of the same type from strings.
+
+   This is equivalent to calling sord_new_uri(), sord_new_blank(), or
+   sord_new_literal() for each string, but is faster for large numbers of
+   strings since the hash table lookups are done in batches, so the latency of
+   each cache miss overlaps with the others.
+
+   @param world The world.
+   @param type The type of nodes to create.
+   @param datatype The datatype of literals, or NULL.
+   @param lang The language of literals, or NULL.
+   @param n_strings The number of strings, and the size of `nodes`.
+   @param strings Array of node strings.
+   @param nodes Array set to the resulting nodes, each of which must be freed
+   with sord_node_free(), or NULL on error.
+   @return The number of nodes successfully interned.
+*/
+SORD_API
+size_t
+sord_world_intern_batch(SordWorld*            world,
+                        SordNodeType          type,
+                        const SordNode*       datatype,
+                        const char*           lang,
+                        size_t                n_strings,
+                        const uint8_t* const* strings,
+                        SordNode**            nodes);
+
+/**
+   Find an existing URI node.
+
+   Unlike sord_new_uri(), this never inserts into or otherwise modifies
+   `world`, so it is cheap to use for probing with terms that may not exist,
+   for example to check a user-supplied URI before querying.
+
+   @return A node owned by `world` which must not be freed, or NULL if no such
+   node exists.  The returned node is only valid as long as some other
+   reference to it exists, so it should be copied with sord_node_copy() if
+   it is to be kept.
+*/
+SORD_API
+const SordNode*
+sord_world_find_uri(const SordWorld* world, const uint8_t* uri);
+
+/**
+   Find an existing blank node.
+
+   @return A node owned by `world` which must not be freed, or NULL.
+   @see sord_world_find_uri()
+*/
+SORD_API
+const SordNode*
+sord_world_find_blank(const SordWorld* world, const uint8_t* str);
+
+/**
+   Find an existing literal node.
+
+   @param world The world.
+   @param datatype Datatype of the literal, or NULL.
+   @param str Literal string.
+   @param lang Language tag of the literal, or NULL.
+   @return A node owned by `world` which must not be freed, or NULL.
+   @see sord_world_find_uri()
+*/
+SORD_API
+const SordNode*
+sord_world_find_literal(const SordWorld* world,
+                        const SordNode*  datatype,
+                        const uint8_t*   str,
+                        const char*      lang);
+
 /**
    Copy a node (obtain a reference).
 
@@ -369,6 +521,34 @@ SORD_API
 size_t
 sord_num_quads(const SordModel* model);
 
+/**
+   Return the number of bytes of memory used by the nodes in `world`.
+
+   This includes the node table and the string of every node, but not the
+   indices of any model.
+*/
+SORD_API
+size_t
+sord_num_node_bytes(const SordWorld* world);
+
+/**
+   Get statistics about an index of `model`.
+
+   This visits every page of the index, so takes time linear in its size.
+
+   @param model The model to inspect.
+   @param index A single index option, like SORD_SPO.
+   @param graphs If true, inspect the index of the same ordering with graphs.
+   @param stats Set to the statistics of the index.
+   @return False if `model` does not have the index.
+*/
+SORD_API
+bool
+sord_index_stats(const SordModel* model,
+                 SordIndexOption  index,
+                 bool             graphs,
+                 SordIndexStats*  stats);
+
 /**
    Return an iterator to the start of `model`.
 */
@@ -376,6 +556,21 @@ SORD_API
 SordIter*
 sord_begin(const SordModel* model);
 
+/**
+   Split a model into ranges of quads with different subjects.
+
+   This sets `iters` to at most `n` iterators in the order of sord_begin(),
+   each of which starts at the first quad of a subject.  The range of each
+   iterator ends where the next one starts, and the last ends at the end of
+   the model.  The ranges are roughly equal in size, and cheap to find, since
+   they are chosen by sampling the upper levels of the index.
+
+   @return The number of iterators, which is zero if the model is empty.
+*/
+SORD_API
+size_t
+sord_split(const SordModel* model, size_t n, SordIter** iters);
+
 /**
    Search for statements by a quad pattern.
    @return an iterator to the first match, or NULL if no matches found.
@@ -531,6 +726,301 @@ sord_inserter_write_statement(SordInserter*      inserter,
                               const SerdNode*    object_datatype,
                               const SerdNode*    object_lang);
 
+/**
+   @}
+   @name Sorter
+   @{
+*/
+
+/**
+   Create a sorter for sorting and deduplicating statements.
+
+   @param env The environment used to expand CURIEs and relative URIs.
+   @param syntax The output syntax, SERD_NTRIPLES or SERD_NQUADS.
+   @param max_memory The maximum number of bytes to buffer before writing a
+   sorted run to a temporary file.
+*/
+SORD_API
+SordSorter*
+sord_sorter_new(SerdEnv* env, SerdSyntax syntax, size_t max_memory);
+
+/**
+   Free a sorter and any temporary files.
+*/
+SORD_API
+void
+sord_sorter_free(SordSorter* sorter);
+
+/**
+   Set the directory to write temporary files to.
+
+   By default, temporary files are written to the directory named by the
+   TMPDIR environment variable if it is set, or the system default otherwise.
+   On systems without mkstemp(), the system default is always used.
+
+   @param sorter The sorter to set the directory of.
+   @param path The path of an existing directory, or NULL for the default.
+*/
+SORD_API
+void
+sord_sorter_set_directory(SordSorter* sorter, const char* path);
+
+/**
+   Set the current base URI for writing to the sorter.
+
+   Note this function can be safely casted to SerdBaseSink.
+*/
+SORD_API
+SerdStatus
+sord_sorter_set_base_uri(SordSorter* sorter, const SerdNode* uri);
+
+/**
+   Set a namespace prefix for writing to the sorter.
+
+   Note this function can be safely casted to SerdPrefixSink.
+*/
+SORD_API
+SerdStatus
+sord_sorter_set_prefix(SordSorter*     sorter,
+                       const SerdNode* name,
+                       const SerdNode* uri);
+
+/**
+   Write a statement to the sorter.
+
+   Note this function can be safely casted to SerdStatementSink.
+*/
+SORD_API
+SerdStatus
+sord_sorter_write_statement(SordSorter*        sorter,
+                            SerdStatementFlags flags,
+                            const SerdNode*    graph,
+                            const SerdNode*    subject,
+                            const SerdNode*    predicate,
+                            const SerdNode*    object,
+                            const SerdNode*    object_datatype,
+                            const SerdNode*    object_lang);
+
+/**
+   Write every statement written to the sorter, in order, to a sink.
+
+   Statements are written as lines sorted by byte value, with duplicates
+   removed.  This may only be called once.
+
+   @return SERD_ERR_UNKNOWN if a temporary file could not be written or read.
+*/
+SORD_API
+SerdStatus
+sord_sorter_finish(SordSorter* sorter, SerdSink sink, void* stream);
+
+/**
+   @}
+   @name Deduplicator
+   @{
+*/
+
+/**
+   Create a deduplicator that passes unique statements to other sinks.
+
+   Statements are remembered in a hash table of at most `max_memory` bytes,
+   which is cleared when it is full.  If `exact` is true, the table stores the
+   statements themselves, so only statements that are really duplicates are
+   dropped.  Otherwise, it stores only 64-bit hashes, which remembers many
+   more statements in the same memory, but may rarely drop a unique statement
+   whose hash collides with another.
+
+   Statements with anonymous nodes, which have flags set, are always passed
+   through since they can not be duplicates.
+
+   @param env The environment used to expand CURIEs and relative URIs, which
+   is copied, so changes to it afterwards do not affect the deduplicator.
+   @param max_memory The maximum size of the table in bytes.
+   @param exact If true, never drop a unique statement.
+   @param handle Handle passed to the sinks.
+   @param base_sink Sink for base URI changes, or NULL.
+   @param prefix_sink Sink for namespace definitions, or NULL.
+   @param statement_sink Sink for unique statements.
+   @param end_sink Sink for the end of anonymous nodes, or NULL.
+*/
+SORD_API
+SordDeduplicator*
+sord_deduplicator_new(SerdEnv*          env,
+                      size_t            max_memory,
+                      bool              exact,
+                      void*             handle,
+                      SerdBaseSink      base_sink,
+                      SerdPrefixSink    prefix_sink,
+                      SerdStatementSink statement_sink,
+                      SerdEndSink       end_sink);
+
+/**
+   Free a deduplicator.
+*/
+SORD_API
+void
+sord_deduplicator_free(SordDeduplicator* deduplicator);
+
+/**
+   Set the current base URI, and pass it to the base sink.
+
+   Note this function can be safely casted to SerdBaseSink.
+*/
+SORD_API
+SerdStatus
+sord_deduplicator_set_base_uri(SordDeduplicator* deduplicator,
+                               const SerdNode*   uri);
+
+/**
+   Set a namespace prefix, and pass it to the prefix sink.
+
+   Note this function can be safely casted to SerdPrefixSink.
+*/
+SORD_API
+SerdStatus
+sord_deduplicator_set_prefix(SordDeduplicator* deduplicator,
+                             const SerdNode*   name,
+                             const SerdNode*   uri);
+
+/**
+   Pass a statement to the statement sink if it has not been seen recently.
+
+   Note this function can be safely casted to SerdStatementSink.
+*/
+SORD_API
+SerdStatus
+sord_deduplicator_write_statement(SordDeduplicator*  deduplicator,
+                                  SerdStatementFlags flags,
+                                  const SerdNode*    graph,
+                                  const SerdNode*    subject,
+                                  const SerdNode*    predicate,
+                                  const SerdNode*    object,
+                                  const SerdNode*    object_datatype,
+                                  const SerdNode*    object_lang);
+
+/**
+   Pass the end of an anonymous node to the end sink.
+
+   Note this function can be safely casted to SerdEndSink.
+*/
+SORD_API
+SerdStatus
+sord_deduplicator_end_anon(SordDeduplicator* deduplicator,
+                           const SerdNode*   node);
+
+/**
+   Return the number of statements dropped as duplicates.
+*/
+SORD_API
+size_t
+sord_deduplicator_num_dropped(const SordDeduplicator* deduplicator);
+
+/**
+   @}
+   @name Compression
+   @{
+*/
+
+/**
+   Return true if this build of sord supports `compression`.
+
+   Compressed input is detected automatically when reading a file with
+   sord_reader_read_file() or the functions that use it.  Compressed input in
+   an unsupported format is an error.
+*/
+SORD_API
+bool
+sord_compression_supported(SordCompression compression);
+
+/**
+   Create a compressor that writes compressed data to `sink`.
+
+   @return A new compressor, or NULL if `compression` is not supported.
+*/
+SORD_API
+SordCompressor*
+sord_compressor_new(SordCompression compression, SerdSink sink, void* stream);
+
+/**
+   Free a compressor, without finishing the compressed stream.
+*/
+SORD_API
+void
+sord_compressor_free(SordCompressor* compressor);
+
+/**
+   Compress data and write it to the compressor's sink.
+
+   Data is buffered, so output may not be written until a later call or
+   sord_compressor_finish().  Note this function can be safely casted to
+   SerdSink, with the compressor as the stream.
+
+   @return `len` on success, or zero if output could not be written.
+*/
+SORD_API
+size_t
+sord_compressor_write(const void* buf, size_t len, SordCompressor* compressor);
+
+/**
+   Write any buffered data and finish the compressed stream.
+
+   @return SERD_ERR_UNKNOWN if compression or writing output failed.
+*/
+SORD_API
+SerdStatus
+sord_compressor_finish(SordCompressor* compressor);
+
+/**
+   @}
+   @name Output
+   @{
+*/
+
+/**
+   Create an output that writes to `file`.
+
+   Output is written in large pieces, with a single system call for several
+   pieces where possible, rather than through the stdio buffer of `file`.
+   Anything already written to `file` is flushed first, and nothing else may
+   be written to `file` until the output is flushed.
+
+   @param file The file to write to.
+   @param buffer_size The size of the buffer in bytes, or zero for 4 MiB.
+   @param threaded If true, write full parts of the buffer on a separate
+   thread, so writing overlaps with producing output.
+*/
+SORD_API
+SordOutput*
+sord_output_new(FILE* file, size_t buffer_size, bool threaded);
+
+/**
+   Free an output, without writing any buffered data.
+*/
+SORD_API
+void
+sord_output_free(SordOutput* output);
+
+/**
+   Write data to an output.
+
+   Data is buffered, so output may not be written until a later call or
+   sord_output_flush().  Note this function can be safely casted to SerdSink,
+   with the output as the stream.
+
+   @return `len` on success, or zero if output could not be written.
+*/
+SORD_API
+size_t
+sord_output_write(const void* buf, size_t len, SordOutput* output);
+
+/**
+   Write any buffered data and wait until it is written.
+
+   @return SERD_ERR_UNKNOWN if writing output failed.
+*/
+SORD_API
+SerdStatus
+sord_output_flush(SordOutput* output);
+
 /**
    @}
    @name Iteration
@@ -614,8 +1104,112 @@ sord_new_reader(SordModel* model,
                 SerdSyntax syntax,
                 SordNode*  graph);
 
+/**
+   Read a file handle with `reader`, mapping it into memory if possible.
+
+   If `file` is a regular file at its start, it is mapped into memory and read
+   directly from there, which avoids copying through stdio buffers.  Otherwise,
+   this is equivalent to serd_reader_read_file_handle().
+
+   Gzip or zstd compressed input is detected and decompressed while reading,
+   if supported (see sord_compression_supported()).
+
+   @param reader The reader to read with.
+   @param file The file to read from.
+   @param name The name of the file for error messages.
+*/
+SORD_API
+SerdStatus
+sord_reader_read_file_handle(SerdReader*    reader,
+                             FILE*          file,
+                             const uint8_t* name);
+
+/**
+   Read a file with `reader`, mapping it into memory if possible.
+
+   This is like serd_reader_read_file(), but uses
+   sord_reader_read_file_handle() to read the file.
+
+   @param reader The reader to read with.
+   @param uri The path or file URI of the file to read.
+*/
+SORD_API
+SerdStatus
+sord_reader_read_file(SerdReader* reader, const uint8_t* uri);
+
+/**
+   Read a file into `model`, possibly in parallel.
+
+   N-Triples and N-Quads files are split into chunks at line boundaries, which
+   are parsed by up to `n_threads` threads at once.  Other syntaxes, or files
+   that can not be mapped into memory, are parsed on a single separate thread
+   while statements are inserted.  In either case, the parsed statements are
+   inserted into the model on the calling thread, in the same order as the
+   file.  If `n_threads` is 1, the file is read in the usual way on the calling
+   thread.
+
+   Errors in the input are reported in order, with line numbers in the whole
+   file, and nothing after the first error is inserted, as when reading
+   serially.
+
+   @param model The model to read statements into.
+   @param env The environment which holds the base URI to resolve against.
+   @param syntax The syntax of the file.
+   @param uri The path or file URI of the file to read.
+   @param graph The graph to add statements to, or NULL.
+   @param n_threads The maximum number of threads to parse with, or zero to
+   use one per processor.
+*/
+SORD_API
+SerdStatus
+sord_read_file(SordModel*     model,
+               SerdEnv*       env,
+               SerdSyntax     syntax,
+               const uint8_t* uri,
+               SordNode*      graph,
+               unsigned       n_threads);
+
+/**
+   Read several files into `model`, possibly in parallel.
+
+   Each file is parsed on one of up to `n_threads` threads, into a buffer
+   which is inserted into the model on the calling thread.  Statements are
+   inserted in the order of `uris`, so the result is the same regardless of
+   the number of threads.
+
+   Every file is read as a separate document, with its own environment whose
+   base URI is the URI of the file, so prefixes defined in one file do not
+   apply to others.  Blank nodes are given a prefix unique to each file, so
+   blank nodes from different files are always distinct.
+
+   @param model The model to read statements into.
+   @param syntax The syntax of the files.
+   @param n_files The number of files to read.
+   @param uris The absolute paths or file URIs of the files to read.
+   @param graph The graph to add statements to, or NULL.
+   @param n_threads The maximum number of threads to parse with, or zero to
+   use one per processor.
+   @param statuses Array of `n_files` statuses to set to the result of reading
+   each file, or NULL.
+   @return The first error from reading any file, or SERD_SUCCESS.
+*/
+SORD_API
+SerdStatus
+sord_read_files(SordModel*            model,
+                SerdSyntax            syntax,
+                size_t                n_files,
+                const uint8_t* const* uris,
+                SordNode*             graph,
+                unsigned              n_threads,
+                SerdStatus*           statuses);
+
 /**
    Write a model to a writer.
+
+   Statements are written in subject, predicate, object order, so a Turtle or
+   TriG writer abbreviates consecutive statements with the same subject and
+   predicate with `;` and `,` as they are written.  Blank nodes that are only
+   used as an object once are written inline.
 */
 SORD_API
 bool
@@ -630,6 +1224,68 @@ SORD_API
 bool
 sord_write_iter(SordIter* iter, SerdWriter* writer);
 
+/**
+   Write a range as N-Triples or N-Quads lines.
+
+   This writes the same statements as sord_write_iter() with a writer for
+   `syntax` in ASCII style, except graphs are written for N-Quads.  Statements
+   are written in the order of `iter`, so in SPO order for sord_begin(), while
+   sord_write_iter() writes statements about inline blank nodes after the
+   statement that uses them.  Rather than building a statement for a writer,
+   lines are written directly from the nodes in the model into a large buffer,
+   which is much faster for large models.
+
+   This increments `iter` to its end, then frees it.
+
+   @param iter The range to write.
+   @param syntax The output syntax, SERD_NTRIPLES or SERD_NQUADS.
+   @param sink Sink for output.
+   @param stream Stream passed to `sink`.
+   @return SERD_ERR_BAD_ARG if `syntax` is not line-based, or
+   SERD_ERR_UNKNOWN if output could not be written.
+*/
+SORD_API
+SerdStatus
+sord_write_lines(SordIter*  iter,
+                 SerdSyntax syntax,
+                 SerdSink   sink,
+                 void*      stream);
+
+/**
+   Write a model on several threads.
+
+   The model is split into ranges of subjects, which are written by up to
+   `n_threads` threads at once into separate buffers, then passed to `sink`
+   in order on the calling thread.  Only a few ranges are buffered at once,
+   so memory use does not depend on the size of the model.
+
+   For N-Triples and N-Quads, the output is the same as sord_write_lines()
+   with sord_begin(), so statements are written in SPO order.  For other
+   syntaxes, the prefixes in `env` are written first, then each range is
+   written by a separate writer, so abbreviation does not cross range
+   boundaries, but every subject is written in full by one writer.
+
+   @param model The model to write.
+   @param env Environment with the base URI and prefixes to write with.
+   @param syntax The output syntax.
+   @param style The style for syntaxes other than N-Triples and N-Quads.
+   @param n_threads The maximum number of threads to write with, or zero to
+   use one per processor.  If this is 1, the model is written on the calling
+   thread without buffering.
+   @param sink Sink for output.
+   @param stream Stream passed to `sink`.
+   @return SERD_ERR_UNKNOWN if output could not be written.
+*/
+SORD_API
+SerdStatus
+sord_write_parallel(SordModel* model,
+                    SerdEnv*   env,
+                    SerdSyntax syntax,
+                    SerdStyle  style,
+                    unsigned   n_threads,
+                    SerdSink   sink,
+                    void*      stream);
+
 /**
    @}
    @}
@@ -598,7 +598,7 @@ Model::load_file(SerdEnv*           env,
 
   // FIXME: blank prefix parameter?
   SerdReader* reader = sord_new_reader(_c_obj, env, syntax, nullptr);
-  serd_reader_read_file(reader, path);
+  sord_reader_read_file(reader, path);
   serd_reader_free(reader);
   serd_free(path);
 }
@@ -629,8 +629,14 @@ Model::write_to_file(const std::string& uri, SerdSyntax syntax, SerdStyle style)
     return SERD_ERR_BAD_ARG;
   }
 
-  SerdWriter* writer = serd_writer_new(
-    syntax, style, _world.prefixes().c_obj(), &base_uri, serd_file_sink, fd);
+  SordOutput* const output = sord_output_new(fd, 0u, false);
+  SerdWriter*       writer =
+    serd_writer_new(syntax,
+                    style,
+                    _world.prefixes().c_obj(),
+                    &base_uri,
+                    reinterpret_cast<SerdSink>(sord_output_write),
+                    output);
 
   serd_env_foreach(_world.prefixes().c_obj(),
                    reinterpret_cast<SerdPrefixSink>(serd_writer_set_prefix),
@@ -638,7 +644,13 @@ Model::write_to_file(const std::string& uri, SerdSyntax syntax, SerdStyle style)
 
   sord_write(_c_obj, writer, nullptr);
   serd_writer_free(writer);
-  fclose(fd);
+
+  const SerdStatus st = sord_output_flush(output);
+  sord_output_free(output);
+  if (fclose(fd) || st) {
+    fprintf(stderr, "Failed to write file <%s>\n", uri.c_str());
+    return SERD_ERR_UNKNOWN;
+  }
 
   return SERD_SUCCESS;
 }
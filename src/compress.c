@@ -0,0 +1,526 @@
+/*
+  Copyright 2021 David Robillard <d@drobilla.net>
+
+  Permission to use, copy, modify, and/or distribute this software for any
+  purpose with or without fee is hereby granted, provided that the above
+  copyright notice and this permission notice appear in all copies.
+
+  THIS SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+
+#include "compress.h"
+
+#include "sord_config.h" // IWYU pragma: keep
+
+#include "serd/serd.h"
+#include "sord/sord.h"
+
+#if USE_ZLIB
+#  include <zlib.h>
+#endif
+
+#if USE_ZSTD
+#  include <zstd.h>
+#endif
+
+#if USE_PTHREAD
+#  include <pthread.h>
+#endif
+
+#include <limits.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+/// Size of compressed data read or written at once
+#define SORD_COMPRESS_BUF_SIZE (1u << 20u)
+
+/// Size of blocks decompressed ahead of reading
+#define SORD_DECOMPRESS_BLOCK_SIZE (256u << 10u)
+
+/// Number of blocks decompressed ahead of reading
+#define SORD_DECOMPRESS_N_BLOCKS 4u
+
+struct SordDecompressorImpl {
+  SordCompression     compression; ///< Input compression
+  SerdSource          read;        ///< Source of compressed input
+  SerdStreamErrorFunc error;       ///< Error function for compressed input
+  void*               stream;      ///< Compressed input stream
+  uint8_t*            in;          ///< Compressed input buffer
+  size_t              in_len;      ///< Length of input in `in`
+  size_t              in_offset;   ///< Offset of the next input byte
+  bool                pending;     ///< True if a frame is unfinished
+  bool                failed;      ///< True if input is invalid or truncated
+#if USE_ZLIB
+  z_stream zlib;
+#endif
+#if USE_ZSTD
+  ZSTD_DStream* zstd;
+#endif
+#if USE_PTHREAD
+  pthread_t       thread;     ///< Thread that decompresses blocks
+  uint8_t*        blocks;     ///< Ring of decompressed blocks
+  size_t          lens[SORD_DECOMPRESS_N_BLOCKS]; ///< Length of each block
+  size_t          n_filled;   ///< Number of blocks decompressed
+  size_t          n_drained;  ///< Number of blocks read
+  size_t          offset;     ///< Offset of the next byte in current block
+  bool            threaded;   ///< True if the thread is running
+  bool            finished;   ///< True once the thread is finished
+  bool            stopped;    ///< True if the thread should stop early
+  pthread_mutex_t mutex;      ///< Protects the counters and flags above
+  pthread_cond_t  cond;       ///< Signalled when a block is passed along
+#endif
+};
+
+struct SordCompressorImpl {
+  SordCompression compression; ///< Output compression
+  SerdSink        sink;        ///< Sink for compressed output
+  void*           stream;      ///< Compressed output stream
+  uint8_t*        in;          ///< Buffer of uncompressed data
+  size_t          in_len;      ///< Length of data in `in`
+  uint8_t*        out;         ///< Buffer for compressed data
+  bool            failed;      ///< True if compression or writing failed
+#if USE_ZLIB
+  z_stream zlib;
+#endif
+#if USE_ZSTD
+  ZSTD_CStream* zstd;
+#endif
+};
+
+bool
+sord_compression_supported(SordCompression compression)
+{
+  switch (compression) {
+  case SORD_COMPRESSION_NONE:
+    return true;
+  case SORD_COMPRESSION_GZIP:
+    return USE_ZLIB;
+  case SORD_COMPRESSION_ZSTD:
+    return USE_ZSTD;
+  }
+
+  return false;
+}
+
+SordCompression
+sord_detect_compression(const uint8_t* head, size_t len)
+{
+  static const uint8_t gzip_magic[] = {0x1F, 0x8B};
+  static const uint8_t zstd_magic[] = {0x28, 0xB5, 0x2F, 0xFD};
+
+  if (len >= sizeof(gzip_magic) && !memcmp(head, gzip_magic, 2)) {
+    return SORD_COMPRESSION_GZIP;
+  }
+
+  if (len >= sizeof(zstd_magic) && !memcmp(head, zstd_magic, 4)) {
+    return SORD_COMPRESSION_ZSTD;
+  }
+
+  return SORD_COMPRESSION_NONE;
+}
+
+/**
+   Decompress up to `size` bytes into `out`.
+
+   @return The number of bytes decompressed, which is only less than `size` at
+   the end of input or on error.
+*/
+static size_t
+sord_decompressor_inflate(SordDecompressor* const dec,
+                          uint8_t* const          out,
+                          const size_t            size)
+{
+#if !USE_ZLIB && !USE_ZSTD
+  (void)out; // Unreachable, since there is no supported compression
+#endif
+
+  size_t n = 0u;
+  while (n < size && !dec->failed) {
+    if (dec->in_offset == dec->in_len) {
+      dec->in_len = dec->read(dec->in, 1, SORD_COMPRESS_BUF_SIZE, dec->stream);
+      dec->in_offset = 0u;
+      if (!dec->in_len) {
+        dec->failed = dec->pending; // Truncated input
+        break;
+      }
+    }
+
+#if USE_ZLIB
+    if (dec->compression == SORD_COMPRESSION_GZIP) {
+      z_stream* const zs = &dec->zlib;
+      zs->next_in        = dec->in + dec->in_offset;
+      zs->avail_in       = (uInt)(dec->in_len - dec->in_offset);
+      zs->next_out       = out + n;
+      zs->avail_out      = (uInt)(size - n);
+
+      const int r    = inflate(zs, Z_NO_FLUSH);
+      dec->in_offset = dec->in_len - zs->avail_in;
+      n              = size - zs->avail_out;
+      dec->pending   = r != Z_STREAM_END;
+      if (r == Z_STREAM_END) {
+        inflateReset(zs); // Continue with the next member, if any
+      } else if (r != Z_OK && r != Z_BUF_ERROR) {
+        dec->failed = true;
+      }
+    }
+#endif
+
+#if USE_ZSTD
+    if (dec->compression == SORD_COMPRESSION_ZSTD) {
+      ZSTD_inBuffer  in   = {dec->in, dec->in_len, dec->in_offset};
+      ZSTD_outBuffer zout = {out, size, n};
+
+      const size_t r = ZSTD_decompressStream(dec->zstd, &zout, &in);
+      dec->in_offset = in.pos;
+      n              = zout.pos;
+      dec->pending   = r != 0u;
+      dec->failed    = ZSTD_isError(r);
+    }
+#endif
+  }
+
+  return n;
+}
+
+#if USE_PTHREAD
+
+static void*
+sord_decompressor_run(void* data)
+{
+  SordDecompressor* const dec = (SordDecompressor*)data;
+
+  pthread_mutex_lock(&dec->mutex);
+  while (!dec->stopped) {
+    if (dec->n_filled - dec->n_drained == SORD_DECOMPRESS_N_BLOCKS) {
+      pthread_cond_wait(&dec->cond, &dec->mutex);
+      continue;
+    }
+
+    const size_t i = dec->n_filled % SORD_DECOMPRESS_N_BLOCKS;
+    pthread_mutex_unlock(&dec->mutex);
+
+    const size_t len = sord_decompressor_inflate(
+      dec, dec->blocks + i * SORD_DECOMPRESS_BLOCK_SIZE,
+      SORD_DECOMPRESS_BLOCK_SIZE);
+
+    pthread_mutex_lock(&dec->mutex);
+    dec->lens[i] = len;
+    ++dec->n_filled;
+    pthread_cond_broadcast(&dec->cond);
+    if (!len) {
+      break; // An empty block marks the end
+    }
+  }
+
+  dec->finished = true;
+  pthread_cond_broadcast(&dec->cond);
+  pthread_mutex_unlock(&dec->mutex);
+  return NULL;
+}
+
+#endif
+
+SordDecompressor*
+sord_decompressor_new(SordCompression     compression,
+                      SerdSource          read,
+                      SerdStreamErrorFunc error,
+                      void*               stream)
+{
+  if (compression == SORD_COMPRESSION_NONE ||
+      !sord_compression_supported(compression)) {
+    return NULL;
+  }
+
+  SordDecompressor* const dec =
+    (SordDecompressor*)calloc(1, sizeof(SordDecompressor));
+
+  dec->compression = compression;
+  dec->read        = read;
+  dec->error       = error;
+  dec->stream      = stream;
+  dec->in          = (uint8_t*)malloc(SORD_COMPRESS_BUF_SIZE);
+
+#if USE_ZLIB
+  if (compression == SORD_COMPRESSION_GZIP &&
+      inflateInit2(&dec->zlib, 15 + 16) != Z_OK) { // 16: gzip header
+    free(dec->in);
+    free(dec);
+    return NULL;
+  }
+#endif
+
+#if USE_ZSTD
+  if (compression == SORD_COMPRESSION_ZSTD) {
+    dec->zstd = ZSTD_createDStream();
+    ZSTD_initDStream(dec->zstd);
+  }
+#endif
+
+#if USE_PTHREAD
+  dec->blocks = (uint8_t*)malloc(SORD_DECOMPRESS_N_BLOCKS *
+                                 SORD_DECOMPRESS_BLOCK_SIZE);
+
+  pthread_mutex_init(&dec->mutex, NULL);
+  pthread_cond_init(&dec->cond, NULL);
+  dec->threaded =
+    !pthread_create(&dec->thread, NULL, sord_decompressor_run, dec);
+#endif
+
+  return dec;
+}
+
+void
+sord_decompressor_free(SordDecompressor* decompressor)
+{
+  SordDecompressor* const dec = decompressor;
+  if (!dec) {
+    return;
+  }
+
+#if USE_PTHREAD
+  if (dec->threaded) {
+    pthread_mutex_lock(&dec->mutex);
+    dec->stopped = true;
+    pthread_cond_broadcast(&dec->cond);
+    pthread_mutex_unlock(&dec->mutex);
+    pthread_join(dec->thread, NULL);
+  }
+
+  pthread_cond_destroy(&dec->cond);
+  pthread_mutex_destroy(&dec->mutex);
+  free(dec->blocks);
+#endif
+
+#if USE_ZLIB
+  if (dec->compression == SORD_COMPRESSION_GZIP) {
+    inflateEnd(&dec->zlib);
+  }
+#endif
+
+#if USE_ZSTD
+  ZSTD_freeDStream(dec->zstd);
+#endif
+
+  free(dec->in);
+  free(dec);
+}
+
+size_t
+sord_decompressor_read(void* buf, size_t size, size_t nmemb, void* stream)
+{
+  SordDecompressor* const dec = (SordDecompressor*)stream;
+  const size_t            len = size * nmemb;
+
+#if USE_PTHREAD
+  if (dec->threaded) {
+    size_t n = 0u;
+    while (n < len) {
+      pthread_mutex_lock(&dec->mutex);
+      while (dec->n_drained == dec->n_filled && !dec->finished) {
+        pthread_cond_wait(&dec->cond, &dec->mutex);
+      }
+      const bool empty = dec->n_drained == dec->n_filled;
+      pthread_mutex_unlock(&dec->mutex);
+      if (empty) {
+        break;
+      }
+
+      const size_t   i     = dec->n_drained % SORD_DECOMPRESS_N_BLOCKS;
+      const uint8_t* block = dec->blocks + i * SORD_DECOMPRESS_BLOCK_SIZE;
+      const size_t   avail = dec->lens[i] - dec->offset;
+      const size_t   count = (len - n < avail) ? len - n : avail;
+
+      memcpy((uint8_t*)buf + n, block + dec->offset, count);
+      n += count;
+      dec->offset += count;
+      if (dec->offset == dec->lens[i]) {
+        pthread_mutex_lock(&dec->mutex);
+        ++dec->n_drained;
+        dec->offset = 0u;
+        pthread_cond_broadcast(&dec->cond);
+        pthread_mutex_unlock(&dec->mutex);
+      }
+    }
+
+    return n / size;
+  }
+#endif
+
+  return sord_decompressor_inflate(dec, (uint8_t*)buf, len) / size;
+}
+
+int
+sord_decompressor_error(void* stream)
+{
+  SordDecompressor* const dec = (SordDecompressor*)stream;
+
+  return dec->failed || dec->error(dec->stream);
+}
+
+/// Write the compressed output buffer to the sink
+static void
+sord_compressor_flush(SordCompressor* const compressor, const size_t len)
+{
+  if (len &&
+      compressor->sink(compressor->out, len, compressor->stream) != len) {
+    compressor->failed = true;
+  }
+}
+
+/**
+   Compress the input buffer.
+
+   @param finish If true, finish the compressed stream.
+*/
+static void
+sord_compressor_compress(SordCompressor* const compressor, const bool finish)
+{
+#if !USE_ZLIB && !USE_ZSTD
+  (void)finish; // Unreachable, since there is no supported compression
+#endif
+
+#if USE_ZLIB
+  if (compressor->compression == SORD_COMPRESSION_GZIP) {
+    z_stream* const zs = &compressor->zlib;
+    zs->next_in        = compressor->in;
+    zs->avail_in       = (uInt)compressor->in_len;
+
+    // Deflate until there is space left in the output, so all is consumed
+    int r = Z_OK;
+    do {
+      zs->next_out  = compressor->out;
+      zs->avail_out = SORD_COMPRESS_BUF_SIZE;
+      r             = deflate(zs, finish ? Z_FINISH : Z_NO_FLUSH);
+      sord_compressor_flush(compressor,
+                            SORD_COMPRESS_BUF_SIZE - zs->avail_out);
+    } while (!compressor->failed && r != Z_STREAM_ERROR && !zs->avail_out);
+
+    if (r == Z_STREAM_ERROR || (finish && r != Z_STREAM_END)) {
+      compressor->failed = true;
+    }
+  }
+#endif
+
+#if USE_ZSTD
+  if (compressor->compression == SORD_COMPRESSION_ZSTD) {
+    ZSTD_inBuffer in = {compressor->in, compressor->in_len, 0u};
+
+    size_t remaining = 0u;
+    do {
+      ZSTD_outBuffer out = {compressor->out, SORD_COMPRESS_BUF_SIZE, 0u};
+
+      remaining = ZSTD_compressStream2(
+        compressor->zstd, &out, &in, finish ? ZSTD_e_end : ZSTD_e_continue);
+
+      if (ZSTD_isError(remaining)) {
+        compressor->failed = true;
+      }
+      sord_compressor_flush(compressor, out.pos);
+    } while (!compressor->failed &&
+             (in.pos < in.size || (finish && remaining)));
+  }
+#endif
+
+  compressor->in_len = 0u;
+}
+
+SordCompressor*
+sord_compressor_new(SordCompression compression, SerdSink sink, void* stream)
+{
+  if (compression == SORD_COMPRESSION_NONE ||
+      !sord_compression_supported(compression)) {
+    return NULL;
+  }
+
+  SordCompressor* const compressor =
+    (SordCompressor*)calloc(1, sizeof(SordCompressor));
+
+  compressor->compression = compression;
+  compressor->sink        = sink;
+  compressor->stream      = stream;
+  compressor->in          = (uint8_t*)malloc(SORD_COMPRESS_BUF_SIZE);
+  compressor->out         = (uint8_t*)malloc(SORD_COMPRESS_BUF_SIZE);
+
+#if USE_ZLIB
+  if (compression == SORD_COMPRESSION_GZIP &&
+      deflateInit2(&compressor->zlib,
+                   Z_DEFAULT_COMPRESSION,
+                   Z_DEFLATED,
+                   15 + 16, // 16: gzip header
+                   8,
+                   Z_DEFAULT_STRATEGY) != Z_OK) {
+    compressor->failed = true;
+  }
+#endif
+
+#if USE_ZSTD
+  if (compression == SORD_COMPRESSION_ZSTD) {
+    compressor->zstd = ZSTD_createCStream();
+  }
+#endif
+
+  return compressor;
+}
+
+void
+sord_compressor_free(SordCompressor* compressor)
+{
+  if (!compressor) {
+    return;
+  }
+
+#if USE_ZLIB
+  if (compressor->compression == SORD_COMPRESSION_GZIP) {
+    deflateEnd(&compressor->zlib);
+  }
+#endif
+
+#if USE_ZSTD
+  ZSTD_freeCStream(compressor->zstd);
+#endif
+
+  free(compressor->out);
+  free(compressor->in);
+  free(compressor);
+}
+
+size_t
+sord_compressor_write(const void* buf, size_t len, SordCompressor* compressor)
+{
+  const uint8_t* ptr       = (const uint8_t*)buf;
+  size_t         remaining = len;
+  while (remaining && !compressor->failed) {
+    const size_t space = SORD_COMPRESS_BUF_SIZE - compressor->in_len;
+    const size_t n     = (remaining < space) ? remaining : space;
+
+    memcpy(compressor->in + compressor->in_len, ptr, n);
+    compressor->in_len += n;
+    ptr += n;
+    remaining -= n;
+
+    if (compressor->in_len == SORD_COMPRESS_BUF_SIZE) {
+      sord_compressor_compress(compressor, false);
+    }
+  }
+
+  return compressor->failed ? 0u : len;
+}
+
+SerdStatus
+sord_compressor_finish(SordCompressor* compressor)
+{
+  if (!compressor->failed) {
+    sord_compressor_compress(compressor, true);
+  }
+
+  return compressor->failed ? SERD_ERR_UNKNOWN : SERD_SUCCESS;
+}
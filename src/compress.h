@@ -0,0 +1,69 @@
+/*
+  Copyright 2021 David Robillard <d@drobilla.net>
+
+  Permission to use, copy, modify, and/or distribute this software for any
+  purpose with or without fee is hereby granted, provided that the above
+  copyright notice and this permission notice appear in all copies.
+
+  THIS SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+
+#ifndef SORD_COMPRESS_H
+#define SORD_COMPRESS_H
+
+#include "serd/serd.h"
+#include "sord/sord.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+/// Number of leading bytes needed to detect compression
+#define SORD_COMPRESSION_MAGIC_SIZE 4u
+
+/**
+   A source that decompresses another source.
+
+   When threads are available, decompression runs on a separate thread ahead
+   of reading, so it overlaps with parsing.
+*/
+typedef struct SordDecompressorImpl SordDecompressor;
+
+/**
+   Return the compression of data that starts with `head`.
+
+   @param head The first bytes of the data.
+   @param len The length of `head`, which need not be more than
+   SORD_COMPRESSION_MAGIC_SIZE.
+*/
+SordCompression
+sord_detect_compression(const uint8_t* head, size_t len);
+
+/**
+   Create a decompressor that reads compressed data from a source.
+
+   @return A new decompressor, or NULL if `compression` is not supported.
+*/
+SordDecompressor*
+sord_decompressor_new(SordCompression     compression,
+                      SerdSource          read,
+                      SerdStreamErrorFunc error,
+                      void*               stream);
+
+void
+sord_decompressor_free(SordDecompressor* decompressor);
+
+/// Read decompressed data, compatible with SerdSource
+size_t
+sord_decompressor_read(void* buf, size_t size, size_t nmemb, void* stream);
+
+/// Return non-zero if reading failed, compatible with SerdStreamErrorFunc
+int
+sord_decompressor_error(void* stream);
+
+#endif /* SORD_COMPRESS_H */
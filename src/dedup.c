@@ -0,0 +1,284 @@
+/*
+  Copyright 2021 David Robillard <d@drobilla.net>
+
+  Permission to use, copy, modify, and/or distribute this software for any
+  purpose with or without fee is hereby granted, provided that the above
+  copyright notice and this permission notice appear in all copies.
+
+  THIS SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+
+#include "serd/serd.h"
+#include "sord/sord.h"
+#include "zix/digest.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+/// Minimum size of the table of seen statements
+#define SORD_DEDUP_MIN_MEMORY (64u << 10u)
+
+struct SordDeduplicatorImpl {
+  SerdEnv*          env;            ///< Environment of writer
+  SerdWriter*       writer;         ///< Writer that writes keys to key
+  uint8_t*          key;            ///< N-Quads line of the current statement
+  size_t            key_len;        ///< Length of key in bytes
+  size_t            key_size;       ///< Allocated size of key in bytes
+  uint64_t*         hashes;         ///< Hash of each entry, or zero if empty
+  size_t*           offsets;        ///< Offset of each entry's key, if exact
+  size_t            mask;           ///< Number of table slots minus one
+  size_t            n_entries;      ///< Number of occupied slots
+  size_t            max_entries;    ///< Number of entries before clearing
+  uint8_t*          keys;           ///< Sized keys of entries, if exact
+  size_t            keys_len;       ///< Length of keys in bytes
+  size_t            keys_size;      ///< Allocated size of keys in bytes
+  size_t            n_dropped;      ///< Number of duplicates dropped
+  void*             handle;         ///< Handle for sinks
+  SerdBaseSink      base_sink;      ///< Sink for base URI changes
+  SerdPrefixSink    prefix_sink;    ///< Sink for namespace definitions
+  SerdStatementSink statement_sink; ///< Sink for unique statements
+  SerdEndSink       end_sink;       ///< Sink for the end of anonymous nodes
+};
+
+/// Append writer output to the current key, compatible with SerdSink
+static size_t
+sord_deduplicator_sink(const void* buf, size_t len, void* stream)
+{
+  SordDeduplicator* const dedup = (SordDeduplicator*)stream;
+  if (dedup->key_len + len > dedup->key_size) {
+    dedup->key_size = (dedup->key_len + len) * 2u;
+    dedup->key      = (uint8_t*)realloc(dedup->key, dedup->key_size);
+  }
+
+  memcpy(dedup->key + dedup->key_len, buf, len);
+  dedup->key_len += len;
+  return len;
+}
+
+/// Forget every statement, when the table is full
+static void
+sord_deduplicator_clear(SordDeduplicator* const dedup)
+{
+  memset(dedup->hashes, 0, (dedup->mask + 1u) * sizeof(uint64_t));
+  dedup->n_entries = 0u;
+  dedup->keys_len  = 0u;
+}
+
+/**
+   Insert the current key into the table.
+
+   @return True if the key was already in the table.
+*/
+static bool
+sord_deduplicator_insert(SordDeduplicator* const dedup)
+{
+  const uint8_t* const key = dedup->key;
+  const size_t         len = dedup->key_len;
+
+  // Zero marks empty slots, so never use it as a hash
+  uint64_t hash = zix_digest_add(zix_digest_start(), key, len);
+  hash          = hash ? hash : 1u;
+
+  size_t i = (size_t)hash & dedup->mask;
+  for (; dedup->hashes[i]; i = (i + 1u) & dedup->mask) {
+    if (dedup->hashes[i] == hash) {
+      if (!dedup->offsets) {
+        return true;
+      }
+
+      // Compare the stored key, which is preceded by its length
+      const uint8_t* const entry     = dedup->keys + dedup->offsets[i];
+      size_t               entry_len = 0u;
+      memcpy(&entry_len, entry, sizeof(size_t));
+      if (entry_len == len && !memcmp(entry + sizeof(size_t), key, len)) {
+        return true;
+      }
+    }
+  }
+
+  const size_t entry_size = sizeof(size_t) + len;
+  if (dedup->offsets && entry_size > dedup->keys_size) {
+    return false; // Too large to remember at all
+  }
+
+  if (dedup->n_entries == dedup->max_entries ||
+      (dedup->offsets && dedup->keys_len + entry_size > dedup->keys_size)) {
+    // Start again with an empty table, and find a slot in it
+    sord_deduplicator_clear(dedup);
+    i = (size_t)hash & dedup->mask;
+  }
+
+  dedup->hashes[i] = hash;
+  if (dedup->offsets) {
+    uint8_t* const entry = dedup->keys + dedup->keys_len;
+    memcpy(entry, &len, sizeof(size_t));
+    memcpy(entry + sizeof(size_t), key, len);
+    dedup->offsets[i] = dedup->keys_len;
+    dedup->keys_len += entry_size;
+  }
+
+  ++dedup->n_entries;
+  return false;
+}
+
+SordDeduplicator*
+sord_deduplicator_new(SerdEnv*          env,
+                      size_t            max_memory,
+                      bool              exact,
+                      void*             handle,
+                      SerdBaseSink      base_sink,
+                      SerdPrefixSink    prefix_sink,
+                      SerdStatementSink statement_sink,
+                      SerdEndSink       end_sink)
+{
+  if (max_memory < SORD_DEDUP_MIN_MEMORY) {
+    max_memory = SORD_DEDUP_MIN_MEMORY;
+  }
+
+  SordDeduplicator* const dedup =
+    (SordDeduplicator*)calloc(1, sizeof(SordDeduplicator));
+
+  // Use a power of two number of slots, in a quarter of memory if exact
+  const size_t slot_size   = exact ? sizeof(uint64_t) + sizeof(size_t)
+                                   : sizeof(uint64_t);
+  const size_t table_bytes = exact ? max_memory / 4u : max_memory;
+
+  size_t n_slots = 1u;
+  while (n_slots * 2u * slot_size <= table_bytes) {
+    n_slots *= 2u;
+  }
+
+  dedup->hashes      = (uint64_t*)calloc(n_slots, sizeof(uint64_t));
+  dedup->mask        = n_slots - 1u;
+  dedup->max_entries = n_slots / 4u * 3u;
+  if (exact) {
+    dedup->offsets   = (size_t*)malloc(n_slots * sizeof(size_t));
+    dedup->keys_size = max_memory - n_slots * slot_size;
+    dedup->keys      = (uint8_t*)malloc(dedup->keys_size);
+  }
+
+  dedup->handle         = handle;
+  dedup->base_sink      = base_sink;
+  dedup->prefix_sink    = prefix_sink;
+  dedup->statement_sink = statement_sink;
+  dedup->end_sink       = end_sink;
+
+  // Copy env, since a writer sink may share it and resolve relative bases too
+  dedup->env = serd_env_new(serd_env_get_base_uri(env, NULL));
+  serd_env_foreach(env, (SerdPrefixSink)serd_env_set_prefix, dedup->env);
+
+  SerdURI base_uri = SERD_URI_NULL;
+  serd_env_get_base_uri(dedup->env, &base_uri);
+
+  // Keys are N-Quads lines, so equal statements have equal keys
+  dedup->writer =
+    serd_writer_new(SERD_NQUADS,
+                    (SerdStyle)(SERD_STYLE_ASCII | SERD_STYLE_RESOLVED),
+                    dedup->env,
+                    &base_uri,
+                    sord_deduplicator_sink,
+                    dedup);
+
+  return dedup;
+}
+
+void
+sord_deduplicator_free(SordDeduplicator* deduplicator)
+{
+  if (deduplicator) {
+    serd_writer_free(deduplicator->writer);
+    serd_env_free(deduplicator->env);
+    free(deduplicator->keys);
+    free(deduplicator->offsets);
+    free(deduplicator->hashes);
+    free(deduplicator->key);
+    free(deduplicator);
+  }
+}
+
+SerdStatus
+sord_deduplicator_set_base_uri(SordDeduplicator* deduplicator,
+                               const SerdNode*   uri)
+{
+  const SerdStatus st = serd_writer_set_base_uri(deduplicator->writer, uri);
+  if (st || !deduplicator->base_sink) {
+    return st;
+  }
+
+  return deduplicator->base_sink(deduplicator->handle, uri);
+}
+
+SerdStatus
+sord_deduplicator_set_prefix(SordDeduplicator* deduplicator,
+                             const SerdNode*   name,
+                             const SerdNode*   uri)
+{
+  const SerdStatus st =
+    serd_writer_set_prefix(deduplicator->writer, name, uri);
+  if (st || !deduplicator->prefix_sink) {
+    return st;
+  }
+
+  return deduplicator->prefix_sink(deduplicator->handle, name, uri);
+}
+
+SerdStatus
+sord_deduplicator_write_statement(SordDeduplicator*  deduplicator,
+                                  SerdStatementFlags flags,
+                                  const SerdNode*    graph,
+                                  const SerdNode*    subject,
+                                  const SerdNode*    predicate,
+                                  const SerdNode*    object,
+                                  const SerdNode*    object_datatype,
+                                  const SerdNode*    object_lang)
+{
+  if (!flags) {
+    // Write the key, and drop the statement if it has been seen
+    deduplicator->key_len = 0u;
+    if (!serd_writer_write_statement(deduplicator->writer,
+                                     0,
+                                     graph,
+                                     subject,
+                                     predicate,
+                                     object,
+                                     object_datatype,
+                                     object_lang) &&
+        sord_deduplicator_insert(deduplicator)) {
+      ++deduplicator->n_dropped;
+      return SERD_SUCCESS;
+    }
+  }
+
+  return deduplicator->statement_sink(deduplicator->handle,
+                                      flags,
+                                      graph,
+                                      subject,
+                                      predicate,
+                                      object,
+                                      object_datatype,
+                                      object_lang);
+}
+
+SerdStatus
+sord_deduplicator_end_anon(SordDeduplicator* deduplicator,
+                           const SerdNode*   node)
+{
+  return deduplicator->end_sink
+           ? deduplicator->end_sink(deduplicator->handle, node)
+           : SERD_SUCCESS;
+}
+
+size_t
+sord_deduplicator_num_dropped(const SordDeduplicator* deduplicator)
+{
+  return deduplicator->n_dropped;
+}
@@ -0,0 +1,145 @@
+/*
+  Copyright 2021 David Robillard <d@drobilla.net>
+
+  Permission to use, copy, modify, and/or distribute this software for any
+  purpose with or without fee is hereby granted, provided that the above
+  copyright notice and this permission notice appear in all copies.
+
+  THIS SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+
+/*
+  Microbenchmark for node hashing.
+
+  Times each digest implementation over strings of typical URI lengths and
+  prints a table of nanoseconds per hash and throughput, as tab-separated
+  values.  Note that this includes the digest directly, so it can compare
+  implementations that would not be selected on this CPU.
+*/
+
+#include "zix/digest.c"
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define N_STRINGS 4096u
+#define MAX_LENGTH 256u
+
+typedef struct {
+  const char*   name;
+  ZixDigestFunc func;
+} DigestImpl;
+
+static const size_t lengths[] = {8, 16, 24, 32, 48, 64, 96, 128, 256};
+
+static bool
+crc32c_supported(void)
+{
+#if ZIX_DIGEST_DISPATCH
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("sse4.2");
+#else
+  return ZIX_DIGEST_CRC32C;
+#endif
+}
+
+/// Fill `str` with a URI-like string of exactly `len` bytes
+static void
+make_uri(char* const str, const size_t len, unsigned* const seed)
+{
+  static const char prefix[]   = "http://example.org/ns/";
+  static const char alphabet[] = "abcdefghijklmnopqrstuvwxyz0123456789_-#/";
+
+  for (size_t i = 0; i < len; ++i) {
+    if (i < sizeof(prefix) - 1) {
+      str[i] = prefix[i];
+    } else {
+      *seed  = *seed * 1103515245u + 12345u;
+      str[i] = alphabet[(*seed >> 16u) % (sizeof(alphabet) - 1)];
+    }
+  }
+  str[len] = '\0';
+}
+
+static double
+bench(const DigestImpl* const impl,
+      char** const            strings,
+      const size_t            len,
+      const unsigned          n_rounds,
+      uint64_t* const         checksum)
+{
+  const clock_t start = clock();
+
+  uint64_t sum = 0u;
+  for (unsigned r = 0; r < n_rounds; ++r) {
+    for (unsigned i = 0; i < N_STRINGS; ++i) {
+      sum += impl->func(zix_digest_start(), strings[i], len);
+    }
+  }
+
+  *checksum += sum;
+  return (double)(clock() - start) / CLOCKS_PER_SEC;
+}
+
+int
+main(int argc, char** argv)
+{
+  const unsigned n_rounds = (argc > 1) ? (unsigned)atoi(argv[1]) : 2000u;
+  if (!n_rounds) {
+    fprintf(stderr, "Usage: %s [ROUNDS]\n", argv[0]);
+    return 1;
+  }
+
+  DigestImpl impls[3] = {{"mul", zix_digest_add_mul}, {NULL, NULL}};
+  unsigned   n_impls  = 1;
+#if ZIX_DIGEST_CRC32C
+  if (crc32c_supported()) {
+    impls[n_impls].name   = "crc32c";
+    impls[n_impls++].func = zix_digest_add_crc32c;
+  }
+#endif
+  impls[n_impls].name   = "dispatch";
+  impls[n_impls++].func = zix_digest_add;
+
+  char**   strings  = (char**)calloc(N_STRINGS, sizeof(char*));
+  unsigned seed     = 1u;
+  uint64_t checksum = 0u;
+
+  printf("# impl\tlength\tns/hash\tGB/s\n");
+  for (size_t l = 0; l < sizeof(lengths) / sizeof(lengths[0]); ++l) {
+    const size_t len = lengths[l];
+    for (unsigned i = 0; i < N_STRINGS; ++i) {
+      free(strings[i]);
+      strings[i] = (char*)malloc(MAX_LENGTH + 1);
+      make_uri(strings[i], len, &seed);
+    }
+
+    for (unsigned i = 0; i < n_impls; ++i) {
+      const double secs   = bench(&impls[i], strings, len, n_rounds, &checksum);
+      const double n_hash = (double)N_STRINGS * n_rounds;
+      printf("%s\t%zu\t%.2f\t%.2f\n",
+             impls[i].name,
+             len,
+             secs * 1e9 / n_hash,
+             n_hash * (double)len / secs / 1e9);
+    }
+  }
+
+  for (unsigned i = 0; i < N_STRINGS; ++i) {
+    free(strings[i]);
+  }
+  free(strings);
+
+  fprintf(stderr, "checksum %016llx\n", (unsigned long long)checksum);
+  return 0;
+}
@@ -0,0 +1,1355 @@
+/*
+  Copyright 2021 David Robillard <d@drobilla.net>
+
+  Permission to use, copy, modify, and/or distribute this software for any
+  purpose with or without fee is hereby granted, provided that the above
+  copyright notice and this permission notice appear in all copies.
+
+  THIS SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+
+#define _POSIX_C_SOURCE 200809L // for mmap and sysconf
+
+#include "sord_config.h" // IWYU pragma: keep
+
+#include "compress.h"
+#include "sord_internal.h"
+
+#include "serd/serd.h"
+#include "sord/sord.h"
+
+#if USE_MMAP
+#  include <fcntl.h>
+#  include <sys/mman.h>
+#  include <sys/stat.h>
+#endif
+
+#if USE_PTHREAD
+#  include <pthread.h>
+#endif
+
+#if USE_MMAP || USE_PTHREAD
+#  include <unistd.h>
+#endif
+
+#include <errno.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/// Maximum size of the input parsed by a worker at once
+#define SORD_LOAD_CHUNK_SIZE (4u << 20u)
+
+/// Minimum size of the input parsed by a worker at once
+#define SORD_LOAD_MIN_CHUNK_SIZE (64u << 10u)
+
+/// Size of pages read from memory by each reader
+#define SORD_LOAD_PAGE_SIZE 4096u
+
+/// Alignment of records in a stage
+#define SORD_STAGE_ALIGN sizeof(size_t)
+
+/// Number of nodes in a staged statement (graph, S, P, O, datatype, lang)
+#define SORD_STAGE_N_NODES 6u
+
+/// Number of batches in the ring between the parser and the inserter
+#define SORD_PIPE_N_BATCHES 4u
+
+/// Size of staged records that the parser hands to the inserter at once
+#define SORD_PIPE_BATCH_SIZE (256u << 10u)
+
+/**
+   A buffer of parsed records that have not yet been inserted.
+
+   This is a sequence of records, each of which is a SordStageRecord followed
+   by the staged nodes for that kind of record.  Since the world is not
+   thread-safe, parsing can happen on another thread, but nodes must be
+   interned on the thread that owns the model.
+*/
+typedef struct {
+  uint8_t* buf;  ///< Records
+  size_t   len;  ///< Length of records in bytes
+  size_t   size; ///< Allocated size of buf in bytes
+} SordStage;
+
+/// Kind of a record in a stage
+typedef enum {
+  SORD_STAGE_STATEMENT, ///< Statement with SORD_STAGE_N_NODES nodes
+  SORD_STAGE_BASE,      ///< Base URI change with one node
+  SORD_STAGE_PREFIX,    ///< Prefix change with name and URI nodes
+} SordStageKind;
+
+/** The header of a record in a stage */
+typedef struct {
+  SordStageKind      kind;
+  SerdStatementFlags flags; ///< Statement flags, or zero
+} SordStageRecord;
+
+/** A node in a stage, followed by its null-terminated string if present */
+typedef struct {
+  size_t        n_bytes;
+  size_t        n_chars;
+  SerdNodeFlags flags;
+  SerdType      type; ///< Type, or SERD_NOTHING for no node
+} SordStagedNode;
+/** A line-aligned piece of input, or a whole file */
+typedef struct {
+  const uint8_t* uri;    ///< File to read, or NULL to read buf
+  const uint8_t* buf;    ///< Start of input
+  size_t         len;    ///< Length of input in bytes
+  SordStage      stage;  ///< Statements parsed from input
+  char*          errors; ///< Error messages from reading input, or NULL
+  size_t         n_errors_bytes; ///< Length of errors in bytes
+  SerdStatus     status;         ///< Status of reading input
+  bool           parsed;         ///< True once stage is complete
+} SordLoadChunk;
+
+/** Shared state for loading chunks in parallel */
+typedef struct {
+  SerdSyntax      syntax;     ///< Input syntax
+  const SerdNode* graph;      ///< Default graph, or NULL
+  const uint8_t*  name;       ///< Input name for error messages
+  SordLoadChunk*  chunks;     ///< Chunks in input order
+  size_t          n_chunks;   ///< Number of chunks
+  size_t          max_ahead;  ///< Maximum parsed chunks waiting for insertion
+  size_t          next_chunk; ///< Index of the next chunk to parse
+  size_t          n_inserted; ///< Number of chunks inserted into the model
+#if USE_PTHREAD
+  pthread_mutex_t mutex; ///< Protects everything above
+  pthread_cond_t  cond;  ///< Signalled when a chunk is parsed or inserted
+#endif
+} SordLoader;
+
+#if USE_PTHREAD
+
+/**
+   A pipe from a parser thread to the thread that inserts into the model.
+
+   The parser fills the batches in a ring, and the inserter drains them in
+   order, so no more than SORD_PIPE_N_BATCHES batches are buffered at once.
+   Batches are reused, so their memory is only allocated once.
+*/
+typedef struct {
+  SerdSyntax      syntax;  ///< Input syntax
+  const SerdNode* graph;   ///< Default graph, or NULL
+  const uint8_t*  uri;     ///< Input file URI
+  SerdEnv*        env;     ///< Parser environment, mirrors the inserter's
+  SordStage       scratch; ///< Buffer for expanding nodes on the parser
+  SordStage       batches[SORD_PIPE_N_BATCHES]; ///< Ring of batches
+  size_t          n_parsed;   ///< Number of batches filled by the parser
+  size_t          n_inserted; ///< Number of batches inserted into the model
+  SerdStatus      status;     ///< Status of parsing
+  bool            finished;   ///< True once the parser has finished
+  pthread_mutex_t mutex;      ///< Protects the counters and flag above
+  pthread_cond_t  cond;       ///< Signalled when a batch is passed along
+} SordPipe;
+
+#endif
+
+/** State for parsing a file into a stage with its own environment */
+typedef struct {
+  SerdEnv*   env;     ///< Environment with the file's base URI
+  SordStage  scratch; ///< Buffer for expanding nodes
+  SordStage* stage;   ///< Stage for parsed statements
+} SordFileParser;
+
+/** A source that reads from a buffer in memory */
+typedef struct {
+  const uint8_t* buf;
+  size_t         len;
+  size_t         offset;
+} SordMemorySource;
+
+/** A source that reads from a file after some bytes peeked from its start */
+typedef struct {
+  FILE*   file;                              ///< File to read from
+  uint8_t head[SORD_COMPRESSION_MAGIC_SIZE]; ///< Bytes peeked from the file
+  size_t  head_len;                          ///< Number of bytes peeked
+  size_t  head_offset;                       ///< Offset of the next byte
+} SordStreamSource;
+
+static inline size_t
+sord_stage_pad(const size_t size)
+{
+  return (size + SORD_STAGE_ALIGN - 1u) & ~(SORD_STAGE_ALIGN - 1u);
+}
+
+/// Ensure there is room for `size` more bytes at the end of `stage`
+static void
+sord_stage_reserve(SordStage* const stage, const size_t size)
+{
+  if (stage->len + size > stage->size) {
+    size_t new_size = stage->size ? stage->size * 2u : SORD_LOAD_PAGE_SIZE;
+    while (new_size < stage->len + size) {
+      new_size *= 2u;
+    }
+
+    stage->buf  = (uint8_t*)realloc(stage->buf, new_size);
+    stage->size = new_size;
+  }
+}
+
+/// Allocate a record at the end of `stage`, valid until the next allocation
+static void*
+sord_stage_alloc(SordStage* const stage, const size_t size)
+{
+  const size_t padded = sord_stage_pad(size);
+  sord_stage_reserve(stage, padded);
+
+  void* const ptr = stage->buf + stage->len;
+  stage->len += padded;
+  return ptr;
+}
+
+/// Append unaligned bytes to a stage used as a string, compatible with SerdSink
+static size_t
+sord_stage_append(const void* const buf, const size_t len, void* const stream)
+{
+  SordStage* const stage = (SordStage*)stream;
+
+  sord_stage_reserve(stage, len);
+  memcpy(stage->buf + stage->len, buf, len);
+  stage->len += len;
+  return len;
+}
+
+static void
+sord_stage_push_record(SordStage* const         stage,
+                       const SordStageKind      kind,
+                       const SerdStatementFlags flags)
+{
+  SordStageRecord* const record =
+    (SordStageRecord*)sord_stage_alloc(stage, sizeof(SordStageRecord));
+
+  record->kind  = kind;
+  record->flags = flags;
+}
+
+static void
+sord_stage_push_node(SordStage* const stage, const SerdNode* const node)
+{
+  const bool   present = node && node->type != SERD_NOTHING;
+  const size_t n_bytes = present ? node->n_bytes : 0u;
+  const size_t size =
+    sizeof(SordStagedNode) + (present ? node->n_bytes + 1u : 0u);
+
+  SordStagedNode* const staged =
+    (SordStagedNode*)sord_stage_alloc(stage, size);
+
+  staged->n_bytes = n_bytes;
+  staged->n_chars = present ? node->n_chars : 0u;
+  staged->flags   = present ? node->flags : 0u;
+  staged->type    = present ? node->type : SERD_NOTHING;
+  if (present) {
+    uint8_t* const str = (uint8_t*)(staged + 1);
+    memcpy(str, node->buf, n_bytes);
+    str[n_bytes] = '\0';
+  }
+}
+
+/// Append a statement to a stage, compatible with SerdStatementSink
+static SerdStatus
+sord_stage_write_statement(void*              handle,
+                           SerdStatementFlags flags,
+                           const SerdNode*    graph,
+                           const SerdNode*    subject,
+                           const SerdNode*    predicate,
+                           const SerdNode*    object,
+                           const SerdNode*    object_datatype,
+                           const SerdNode*    object_lang)
+{
+  SordStage* const stage = (SordStage*)handle;
+
+  const SerdNode* const nodes[SORD_STAGE_N_NODES] = {
+    graph, subject, predicate, object, object_datatype, object_lang};
+
+  sord_stage_push_record(stage, SORD_STAGE_STATEMENT, flags);
+  for (unsigned i = 0u; i < SORD_STAGE_N_NODES; ++i) {
+    sord_stage_push_node(stage, nodes[i]);
+  }
+
+  return SERD_SUCCESS;
+}
+
+/**
+   Stage a node, with CURIEs expanded and relative URIs resolved in `env`.
+
+   This does the same expansion as the inserter, so that work can be done on
+   the parsing thread.  Nodes that can not be expanded are staged as they are,
+   to be reported by the inserter.
+*/
+static void
+sord_stage_push_expanded(SordStage* const      stage,
+                         SordStage* const      scratch,
+                         const SerdEnv* const  env,
+                         const SerdNode* const node)
+{
+  bool expanded = false;
+
+  scratch->len = 0u;
+  if (node && node->type == SERD_CURIE) {
+    SerdChunk prefix;
+    SerdChunk suffix;
+    if (!serd_env_expand(env, node, &prefix, &suffix)) {
+      sord_stage_append(prefix.buf, prefix.len, scratch);
+      sord_stage_append(suffix.buf, suffix.len, scratch);
+      expanded = true;
+    }
+  } else if (node && node->type == SERD_URI &&
+             !serd_uri_string_has_scheme(node->buf)) {
+    SerdURI base;
+    serd_env_get_base_uri(env, &base);
+
+    SerdURI abs_uri = base;
+    if (node->buf[0]) {
+      SerdURI uri;
+      serd_uri_parse(node->buf, &uri);
+      serd_uri_resolve(&uri, &base, &abs_uri);
+    }
+
+    serd_uri_serialise(&abs_uri, sord_stage_append, scratch);
+    expanded = true;
+  }
+
+  if (!expanded) {
+    sord_stage_push_node(stage, node);
+    return;
+  }
+
+  const size_t n_bytes = scratch->len;
+  sord_stage_append("", 1u, scratch);
+
+  const SerdNode uri = {
+    scratch->buf, n_bytes, serd_strlen(scratch->buf, NULL, NULL), 0, SERD_URI};
+
+  sord_stage_push_node(stage, &uri);
+}
+
+/// Append a statement to a stage with its nodes expanded in `env`
+static void
+sord_stage_push_expanded_statement(SordStage* const         stage,
+                                   SordStage* const         scratch,
+                                   const SerdEnv* const     env,
+                                   const SerdStatementFlags flags,
+                                   const SerdNode* const*   nodes)
+{
+  sord_stage_push_record(stage, SORD_STAGE_STATEMENT, flags);
+  for (unsigned i = 0u; i < SORD_STAGE_N_NODES; ++i) {
+    sord_stage_push_expanded(stage, scratch, env, nodes[i]);
+  }
+}
+
+/**
+   Insert every record in a stage.
+
+   All statements are inserted even if some fail.
+   @return The status of the first statement that failed, if any.
+*/
+static SerdStatus
+sord_stage_insert(const SordStage* const stage, SordInserter* const inserter)
+{
+  const uint8_t*       ptr = stage->buf;
+  const uint8_t* const end = stage->buf + stage->len;
+
+  SerdStatus st = SERD_SUCCESS;
+  while (ptr < end) {
+    SordStageRecord record;
+    memcpy(&record, ptr, sizeof(record));
+    ptr += sord_stage_pad(sizeof(record));
+
+    unsigned n_nodes = SORD_STAGE_N_NODES;
+    if (record.kind == SORD_STAGE_BASE) {
+      n_nodes = 1u;
+    } else if (record.kind == SORD_STAGE_PREFIX) {
+      n_nodes = 2u;
+    }
+
+    SerdNode        nodes[SORD_STAGE_N_NODES];
+    const SerdNode* args[SORD_STAGE_N_NODES];
+    for (unsigned i = 0u; i < n_nodes; ++i) {
+      const SordStagedNode* const staged = (const SordStagedNode*)ptr;
+      const bool present = staged->type != SERD_NOTHING;
+
+      nodes[i].buf     = (const uint8_t*)(staged + 1);
+      nodes[i].n_bytes = staged->n_bytes;
+      nodes[i].n_chars = staged->n_chars;
+      nodes[i].flags   = staged->flags;
+      nodes[i].type    = staged->type;
+      args[i]          = present ? &nodes[i] : NULL;
+
+      ptr += sord_stage_pad(sizeof(SordStagedNode) +
+                            (present ? staged->n_bytes + 1u : 0u));
+    }
+
+    SerdStatus rst = SERD_SUCCESS;
+    switch (record.kind) {
+    case SORD_STAGE_STATEMENT:
+      rst = sord_inserter_write_statement(inserter,
+                                          record.flags,
+                                          args[0],
+                                          args[1],
+                                          args[2],
+                                          args[3],
+                                          args[4],
+                                          args[5]);
+      break;
+    case SORD_STAGE_BASE:
+      rst = sord_inserter_set_base_uri(inserter, args[0]);
+      break;
+    case SORD_STAGE_PREFIX:
+      rst = sord_inserter_set_prefix(inserter, args[0], args[1]);
+      break;
+    }
+
+    if (!st) {
+      st = rst;
+    }
+  }
+
+  return st;
+}
+
+static size_t
+sord_memory_read(void* buf, size_t size, size_t nmemb, void* stream)
+{
+  SordMemorySource* const source    = (SordMemorySource*)stream;
+  const size_t            remaining = source->len - source->offset;
+  const size_t n_items = (nmemb < remaining / size) ? nmemb : remaining / size;
+
+  memcpy(buf, source->buf + source->offset, n_items * size);
+  source->offset += n_items * size;
+  return n_items;
+}
+
+static int
+sord_memory_error(void* stream)
+{
+  (void)stream;
+  return 0;
+}
+
+static size_t
+sord_stream_read(void* buf, size_t size, size_t nmemb, void* stream)
+{
+  SordStreamSource* const source = (SordStreamSource*)stream;
+  const size_t            len    = size * nmemb;
+  const size_t            peeked = source->head_len - source->head_offset;
+  const size_t            n      = (len < peeked) ? len : peeked;
+
+  memcpy(buf, source->head + source->head_offset, n);
+  source->head_offset += n;
+
+  return (n + fread((uint8_t*)buf + n, 1, len - n, source->file)) / size;
+}
+
+static int
+sord_stream_error(void* stream)
+{
+  return ferror(((SordStreamSource*)stream)->file);
+}
+
+#if USE_MMAP
+
+/**
+   Map an open regular file into memory.
+
+   @return The file contents, which must be freed with sord_unmap_file(), or
+   NULL on error or if the file is empty.
+*/
+static uint8_t*
+sord_map_fd(const int fd, size_t* const len)
+{
+  struct stat info;
+  void*       data = MAP_FAILED;
+  if (!fstat(fd, &info) && S_ISREG(info.st_mode) && info.st_size > 0) {
+    *len = (size_t)info.st_size;
+    data = mmap(NULL, *len, PROT_READ, MAP_PRIVATE, fd, 0);
+  }
+
+  return (data == MAP_FAILED) ? NULL : (uint8_t*)data;
+}
+
+#endif
+
+/**
+   Map the contents of a regular file into memory.
+
+   @return The file contents, which must be freed with sord_unmap_file(), or
+   NULL on error or if the file is empty.
+*/
+static uint8_t*
+sord_map_file(const char* const path, size_t* const len)
+{
+#if USE_MMAP
+  const int fd = open(path, O_RDONLY);
+  if (fd < 0) {
+    return NULL;
+  }
+
+  uint8_t* const data = sord_map_fd(fd, len);
+  close(fd);
+  return data;
+#else
+  FILE* const fd = fopen(path, "rb");
+  if (!fd) {
+    return NULL;
+  }
+
+  uint8_t* data = NULL;
+  long     size = 0;
+  if (!fseek(fd, 0, SEEK_END) && (size = ftell(fd)) > 0 &&
+      !fseek(fd, 0, SEEK_SET)) {
+    *len = (size_t)size;
+    data = (uint8_t*)malloc(*len);
+    if (data && fread(data, 1, *len, fd) != *len) {
+      free(data);
+      data = NULL;
+    }
+  }
+
+  fclose(fd);
+  return data;
+#endif
+}
+
+static void
+sord_unmap_file(uint8_t* const data, const size_t len)
+{
+#if USE_MMAP
+  munmap(data, len);
+#else
+  (void)len;
+  free(data);
+#endif
+}
+
+/**
+   Read from a source which may be compressed.
+
+   @param head The first bytes of the input, used to detect compression.
+   @param head_len The length of `head`.
+*/
+static SerdStatus
+sord_reader_read_any_source(SerdReader* const         reader,
+                            const SerdSource          read,
+                            const SerdStreamErrorFunc error,
+                            void* const               stream,
+                            const uint8_t* const      head,
+                            const size_t              head_len,
+                            const uint8_t* const      name)
+{
+  const SordCompression compression = sord_detect_compression(head, head_len);
+  if (compression == SORD_COMPRESSION_NONE) {
+    return serd_reader_read_source(
+      reader, read, error, stream, name, SORD_LOAD_PAGE_SIZE);
+  }
+
+  SordDecompressor* const decompressor =
+    sord_decompressor_new(compression, read, error, stream);
+  if (!decompressor) {
+    fprintf(stderr,
+            "error: %s is compressed in an unsupported format\n",
+            (const char*)name);
+    return SERD_ERR_UNKNOWN;
+  }
+
+  const SerdStatus st = serd_reader_read_source(reader,
+                                                sord_decompressor_read,
+                                                sord_decompressor_error,
+                                                decompressor,
+                                                name,
+                                                SORD_LOAD_PAGE_SIZE);
+
+  sord_decompressor_free(decompressor);
+  return st;
+}
+
+SerdStatus
+sord_reader_read_file_handle(SerdReader*    reader,
+                             FILE*          file,
+                             const uint8_t* name)
+{
+#if USE_MMAP
+  size_t   len  = 0u;
+  uint8_t* data = NULL;
+  if (!ftello(file) && (data = sord_map_fd(fileno(file), &len))) {
+    // Read directly from the mapping rather than through stdio buffers
+    posix_madvise(data, len, POSIX_MADV_SEQUENTIAL);
+
+    SordMemorySource source = {data, len, 0u};
+    const SerdStatus st     = sord_reader_read_any_source(reader,
+                                                      sord_memory_read,
+                                                      sord_memory_error,
+                                                      &source,
+                                                      data,
+                                                      len,
+                                                      name);
+
+    sord_unmap_file(data, len);
+    fseeko(file, 0, SEEK_END);
+    return st;
+  }
+#endif
+
+  // Peek at the start of the stream to detect compression
+  SordStreamSource source = {file, {0u}, 0u, 0u};
+  source.head_len = fread(source.head, 1, SORD_COMPRESSION_MAGIC_SIZE, file);
+
+  return sord_reader_read_any_source(reader,
+                                     sord_stream_read,
+                                     sord_stream_error,
+                                     &source,
+                                     source.head,
+                                     source.head_len,
+                                     name);
+}
+
+SerdStatus
+sord_reader_read_file(SerdReader* reader, const uint8_t* uri)
+{
+  uint8_t* const path = serd_file_uri_parse(uri, NULL);
+  if (!path) {
+    return SERD_ERR_BAD_ARG;
+  }
+
+  FILE* const fd = fopen((const char*)path, "rb");
+  if (!fd) {
+    fprintf(stderr,
+            "error: failed to open file %s (%s)\n",
+            (const char*)path,
+            strerror(errno));
+    serd_free(path);
+    return SERD_ERR_UNKNOWN;
+  }
+
+  const SerdStatus st = sord_reader_read_file_handle(reader, fd, path);
+
+  fclose(fd);
+  serd_free(path);
+  return st;
+}
+
+static SerdStatus
+sord_file_set_base_uri(void* const handle, const SerdNode* const uri)
+{
+  return serd_env_set_base_uri(((SordFileParser*)handle)->env, uri);
+}
+
+static SerdStatus
+sord_file_set_prefix(void* const           handle,
+                     const SerdNode* const name,
+                     const SerdNode* const uri)
+{
+  return serd_env_set_prefix(((SordFileParser*)handle)->env, name, uri);
+}
+
+static SerdStatus
+sord_file_write_statement(void*              handle,
+                          SerdStatementFlags flags,
+                          const SerdNode*    graph,
+                          const SerdNode*    subject,
+                          const SerdNode*    predicate,
+                          const SerdNode*    object,
+                          const SerdNode*    object_datatype,
+                          const SerdNode*    object_lang)
+{
+  SordFileParser* const parser = (SordFileParser*)handle;
+
+  const SerdNode* const nodes[SORD_STAGE_N_NODES] = {
+    graph, subject, predicate, object, object_datatype, object_lang};
+
+  sord_stage_push_expanded_statement(
+    parser->stage, &parser->scratch, parser->env, flags, nodes);
+
+  return SERD_SUCCESS;
+}
+
+/** Where errors from parsing a chunk are written */
+typedef struct {
+  const SordLoader* loader;     ///< Loader that owns chunk
+  SordLoadChunk*    chunk;      ///< Chunk being parsed
+  unsigned          first_line; ///< Number of lines before chunk
+  bool              line_known; ///< True if first_line has been counted
+} SordLoadErrorSink;
+
+/// Append a formatted message to the errors of `chunk`
+static void
+sord_load_vprintf(SordLoadChunk* const chunk,
+                  const char* const    fmt,
+                  va_list              args)
+{
+  va_list args_copy;
+  va_copy(args_copy, args);
+  const int len = vsnprintf(NULL, 0, fmt, args_copy);
+  va_end(args_copy);
+  if (len < 0) {
+    return;
+  }
+
+  chunk->errors = (char*)realloc(chunk->errors,
+                                 chunk->n_errors_bytes + (size_t)len + 1u);
+
+  vsnprintf(chunk->errors + chunk->n_errors_bytes, (size_t)len + 1u, fmt, args);
+  chunk->n_errors_bytes += (size_t)len;
+}
+
+static void
+sord_load_printf(SordLoadChunk* const chunk, const char* const fmt, ...)
+{
+  va_list args;
+  va_start(args, fmt);
+  sord_load_vprintf(chunk, fmt, args);
+  va_end(args);
+}
+
+/**
+   Record an error from parsing a chunk.
+
+   Errors are printed when the chunk is inserted, so they appear in input
+   order.  Line numbers are relative to the chunk, so the lines before it are
+   counted to make them relative to the whole input, which is only done once
+   an error occurs to avoid scanning the input twice.
+*/
+static SerdStatus
+sord_load_error(void* const handle, const SerdError* const error)
+{
+  SordLoadErrorSink* const sink  = (SordLoadErrorSink*)handle;
+  SordLoadChunk* const     chunk = sink->chunk;
+
+  if (!sink->line_known) {
+    // Chunks end at line boundaries, so count the lines before this one
+    for (const uint8_t* b = sink->loader->chunks[0].buf; b < chunk->buf; ++b) {
+      sink->first_line += (*b == '\n');
+    }
+
+    sink->line_known = true;
+  }
+
+  va_list args;
+  va_copy(args, *error->args);
+  sord_load_printf(chunk,
+                   "error: %s:%u:%u: ",
+                   (const char*)error->filename,
+                   sink->first_line + error->line,
+                   error->col);
+  sord_load_vprintf(chunk, error->fmt, args);
+  va_end(args);
+
+  return SERD_SUCCESS;
+}
+
+/**
+   Parse a whole file into the stage of `chunk`.
+
+   The file is parsed with its own environment, so its base URI is the URI of
+   the file and its prefixes do not affect other files.  Blank nodes are
+   prefixed with the file number so they are distinct from those in others.
+*/
+static void
+sord_load_parse_file(const SordLoader* const loader,
+                     SordLoadChunk* const    chunk,
+                     const size_t            index)
+{
+  uint8_t* const path = serd_file_uri_parse(chunk->uri, NULL);
+  SerdNode       base =
+    path ? serd_node_new_file_uri(path, NULL, NULL, true) : SERD_NODE_NULL;
+
+  serd_free(path);
+
+  SordFileParser parser = {serd_env_new(&base), {NULL, 0u, 0u}, &chunk->stage};
+
+  SerdReader* const reader = serd_reader_new(loader->syntax,
+                                             &parser,
+                                             NULL,
+                                             sord_file_set_base_uri,
+                                             sord_file_set_prefix,
+                                             sord_file_write_statement,
+                                             NULL);
+
+  SordLoadErrorSink errors = {loader, chunk, 0u, true};
+  serd_reader_set_error_sink(reader, sord_load_error, &errors);
+
+  char blank_prefix[32];
+  snprintf(blank_prefix, sizeof(blank_prefix), "f%zu_", index + 1u);
+  serd_reader_add_blank_prefix(reader, (const uint8_t*)blank_prefix);
+
+  if (loader->graph) {
+    serd_reader_set_default_graph(reader, loader->graph);
+  }
+
+  chunk->status = sord_reader_read_file(reader, chunk->uri);
+
+  serd_reader_free(reader);
+  serd_env_free(parser.env);
+  serd_node_free(&base);
+  free(parser.scratch.buf);
+}
+
+/// Parse a chunk into its stage, which may be done on any thread
+static void
+sord_load_parse(const SordLoader* const loader, SordLoadChunk* const chunk)
+{
+  if (chunk->uri) {
+    sord_load_parse_file(loader, chunk, (size_t)(chunk - loader->chunks));
+    return;
+  }
+
+  SerdReader* const reader = serd_reader_new(loader->syntax,
+                                             &chunk->stage,
+                                             NULL,
+                                             NULL,
+                                             NULL,
+                                             sord_stage_write_statement,
+                                             NULL);
+
+  SordLoadErrorSink errors = {loader, chunk, 0u, false};
+  serd_reader_set_error_sink(reader, sord_load_error, &errors);
+
+  if (loader->graph) {
+    serd_reader_set_default_graph(reader, loader->graph);
+  }
+
+  SordMemorySource source = {chunk->buf, chunk->len, 0u};
+  chunk->status           = serd_reader_read_source(reader,
+                                          sord_memory_read,
+                                          sord_memory_error,
+                                          &source,
+                                          loader->name,
+                                          SORD_LOAD_PAGE_SIZE);
+
+  serd_reader_free(reader);
+}
+
+/**
+   Split `buf` into chunks that end at line boundaries.
+
+   @return The number of chunks in the newly allocated array `chunks`.
+*/
+static size_t
+sord_load_split(const uint8_t* const  buf,
+                const size_t          len,
+                const size_t          chunk_size,
+                SordLoadChunk** const chunks)
+{
+  const size_t max_n_chunks = len / chunk_size + 1u;
+
+  *chunks = (SordLoadChunk*)calloc(max_n_chunks, sizeof(SordLoadChunk));
+
+  size_t n_chunks = 0u;
+  for (size_t offset = 0u; offset < len;) {
+    size_t end = offset + chunk_size;
+    if (end >= len) {
+      end = len;
+    } else {
+      const uint8_t* const eol =
+        (const uint8_t*)memchr(buf + end, '\n', len - end);
+
+      end = eol ? (size_t)(eol - buf) + 1u : len;
+    }
+
+    (*chunks)[n_chunks].buf = buf + offset;
+    (*chunks)[n_chunks].len = end - offset;
+    ++n_chunks;
+    offset = end;
+  }
+
+  return n_chunks;
+}
+
+#if USE_PTHREAD
+
+static void*
+sord_load_work(void* data)
+{
+  SordLoader* const loader = (SordLoader*)data;
+
+  pthread_mutex_lock(&loader->mutex);
+  while (loader->next_chunk < loader->n_chunks) {
+    if (loader->next_chunk >= loader->n_inserted + loader->max_ahead) {
+      // Too far ahead of insertion, wait to avoid buffering the whole input
+      pthread_cond_wait(&loader->cond, &loader->mutex);
+      continue;
+    }
+
+    SordLoadChunk* const chunk = &loader->chunks[loader->next_chunk++];
+    pthread_mutex_unlock(&loader->mutex);
+
+    sord_load_parse(loader, chunk);
+
+    pthread_mutex_lock(&loader->mutex);
+    chunk->parsed = true;
+    pthread_cond_broadcast(&loader->cond);
+  }
+  pthread_mutex_unlock(&loader->mutex);
+
+  return NULL;
+}
+
+#endif
+
+/// Wait until a worker has parsed `chunk`
+static void
+sord_load_wait(SordLoader* const loader, const SordLoadChunk* const chunk)
+{
+#if USE_PTHREAD
+  pthread_mutex_lock(&loader->mutex);
+  while (!chunk->parsed) {
+    pthread_cond_wait(&loader->cond, &loader->mutex);
+  }
+  pthread_mutex_unlock(&loader->mutex);
+#else
+  (void)loader;
+  (void)chunk;
+#endif
+}
+
+/// Record that another chunk has been inserted, so workers can continue
+static void
+sord_load_advance(SordLoader* const loader)
+{
+#if USE_PTHREAD
+  pthread_mutex_lock(&loader->mutex);
+  ++loader->n_inserted;
+  pthread_cond_broadcast(&loader->cond);
+  pthread_mutex_unlock(&loader->mutex);
+#else
+  ++loader->n_inserted;
+#endif
+}
+
+/// Stop workers from parsing any more chunks
+static void
+sord_load_stop(SordLoader* const loader)
+{
+#if USE_PTHREAD
+  pthread_mutex_lock(&loader->mutex);
+  loader->next_chunk = loader->n_chunks;
+  pthread_cond_broadcast(&loader->cond);
+  pthread_mutex_unlock(&loader->mutex);
+#else
+  loader->next_chunk = loader->n_chunks;
+#endif
+}
+
+/**
+   Parse chunks on `n_threads` threads, and insert them in order.
+
+   Insertion happens on the calling thread as each chunk in order is parsed.
+   Afterwards, the status of each chunk is the first error from reading or
+   inserting it.  Errors are printed as each chunk is inserted, so they appear
+   in input order.  Chunks of a single input are parts of one document, so
+   like when reading serially, nothing after the first error is inserted.
+*/
+static SerdStatus
+sord_load_chunks(SordLoader* const   loader,
+                 SordInserter* const inserter,
+                 const unsigned      n_threads)
+{
+  unsigned n_workers = 0u;
+
+#if USE_PTHREAD
+  pthread_t* const workers = (pthread_t*)calloc(n_threads, sizeof(pthread_t));
+
+  pthread_mutex_init(&loader->mutex, NULL);
+  pthread_cond_init(&loader->cond, NULL);
+  for (unsigned i = 0u; i < n_threads && i < loader->n_chunks; ++i) {
+    if (!pthread_create(&workers[n_workers], NULL, sord_load_work, loader)) {
+      ++n_workers;
+    }
+  }
+#else
+  (void)n_threads;
+#endif
+
+  SerdStatus st = SERD_SUCCESS;
+  for (size_t i = 0u; i < loader->n_chunks; ++i) {
+    SordLoadChunk* const chunk = &loader->chunks[i];
+
+    if (n_workers) {
+      sord_load_wait(loader, chunk);
+    } else {
+      sord_load_parse(loader, chunk); // No threads available, parse here
+    }
+
+    if (chunk->errors) {
+      fwrite(chunk->errors, 1, chunk->n_errors_bytes, stderr);
+    }
+
+    const SerdStatus ist = sord_stage_insert(&chunk->stage, inserter);
+    if (chunk->status <= SERD_FAILURE) {
+      chunk->status = ist;
+    }
+
+    if (!st) {
+      st = chunk->status;
+    }
+
+    free(chunk->stage.buf);
+    chunk->stage.buf = NULL;
+    sord_load_advance(loader);
+
+    if (chunk->status > SERD_FAILURE && !chunk->uri) {
+      sord_load_stop(loader);
+      break;
+    }
+  }
+
+#if USE_PTHREAD
+  for (unsigned i = 0u; i < n_workers; ++i) {
+    pthread_join(workers[i], NULL);
+  }
+
+  pthread_cond_destroy(&loader->cond);
+  pthread_mutex_destroy(&loader->mutex);
+  free(workers);
+#endif
+
+  // Free anything parsed ahead of the insertion that stopped early
+  for (size_t i = 0u; i < loader->n_chunks; ++i) {
+    free(loader->chunks[i].stage.buf);
+    free(loader->chunks[i].errors);
+  }
+
+  return st;
+}
+
+#if USE_PTHREAD
+
+/// Return the batch currently being filled, only called by the parser
+static SordStage*
+sord_pipe_batch(SordPipe* const pipe)
+{
+  return &pipe->batches[pipe->n_parsed % SORD_PIPE_N_BATCHES];
+}
+
+/// Pass the current batch to the inserter, and wait for a free one
+static void
+sord_pipe_flush(SordPipe* const pipe)
+{
+  pthread_mutex_lock(&pipe->mutex);
+  ++pipe->n_parsed;
+  pthread_cond_broadcast(&pipe->cond);
+  while (pipe->n_parsed - pipe->n_inserted == SORD_PIPE_N_BATCHES) {
+    pthread_cond_wait(&pipe->cond, &pipe->mutex);
+  }
+  pthread_mutex_unlock(&pipe->mutex);
+}
+
+static SerdStatus
+sord_pipe_set_base_uri(void* const handle, const SerdNode* const uri)
+{
+  SordPipe* const  pipe  = (SordPipe*)handle;
+  SordStage* const batch = sord_pipe_batch(pipe);
+
+  sord_stage_push_record(batch, SORD_STAGE_BASE, 0u);
+  sord_stage_push_node(batch, uri);
+  return serd_env_set_base_uri(pipe->env, uri);
+}
+
+static SerdStatus
+sord_pipe_set_prefix(void* const           handle,
+                     const SerdNode* const name,
+                     const SerdNode* const uri)
+{
+  SordPipe* const  pipe  = (SordPipe*)handle;
+  SordStage* const batch = sord_pipe_batch(pipe);
+
+  sord_stage_push_record(batch, SORD_STAGE_PREFIX, 0u);
+  sord_stage_push_node(batch, name);
+  sord_stage_push_node(batch, uri);
+  return serd_env_set_prefix(pipe->env, name, uri);
+}
+
+static SerdStatus
+sord_pipe_write_statement(void*              handle,
+                          SerdStatementFlags flags,
+                          const SerdNode*    graph,
+                          const SerdNode*    subject,
+                          const SerdNode*    predicate,
+                          const SerdNode*    object,
+                          const SerdNode*    object_datatype,
+                          const SerdNode*    object_lang)
+{
+  SordPipe* const  pipe  = (SordPipe*)handle;
+  SordStage* const batch = sord_pipe_batch(pipe);
+
+  const SerdNode* const nodes[SORD_STAGE_N_NODES] = {
+    graph, subject, predicate, object, object_datatype, object_lang};
+
+  sord_stage_push_expanded_statement(
+    batch, &pipe->scratch, pipe->env, flags, nodes);
+
+  if (batch->len >= SORD_PIPE_BATCH_SIZE) {
+    sord_pipe_flush(pipe);
+  }
+
+  return SERD_SUCCESS;
+}
+
+static void*
+sord_pipe_parse(void* data)
+{
+  SordPipe* const   pipe   = (SordPipe*)data;
+  SerdReader* const reader = serd_reader_new(pipe->syntax,
+                                             pipe,
+                                             NULL,
+                                             sord_pipe_set_base_uri,
+                                             sord_pipe_set_prefix,
+                                             sord_pipe_write_statement,
+                                             NULL);
+
+  if (pipe->graph) {
+    serd_reader_set_default_graph(reader, pipe->graph);
+  }
+
+  const SerdStatus st = sord_reader_read_file(reader, pipe->uri);
+  serd_reader_free(reader);
+
+  // Pass along the final batch, which may be partial or empty
+  pthread_mutex_lock(&pipe->mutex);
+  pipe->status = st;
+  ++pipe->n_parsed;
+  pipe->finished = true;
+  pthread_cond_broadcast(&pipe->cond);
+  pthread_mutex_unlock(&pipe->mutex);
+
+  return NULL;
+}
+
+/// Insert batches from the parser in order until it is finished
+static SerdStatus
+sord_pipe_insert(SordPipe* const pipe, SordInserter* const inserter)
+{
+  SerdStatus st = SERD_SUCCESS;
+
+  pthread_mutex_lock(&pipe->mutex);
+  for (;;) {
+    while (pipe->n_inserted == pipe->n_parsed && !pipe->finished) {
+      pthread_cond_wait(&pipe->cond, &pipe->mutex);
+    }
+
+    if (pipe->n_inserted == pipe->n_parsed) {
+      break;
+    }
+
+    SordStage* const batch =
+      &pipe->batches[pipe->n_inserted % SORD_PIPE_N_BATCHES];
+
+    pthread_mutex_unlock(&pipe->mutex);
+
+    const SerdStatus ist = sord_stage_insert(batch, inserter);
+    if (!st) {
+      st = ist;
+    }
+
+    batch->len = 0u;
+
+    pthread_mutex_lock(&pipe->mutex);
+    ++pipe->n_inserted;
+    pthread_cond_broadcast(&pipe->cond);
+  }
+  pthread_mutex_unlock(&pipe->mutex);
+
+  return st;
+}
+
+#endif
+
+unsigned
+sord_default_n_threads(void)
+{
+#if USE_PTHREAD && defined(_SC_NPROCESSORS_ONLN)
+  const long n_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+  return (n_cpus > 0) ? (unsigned)n_cpus : 1u;
+#else
+  return 1u;
+#endif
+}
+
+static SerdStatus
+sord_read_file_serially(SordModel* const     model,
+                        SerdEnv* const       env,
+                        const SerdSyntax     syntax,
+                        const uint8_t* const uri,
+                        SordNode* const      graph)
+{
+  SerdReader* const reader = sord_new_reader(model, env, syntax, graph);
+  const SerdStatus  st     = sord_reader_read_file(reader, uri);
+
+  serd_reader_free(reader);
+  return st;
+}
+
+#if USE_PTHREAD
+
+/**
+   Read a file with parsing and insertion pipelined on two threads.
+
+   A new thread parses the file into batches, while the calling thread inserts
+   them into the model.
+*/
+static SerdStatus
+sord_read_file_pipelined(SordModel* const     model,
+                         SerdEnv* const       env,
+                         const SerdSyntax     syntax,
+                         const uint8_t* const uri,
+                         SordNode* const      graph)
+{
+  const SerdNode* const base = serd_env_get_base_uri(env, NULL);
+
+  SordPipe pipe;
+  memset(&pipe, 0, sizeof(pipe));
+  pipe.syntax = syntax;
+  pipe.graph  = graph ? sord_node_to_serd_node(graph) : NULL;
+  pipe.uri    = uri;
+  pipe.env    = serd_env_new((base && base->buf) ? base : NULL);
+  serd_env_foreach(env, (SerdPrefixSink)serd_env_set_prefix, pipe.env);
+  pthread_mutex_init(&pipe.mutex, NULL);
+  pthread_cond_init(&pipe.cond, NULL);
+
+  SerdStatus st     = SERD_SUCCESS;
+  pthread_t  parser;
+  if (pthread_create(&parser, NULL, sord_pipe_parse, &pipe)) {
+    st = sord_read_file_serially(model, env, syntax, uri, graph);
+  } else {
+    SordInserter* const inserter = sord_inserter_new(model, env);
+    const SerdStatus    ist      = sord_pipe_insert(&pipe, inserter);
+
+    pthread_join(parser, NULL);
+    sord_inserter_free(inserter);
+    st = pipe.status > SERD_FAILURE ? pipe.status : ist;
+  }
+
+  for (unsigned i = 0u; i < SORD_PIPE_N_BATCHES; ++i) {
+    free(pipe.batches[i].buf);
+  }
+
+  free(pipe.scratch.buf);
+  serd_env_free(pipe.env);
+  pthread_cond_destroy(&pipe.cond);
+  pthread_mutex_destroy(&pipe.mutex);
+  return st;
+}
+
+#endif
+
+SerdStatus
+sord_read_file(SordModel*     model,
+               SerdEnv*       env,
+               SerdSyntax     syntax,
+               const uint8_t* uri,
+               SordNode*      graph,
+               unsigned       n_threads)
+{
+  if (!n_threads) {
+    n_threads = sord_default_n_threads();
+  }
+
+  if (!USE_PTHREAD || n_threads < 2u) {
+    return sord_read_file_serially(model, env, syntax, uri, graph);
+  }
+
+  // Only line-based syntaxes can be safely split
+  uint8_t* data = NULL;
+  size_t   len  = 0u;
+  if (syntax == SERD_NTRIPLES || syntax == SERD_NQUADS) {
+    uint8_t* const path = serd_file_uri_parse(uri, NULL);
+    if (!path) {
+      return SERD_ERR_BAD_ARG;
+    }
+
+    data = sord_map_file((const char*)path, &len);
+    serd_free(path);
+
+    if (data && sord_detect_compression(data, len) != SORD_COMPRESSION_NONE) {
+      // Compressed input can't be split, so decompress it as a stream
+      sord_unmap_file(data, len);
+      data = NULL;
+    }
+  }
+
+  if (!data) {
+    // Not splittable, or not a regular file, so parse ahead on one thread
+#if USE_PTHREAD
+    return sord_read_file_pipelined(model, env, syntax, uri, graph);
+#else
+    return sord_read_file_serially(model, env, syntax, uri, graph);
+#endif
+  }
+
+  // Use at least a few chunks per thread to balance load
+  size_t chunk_size = len / (4u * n_threads);
+  if (chunk_size < SORD_LOAD_MIN_CHUNK_SIZE) {
+    chunk_size = SORD_LOAD_MIN_CHUNK_SIZE;
+  } else if (chunk_size > SORD_LOAD_CHUNK_SIZE) {
+    chunk_size = SORD_LOAD_CHUNK_SIZE;
+  }
+
+  SordLoader loader;
+  memset(&loader, 0, sizeof(loader));
+  loader.syntax    = syntax;
+  loader.graph     = graph ? sord_node_to_serd_node(graph) : NULL;
+  loader.name      = uri;
+  loader.n_chunks  = sord_load_split(data, len, chunk_size, &loader.chunks);
+  loader.max_ahead = 2u * n_threads;
+
+  SordInserter* const inserter = sord_inserter_new(model, env);
+  const SerdStatus    st       = sord_load_chunks(&loader, inserter, n_threads);
+
+  sord_inserter_free(inserter);
+  free(loader.chunks);
+  sord_unmap_file(data, len);
+  return st;
+}
+
+SerdStatus
+sord_read_files(SordModel*            model,
+                SerdSyntax            syntax,
+                size_t                n_files,
+                const uint8_t* const* uris,
+                SordNode*             graph,
+                unsigned              n_threads,
+                SerdStatus*           statuses)
+{
+  if (!n_threads) {
+    n_threads = sord_default_n_threads();
+  }
+
+  SordLoader loader;
+  memset(&loader, 0, sizeof(loader));
+  loader.syntax    = syntax;
+  loader.graph     = graph ? sord_node_to_serd_node(graph) : NULL;
+  loader.chunks    = (SordLoadChunk*)calloc(n_files, sizeof(SordLoadChunk));
+  loader.n_chunks  = n_files;
+  loader.max_ahead = 2u * n_threads;
+  for (size_t i = 0u; i < n_files; ++i) {
+    loader.chunks[i].uri = uris[i];
+  }
+
+  // Nodes are expanded by the parser for each file, so no prefixes are needed
+  SerdEnv* const      env      = serd_env_new(NULL);
+  SordInserter* const inserter = sord_inserter_new(model, env);
+  const SerdStatus    st       = sord_load_chunks(
+    &loader, inserter, (USE_PTHREAD && n_threads > 1u) ? n_threads : 0u);
+
+  if (statuses) {
+    for (size_t i = 0u; i < n_files; ++i) {
+      statuses[i] = loader.chunks[i].status;
+    }
+  }
+
+  sord_inserter_free(inserter);
+  serd_env_free(env);
+  free(loader.chunks);
+  return st;
+}
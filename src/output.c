@@ -0,0 +1,365 @@
+/*
+  Copyright 2021 David Robillard <d@drobilla.net>
+
+  Permission to use, copy, modify, and/or distribute this software for any
+  purpose with or without fee is hereby granted, provided that the above
+  copyright notice and this permission notice appear in all copies.
+
+  THIS SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+
+#define _POSIX_C_SOURCE 200809L // for fileno and writev
+
+#include "sord_config.h" // IWYU pragma: keep
+
+#include "serd/serd.h"
+#include "sord/sord.h"
+
+#if USE_WRITEV
+#  include <sys/uio.h>
+#endif
+
+#if USE_PTHREAD
+#  include <pthread.h>
+#endif
+
+#include <errno.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/// Size of the output buffer if none is given
+#define SORD_OUTPUT_DEFAULT_SIZE (4u << 20u)
+
+/// Minimum size of an output block
+#define SORD_OUTPUT_MIN_BLOCK_SIZE (4u << 10u)
+
+/// Number of blocks the output buffer is split into
+#define SORD_OUTPUT_N_BLOCKS 4u
+
+/// Maximum number of pieces written at once
+#define SORD_OUTPUT_MAX_PIECES (SORD_OUTPUT_N_BLOCKS + 1u)
+
+/// A piece of output to write, like struct iovec
+typedef struct {
+  const uint8_t* buf; ///< Start of data
+  size_t         len; ///< Length of data in bytes
+} SordOutputPiece;
+
+/**
+   A buffered output stream.
+
+   The buffer is a ring of blocks.  The caller fills the current block, and
+   passes it along when it is full.  Full blocks are written by the writer
+   thread if there is one, or otherwise by the caller when every block is
+   full, in either case with as few system calls as possible.
+*/
+struct SordOutputImpl {
+  FILE*    file;                       ///< File to write to
+  uint8_t* blocks;                     ///< Ring of blocks
+  size_t   block_size;                 ///< Size of each block in bytes
+  size_t   lens[SORD_OUTPUT_N_BLOCKS]; ///< Length of each block
+  size_t   n_filled;                   ///< Number of blocks passed along
+  size_t   n_written;                  ///< Number of blocks written
+  bool     failed;                     ///< True if writing failed
+#if USE_PTHREAD
+  pthread_t       thread;        ///< Thread that writes full blocks
+  bool            threaded;      ///< True if the thread is running
+  bool            thread_failed; ///< True if the thread failed to write
+  bool            stopped;       ///< True if the thread should stop
+  pthread_mutex_t mutex;         ///< Protects the counters and flags above
+  pthread_cond_t  cond;          ///< Signalled when a block is passed along
+#endif
+};
+
+/// Write every piece to the file, and return false on error
+static bool
+sord_output_write_pieces(FILE* const            file,
+                         SordOutputPiece* const pieces,
+                         const size_t           n_pieces)
+{
+#if USE_WRITEV
+  struct iovec iov[SORD_OUTPUT_MAX_PIECES];
+  for (size_t i = 0u; i < n_pieces; ++i) {
+    iov[i].iov_base = (void*)pieces[i].buf;
+    iov[i].iov_len  = pieces[i].len;
+  }
+
+  const int     fd    = fileno(file);
+  struct iovec* next  = iov;
+  int           n_iov = (int)n_pieces;
+  while (n_iov) {
+    const ssize_t r = writev(fd, next, n_iov);
+    if (r < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+
+      return false;
+    }
+
+    // Skip what was written, which may end in the middle of a piece
+    size_t done = (size_t)r;
+    for (; n_iov && done >= next->iov_len; ++next, --n_iov) {
+      done -= next->iov_len;
+    }
+
+    if (n_iov) {
+      next->iov_base = (uint8_t*)next->iov_base + done;
+      next->iov_len -= done;
+    }
+  }
+
+  return true;
+#else
+  for (size_t i = 0u; i < n_pieces; ++i) {
+    if (fwrite(pieces[i].buf, 1, pieces[i].len, file) != pieces[i].len) {
+      return false;
+    }
+  }
+
+  return !fflush(file);
+#endif
+}
+
+/**
+   Write the blocks from `begin` up to `end`, and the extra piece, if given.
+
+   The blocks must not be modified by any other thread while this runs.
+*/
+static bool
+sord_output_write_blocks(SordOutput* const    output,
+                         const size_t         begin,
+                         const size_t         end,
+                         const uint8_t* const extra,
+                         const size_t         extra_len)
+{
+  SordOutputPiece pieces[SORD_OUTPUT_MAX_PIECES];
+  size_t          n_pieces = 0u;
+  for (size_t b = begin; b < end; ++b) {
+    const size_t i = b % SORD_OUTPUT_N_BLOCKS;
+
+    pieces[n_pieces].buf = output->blocks + i * output->block_size;
+    pieces[n_pieces].len = output->lens[i];
+    ++n_pieces;
+  }
+
+  if (extra_len) {
+    pieces[n_pieces].buf = extra;
+    pieces[n_pieces].len = extra_len;
+    ++n_pieces;
+  }
+
+  return sord_output_write_pieces(output->file, pieces, n_pieces);
+}
+
+#if USE_PTHREAD
+
+static void*
+sord_output_run(void* data)
+{
+  SordOutput* const output = (SordOutput*)data;
+
+  pthread_mutex_lock(&output->mutex);
+  for (;;) {
+    if (output->n_written == output->n_filled) {
+      if (output->stopped) {
+        break;
+      }
+
+      pthread_cond_wait(&output->cond, &output->mutex);
+      continue;
+    }
+
+    // Write every full block at once
+    const size_t begin = output->n_written;
+    const size_t end   = output->n_filled;
+    pthread_mutex_unlock(&output->mutex);
+
+    // After an error, drop output so the caller does not wait forever
+    const bool ok = !output->thread_failed &&
+                    sord_output_write_blocks(output, begin, end, NULL, 0u);
+
+    pthread_mutex_lock(&output->mutex);
+    output->thread_failed = !ok;
+    output->n_written     = end;
+    pthread_cond_broadcast(&output->cond);
+  }
+  pthread_mutex_unlock(&output->mutex);
+
+  return NULL;
+}
+
+#endif
+
+SordOutput*
+sord_output_new(FILE* file, size_t buffer_size, bool threaded)
+{
+  if (!buffer_size) {
+    buffer_size = SORD_OUTPUT_DEFAULT_SIZE;
+  }
+
+  SordOutput* const output = (SordOutput*)calloc(1, sizeof(SordOutput));
+
+  output->file       = file;
+  output->block_size = buffer_size / SORD_OUTPUT_N_BLOCKS;
+  if (output->block_size < SORD_OUTPUT_MIN_BLOCK_SIZE) {
+    output->block_size = SORD_OUTPUT_MIN_BLOCK_SIZE;
+  }
+
+  output->blocks =
+    (uint8_t*)malloc(SORD_OUTPUT_N_BLOCKS * output->block_size);
+
+  // Anything already written with stdio must come first
+  output->failed = fflush(file) != 0;
+
+#if USE_PTHREAD
+  output->thread_failed = output->failed;
+  pthread_mutex_init(&output->mutex, NULL);
+  pthread_cond_init(&output->cond, NULL);
+  output->threaded =
+    threaded && !pthread_create(&output->thread, NULL, sord_output_run, output);
+#else
+  (void)threaded;
+#endif
+
+  return output;
+}
+
+void
+sord_output_free(SordOutput* output)
+{
+  if (!output) {
+    return;
+  }
+
+#if USE_PTHREAD
+  if (output->threaded) {
+    pthread_mutex_lock(&output->mutex);
+    output->stopped = true;
+    pthread_cond_broadcast(&output->cond);
+    pthread_mutex_unlock(&output->mutex);
+    pthread_join(output->thread, NULL);
+  }
+
+  pthread_cond_destroy(&output->cond);
+  pthread_mutex_destroy(&output->mutex);
+#endif
+
+  free(output->blocks);
+  free(output);
+}
+
+/// Pass the current block along, then wait until the next one is free
+static void
+sord_output_submit(SordOutput* const output)
+{
+#if USE_PTHREAD
+  if (output->threaded) {
+    pthread_mutex_lock(&output->mutex);
+    ++output->n_filled;
+    pthread_cond_broadcast(&output->cond);
+    while (output->n_filled - output->n_written == SORD_OUTPUT_N_BLOCKS) {
+      pthread_cond_wait(&output->cond, &output->mutex);
+    }
+    output->failed = output->thread_failed;
+    pthread_mutex_unlock(&output->mutex);
+
+    output->lens[output->n_filled % SORD_OUTPUT_N_BLOCKS] = 0u;
+    return;
+  }
+#endif
+
+  if (++output->n_filled - output->n_written == SORD_OUTPUT_N_BLOCKS) {
+    output->failed = output->failed ||
+                     !sord_output_write_blocks(
+                       output, output->n_written, output->n_filled, NULL, 0u);
+    output->n_written = output->n_filled;
+  }
+
+  output->lens[output->n_filled % SORD_OUTPUT_N_BLOCKS] = 0u;
+}
+
+size_t
+sord_output_write(const void* buf, size_t len, SordOutput* output)
+{
+#if USE_PTHREAD
+  const bool threaded = output->threaded;
+#else
+  const bool threaded = false;
+#endif
+
+  if (!threaded && len >= output->block_size) {
+    // Write a large piece directly, after everything buffered before it
+    if (output->lens[output->n_filled % SORD_OUTPUT_N_BLOCKS]) {
+      ++output->n_filled;
+    }
+
+    output->failed =
+      output->failed ||
+      !sord_output_write_blocks(
+        output, output->n_written, output->n_filled, (const uint8_t*)buf, len);
+
+    output->n_written = output->n_filled;
+    output->lens[output->n_filled % SORD_OUTPUT_N_BLOCKS] = 0u;
+    return output->failed ? 0u : len;
+  }
+
+  const uint8_t* ptr       = (const uint8_t*)buf;
+  size_t         remaining = len;
+  while (remaining && !output->failed) {
+    const size_t b     = output->n_filled % SORD_OUTPUT_N_BLOCKS;
+    uint8_t*     block = output->blocks + b * output->block_size;
+    const size_t space = output->block_size - output->lens[b];
+    const size_t n     = (remaining < space) ? remaining : space;
+
+    memcpy(block + output->lens[b], ptr, n);
+    output->lens[b] += n;
+    ptr += n;
+    remaining -= n;
+
+    if (output->lens[b] == output->block_size) {
+      sord_output_submit(output);
+    }
+  }
+
+  return output->failed ? 0u : len;
+}
+
+SerdStatus
+sord_output_flush(SordOutput* output)
+{
+  const size_t i = output->n_filled % SORD_OUTPUT_N_BLOCKS;
+  if (output->lens[i]) {
+    sord_output_submit(output);
+  }
+
+#if USE_PTHREAD
+  if (output->threaded) {
+    pthread_mutex_lock(&output->mutex);
+    while (output->n_written != output->n_filled) {
+      pthread_cond_wait(&output->cond, &output->mutex);
+    }
+    output->failed = output->thread_failed;
+    pthread_mutex_unlock(&output->mutex);
+  }
+#endif
+
+  if (output->n_written != output->n_filled) {
+    output->failed = output->failed ||
+                     !sord_output_write_blocks(
+                       output, output->n_written, output->n_filled, NULL, 0u);
+    output->n_written = output->n_filled;
+  }
+
+  return output->failed ? SERD_ERR_UNKNOWN : SERD_SUCCESS;
+}
@@ -42,6 +42,15 @@
 #  define SORD_LOG_FUNC(fmt, arg1)
 #endif
 
+/* Iterators on a model may be created by several threads at once when
+   writing in parallel, so the count of live iterators is atomic. */
+#ifdef __GNUC__
+#  define SORD_COUNT_ITER(count, delta) \
+    __atomic_fetch_add(&(count), (delta), __ATOMIC_RELAXED)
+#else
+#  define SORD_COUNT_ITER(count, delta) ((count) += (delta))
+#endif
+
 #define SORD_LOG(prefix, ...) fprintf(stderr, "[Sord::" prefix "] " __VA_ARGS__)
 
 #ifdef SORD_DEBUG_ITER
@@ -74,6 +83,9 @@
 
 #define TUP_G 3
 
+/// Number of nodes hashed before any are inserted by sord_world_intern_batch()
+#define SORD_INTERN_BATCH_SIZE 32u
+
 /** Triple ordering */
 typedef enum {
   SPO,  ///<         Subject,   Predicate, Object
@@ -125,11 +137,21 @@ static const int orderings[NUM_ORDERS][TUP_LEN] = {
   {3, 1, 2, 0}  // GPOS
 };
 
+/** Growable string buffer */
+typedef struct {
+  uint8_t* buf;  ///< String, always null terminated if size is non-zero
+  size_t   len;  ///< Length of string in bytes
+  size_t   size; ///< Allocated size of buf in bytes
+} SordBuffer;
+
 /** World */
 struct SordWorldImpl {
   ZixHash*      nodes;
   SerdErrorSink error_sink;
   void*         error_handle;
+  size_t        n_orphans;    ///< Number of unreferenced nodes still interned
+  size_t        orphan_limit; ///< Maximum n_orphans before collection
+  SordBuffer    scratch;      ///< Reused buffer for building node strings
 };
 
 /** Store */
@@ -143,6 +165,7 @@ struct SordModelImpl {
 
   size_t n_quads;
   size_t n_iters;
+  size_t n_removals; ///< Number of quads ever removed
 };
 
 /** Mode for searching or iteration */
@@ -166,11 +189,11 @@ struct SordIterImpl {
   bool             skip_graphs; ///< Iteration should ignore graphs
 };
 
-static uint32_t
+static ZixHashCode
 sord_node_hash(const void* n)
 {
   const SordNode* node = (const SordNode*)n;
-  uint32_t        hash = zix_digest_start();
+  ZixHashCode     hash = zix_digest_start();
   hash = zix_digest_add(hash, node->node.buf, node->node.n_bytes);
   hash = zix_digest_add(hash, &node->node.type, sizeof(node->node.type));
   if (node->node.type == SERD_LITERAL) {
@@ -216,6 +239,9 @@ sord_world_new(void)
   SordWorld* world    = (SordWorld*)malloc(sizeof(SordWorld));
   world->error_sink   = NULL;
   world->error_handle = NULL;
+  world->n_orphans    = 0;
+  world->orphan_limit = 0;
+  memset(&world->scratch, 0, sizeof(world->scratch));
 
   world->nodes =
     zix_hash_new(sord_node_hash, sord_node_hash_equal, sizeof(SordNode));
@@ -236,8 +262,12 @@ free_node_entry(void* value, void* user_data)
 void
 sord_world_free(SordWorld* world)
 {
+  // Orphan any nodes released while freeing so the hash is never modified
+  world->orphan_limit = SIZE_MAX;
+
   zix_hash_foreach(world->nodes, free_node_entry, world);
   zix_hash_free(world->nodes);
+  free(world->scratch.buf);
   free(world);
 }
 
@@ -476,7 +506,7 @@ sord_iter_new(const SordModel* sord,
                 iter->skip_graphs);
 #endif
 
-  ++((SordModel*)sord)->n_iters;
+  SORD_COUNT_ITER(((SordModel*)sord)->n_iters, 1u);
   return iter;
 }
 
@@ -582,7 +612,7 @@ sord_iter_free(SordIter* iter)
 {
   SORD_ITER_LOG("%p Free\n", (void*)iter);
   if (iter) {
-    --((SordModel*)iter->sord)->n_iters;
+    SORD_COUNT_ITER(((SordModel*)iter->sord)->n_iters, (size_t)-1);
     zix_btree_iter_free(iter->cur);
     free(iter);
   }
@@ -748,6 +778,61 @@ sord_node_free_internal(SordWorld* world, SordNode* node)
   free((uint8_t*)buf);
 }
 
+static void
+collect_orphan(void* value, void* user_data)
+{
+  SordNode*   node = (SordNode*)value;
+  SordNode*** tail = (SordNode***)user_data;
+  if (node->refs == 0) {
+    *(*tail)++ = node;
+  }
+}
+
+size_t
+sord_world_collect(SordWorld* world)
+{
+  const size_t n_orphans = world->n_orphans;
+  if (!n_orphans) {
+    return 0;
+  }
+
+  // Gather orphans first, since the hash can not be modified while visiting
+  SordNode** orphans = (SordNode**)malloc(n_orphans * sizeof(SordNode*));
+  SordNode** tail    = orphans;
+  zix_hash_foreach(world->nodes, collect_orphan, &tail);
+  assert((size_t)(tail - orphans) == n_orphans);
+
+  for (SordNode** o = orphans; o < tail; ++o) {
+    sord_node_free_internal(world, *o);
+  }
+
+  free(orphans);
+  world->n_orphans = 0;
+  return n_orphans;
+}
+
+void
+sord_world_set_orphan_limit(SordWorld* world, size_t limit)
+{
+  world->orphan_limit = limit;
+  if (world->n_orphans > limit) {
+    sord_world_collect(world);
+  }
+}
+
+/// Handle the last reference to `node` being dropped
+static void
+sord_node_orphan(SordWorld* world, SordNode* node)
+{
+  assert(node->refs == 0);
+
+  if (!world->orphan_limit) {
+    sord_node_free_internal(world, node);
+  } else if (++world->n_orphans > world->orphan_limit) {
+    sord_world_collect(world);
+  }
+}
+
 static void
 sord_add_quad_ref(SordModel* model, const SordNode* node, SordQuadIndex i)
 {
@@ -773,7 +858,7 @@ sord_drop_quad_ref(SordModel* model, const SordNode* node, SordQuadIndex i)
     --((SordNode*)node)->meta.res.refs_as_obj;
   }
   if (--((SordNode*)node)->refs == 0) {
-    sord_node_free_internal(sord_get_world(model), (SordNode*)node);
+    sord_node_orphan(sord_get_world(model), (SordNode*)node);
   }
 }
 
@@ -824,10 +909,57 @@ sord_num_quads(const SordModel* model)
   return model->n_quads;
 }
 
+size_t
+sord_num_removals(const SordModel* model)
+{
+  return model->n_removals;
+}
+
 size_t
 sord_num_nodes(const SordWorld* world)
 {
-  return zix_hash_size(world->nodes);
+  return zix_hash_size(world->nodes) - world->n_orphans;
+}
+
+static void
+sord_count_node_bytes(void* value, void* user_data)
+{
+  *(size_t*)user_data += ((const SordNode*)value)->node.n_bytes + 1u;
+}
+
+size_t
+sord_num_node_bytes(const SordWorld* world)
+{
+  size_t n_bytes = zix_hash_num_bytes(world->nodes);
+  zix_hash_foreach(world->nodes, sord_count_node_bytes, &n_bytes);
+  return n_bytes;
+}
+
+bool
+sord_index_stats(const SordModel* model,
+                 SordIndexOption  index,
+                 bool             graphs,
+                 SordIndexStats*  stats)
+{
+  for (unsigned i = 0u; i < (NUM_ORDERS / 2); ++i) {
+    if (index == (SordIndexOption)(1u << i)) {
+      const ZixBTree* const db =
+        model->indices[graphs ? i + (NUM_ORDERS / 2) : i];
+      if (!db) {
+        return false;
+      }
+
+      const ZixBTreeStats tree = zix_btree_stats(db);
+
+      stats->n_pages = tree.n_pages;
+      stats->n_bytes = tree.n_pages * tree.page_size;
+      stats->fill =
+        tree.n_slots ? (double)model->n_quads / (double)tree.n_slots : 0.0;
+      return true;
+    }
+  }
+
+  return false;
 }
 
 SordIter*
@@ -842,6 +974,63 @@ sord_begin(const SordModel* model)
   }
 }
 
+SordIter*
+sord_begin_blank_subjects(const SordModel* model)
+{
+  // Blank nodes sort after other types, and "" before any other blank node
+  SordNode key;
+  memset(&key, 0, sizeof(key));
+  key.node.type = SERD_BLANK;
+  key.node.buf  = (const uint8_t*)"";
+
+  ZixBTree* const db  = model->indices[DEFAULT_ORDER];
+  const SordQuad  pat = {&key, NULL, NULL, NULL};
+  ZixBTreeIter*   cur = NULL;
+  zix_btree_lower_bound(db, pat, &cur);
+  if (zix_btree_iter_is_end(cur)) {
+    zix_btree_iter_free(cur);
+    return NULL;
+  }
+
+  const SordQuad wildcard = {NULL, NULL, NULL, NULL};
+  return sord_iter_new(model, cur, wildcard, DEFAULT_ORDER, ALL, 0);
+}
+
+size_t
+sord_split(const SordModel* model, size_t n, SordIter** iters)
+{
+  SordIter* const begin = sord_begin(model);
+  if (!begin || !n) {
+    sord_iter_free(begin);
+    return 0u;
+  }
+
+  ZixBTree* const db        = model->indices[DEFAULT_ORDER];
+  void** const    samples   = (void**)malloc(n * sizeof(void*));
+  const size_t    n_samples = zix_btree_sample(db, n - 1u, samples);
+  const SordQuad  wildcard  = {0, 0, 0, 0};
+
+  // Start a range at the first quad of each sampled subject
+  size_t          n_iters = 1u;
+  const SordNode* last    = sord_iter_get_node(begin, SORD_SUBJECT);
+  iters[0]                = begin;
+  for (size_t i = 0u; i < n_samples; ++i) {
+    const SordNode** const key     = (const SordNode**)samples[i];
+    const SordNode* const  subject = key[SORD_SUBJECT];
+    if (subject != last) {
+      const SordQuad pat = {subject, 0, 0, 0};
+      ZixBTreeIter*  cur = NULL;
+      zix_btree_lower_bound(db, pat, &cur);
+      iters[n_iters++] =
+        sord_iter_new(model, cur, wildcard, DEFAULT_ORDER, ALL, 0);
+      last = subject;
+    }
+  }
+
+  free(samples);
+  return n_iters;
+}
+
 SordIter*
 sord_find(SordModel* model, const SordQuad pat)
 {
@@ -1044,19 +1233,22 @@ sord_node_is_inline_object(const SordNode* node)
 }
 
 static SordNode*
-sord_insert_node(SordWorld* world, const SordNode* key, bool copy)
+sord_insert_node_prehashed(SordWorld*        world,
+                           const SordNode*   key,
+                           const ZixHashCode code)
 {
   SordNode* node = NULL;
-  ZixStatus st   = zix_hash_insert(world->nodes, key, (void**)&node);
+  ZixStatus st =
+    zix_hash_insert_prehashed(world->nodes, key, code, (void**)&node);
   switch (st) {
   case ZIX_STATUS_EXISTS:
-    ++node->refs;
+    if (node->refs++ == 0) {
+      --world->n_orphans; // Revived an orphan
+    }
     break;
   case ZIX_STATUS_SUCCESS:
     assert(node->refs == 1);
-    if (copy) {
-      node->node.buf = sord_strndup(node->node.buf, node->node.n_bytes);
-    }
+    node->node.buf = sord_strndup(node->node.buf, node->node.n_bytes);
     if (node->node.type == SERD_LITERAL) {
       node->meta.lit.datatype = sord_node_copy(node->meta.lit.datatype);
     }
@@ -1066,20 +1258,20 @@ sord_insert_node(SordWorld* world, const SordNode* key, bool copy)
       world, SERD_ERR_INTERNAL, "error inserting node `%s'\n", key->node.buf);
   }
 
-  if (!copy) {
-    // Free the buffer we would have copied if a new node was created
-    free((uint8_t*)key->node.buf);
-  }
-
   return node;
 }
 
+static SordNode*
+sord_insert_node(SordWorld* world, const SordNode* key)
+{
+  return sord_insert_node_prehashed(world, key, sord_node_hash(key));
+}
+
 static SordNode*
 sord_new_uri_counted(SordWorld*     world,
                      const uint8_t* str,
                      size_t         n_bytes,
-                     size_t         n_chars,
-                     bool           copy)
+                     size_t         n_chars)
 {
   if (!serd_uri_string_has_scheme(str)) {
     error(world, SERD_ERR_BAD_ARG, "attempt to map invalid URI `%s'\n", str);
@@ -1088,14 +1280,65 @@ sord_new_uri_counted(SordWorld*     world,
 
   const SordNode key = {{str, n_bytes, n_chars, 0, SERD_URI}, 1, {{0}}};
 
-  return sord_insert_node(world, &key, copy);
+  return sord_insert_node(world, &key);
 }
 
 SordNode*
 sord_new_uri(SordWorld* world, const uint8_t* uri)
 {
   const SerdNode node = serd_node_from_string(SERD_URI, uri);
-  return sord_new_uri_counted(world, uri, node.n_bytes, node.n_chars, true);
+  return sord_new_uri_counted(world, uri, node.n_bytes, node.n_chars);
+}
+
+/// Clear `buffer` and ensure it can hold a string of at least `len` bytes
+static void
+sord_buffer_reset(SordBuffer* buffer, size_t len)
+{
+  if (len >= buffer->size) {
+    buffer->size = (len + 1 > 2 * buffer->size) ? len + 1 : 2 * buffer->size;
+    buffer->buf  = (uint8_t*)realloc(buffer->buf, buffer->size);
+  }
+
+  buffer->len    = 0;
+  buffer->buf[0] = '\0';
+}
+
+/// Append to a buffer, compatible with SerdSink
+static size_t
+sord_buffer_append(const void* buf, size_t len, void* stream)
+{
+  SordBuffer* const buffer = (SordBuffer*)stream;
+  if (buffer->len + len >= buffer->size) {
+    const size_t old_len = buffer->len;
+    sord_buffer_reset(buffer, buffer->len + len);
+    buffer->len = old_len;
+  }
+
+  memcpy(buffer->buf + buffer->len, buf, len);
+  buffer->len += len;
+  buffer->buf[buffer->len] = '\0';
+  return len;
+}
+
+/// Get a URI node by resolving `str` against `base` in the scratch buffer
+static SordNode*
+sord_new_resolved_uri(SordWorld* world, const uint8_t* str, const SerdURI* base)
+{
+  SerdURI abs_uri = *base;
+  if (str[0]) {
+    SerdURI uri;
+    serd_uri_parse(str, &uri);
+    serd_uri_resolve(&uri, base, &abs_uri);
+  }
+
+  SordBuffer* const scratch = &world->scratch;
+  sord_buffer_reset(scratch, 0);
+  serd_uri_serialise(&abs_uri, sord_buffer_append, scratch);
+
+  return sord_new_uri_counted(world,
+                              scratch->buf,
+                              scratch->len,
+                              serd_strlen(scratch->buf, NULL, NULL));
 }
 
 SordNode*
@@ -1106,15 +1349,10 @@ sord_new_relative_uri(SordWorld*     world,
   if (serd_uri_string_has_scheme(uri)) {
     return sord_new_uri(world, uri);
   }
-  SerdURI  buri = SERD_URI_NULL;
-  SerdNode base = serd_node_new_uri_from_string(base_uri, NULL, &buri);
-  SerdNode node = serd_node_new_uri_from_string(uri, &buri, NULL);
-
-  SordNode* ret =
-    sord_new_uri_counted(world, node.buf, node.n_bytes, node.n_chars, false);
 
-  serd_node_free(&base);
-  return ret;
+  SerdURI buri = SERD_URI_NULL;
+  serd_uri_parse(base_uri, &buri);
+  return sord_new_resolved_uri(world, uri, &buri);
 }
 
 static SordNode*
@@ -1125,7 +1363,7 @@ sord_new_blank_counted(SordWorld*     world,
 {
   const SordNode key = {{str, n_bytes, n_chars, 0, SERD_BLANK}, 1, {{0}}};
 
-  return sord_insert_node(world, &key, true);
+  return sord_insert_node(world, &key);
 }
 
 SordNode*
@@ -1151,7 +1389,7 @@ sord_new_literal_counted(SordWorld*     world,
     strncpy(key.meta.lit.lang, lang, sizeof(key.meta.lit.lang) - 1);
   }
 
-  return sord_insert_node(world, &key, true);
+  return sord_insert_node(world, &key);
 }
 
 SordNode*
@@ -1167,6 +1405,119 @@ sord_new_literal(SordWorld*     world,
     world, datatype, str, n_bytes, n_chars, flags, lang);
 }
 
+size_t
+sord_world_intern_batch(SordWorld*            world,
+                        const SordNodeType    type,
+                        const SordNode*       datatype,
+                        const char*           lang,
+                        const size_t          n_strings,
+                        const uint8_t* const* strings,
+                        SordNode**            nodes)
+{
+  static const SerdType serd_types[] = {SERD_NOTHING,
+                                        SERD_URI,
+                                        SERD_BLANK,
+                                        SERD_LITERAL};
+
+  SordNode    keys[SORD_INTERN_BATCH_SIZE];
+  ZixHashCode codes[SORD_INTERN_BATCH_SIZE];
+  size_t      n_interned = 0;
+
+  for (size_t b = 0; b < n_strings; b += SORD_INTERN_BATCH_SIZE) {
+    const size_t n = (n_strings - b < SORD_INTERN_BATCH_SIZE)
+                       ? n_strings - b
+                       : SORD_INTERN_BATCH_SIZE;
+
+    // Measure and hash every key first, prefetching each bucket
+    for (size_t i = 0; i < n; ++i) {
+      SordNode* const key = &keys[i];
+
+      key->node = serd_node_from_string(serd_types[type], strings[b + i]);
+      key->refs = 1;
+      memset(&key->meta, 0, sizeof(key->meta));
+      if (type == SORD_LITERAL) {
+        key->meta.lit.datatype = (SordNode*)datatype;
+        if (lang) {
+          strncpy(key->meta.lit.lang, lang, sizeof(key->meta.lit.lang) - 1);
+        }
+      } else if (type == SORD_URI &&
+                 !serd_uri_string_has_scheme(key->node.buf)) {
+        error(world,
+              SERD_ERR_BAD_ARG,
+              "attempt to map invalid URI `%s'\n",
+              key->node.buf);
+        key->node.type = SERD_NOTHING;
+        continue;
+      }
+
+      codes[i] = sord_node_hash(key);
+      zix_hash_prefetch(world->nodes, codes[i]);
+    }
+
+    // By now the buckets are likely cached, so prefetch the entries in them
+    for (size_t i = 0; i < n; ++i) {
+      if (keys[i].node.type) {
+        zix_hash_prefetch_entry(world->nodes, codes[i]);
+      }
+    }
+
+    // Finally, resolve or insert each node
+    for (size_t i = 0; i < n; ++i) {
+      if (keys[i].node.type) {
+        nodes[b + i] =
+          sord_insert_node_prehashed(world, &keys[i], codes[i]);
+        n_interned += !!nodes[b + i];
+      } else {
+        nodes[b + i] = NULL;
+      }
+    }
+  }
+
+  return n_interned;
+}
+
+static const SordNode*
+sord_find_node(const SordWorld* world, const SordNode* key)
+{
+  const SordNode* node = (const SordNode*)zix_hash_find(world->nodes, key);
+
+  return (node && node->refs) ? node : NULL;
+}
+
+const SordNode*
+sord_world_find_uri(const SordWorld* world, const uint8_t* uri)
+{
+  const SerdNode node = serd_node_from_string(SERD_URI, uri);
+  const SordNode key  = {node, 0, {{0}}};
+
+  return sord_find_node(world, &key);
+}
+
+const SordNode*
+sord_world_find_blank(const SordWorld* world, const uint8_t* str)
+{
+  const SerdNode node = serd_node_from_string(SERD_BLANK, str);
+  const SordNode key  = {node, 0, {{0}}};
+
+  return sord_find_node(world, &key);
+}
+
+const SordNode*
+sord_world_find_literal(const SordWorld* world,
+                        const SordNode*  datatype,
+                        const uint8_t*   str,
+                        const char*      lang)
+{
+  SordNode key = {serd_node_from_string(SERD_LITERAL, str), 0, {{0}}};
+  key.meta.lit.datatype = (SordNode*)datatype;
+  memset(key.meta.lit.lang, 0, sizeof(key.meta.lit.lang));
+  if (lang) {
+    strncpy(key.meta.lit.lang, lang, sizeof(key.meta.lit.lang) - 1);
+  }
+
+  return sord_find_node(world, &key);
+}
+
 SordNode*
 sord_node_from_serd_node(SordWorld*      world,
                          SerdEnv*        env,
@@ -1197,20 +1548,11 @@ sord_node_from_serd_node(SordWorld*      world,
   case SERD_URI:
     if (serd_uri_string_has_scheme(node->buf)) {
       return sord_new_uri_counted(
-        world, node->buf, node->n_bytes, node->n_chars, true);
+        world, node->buf, node->n_bytes, node->n_chars);
     } else {
       SerdURI base_uri;
       serd_env_get_base_uri(env, &base_uri);
-      SerdURI  abs_uri;
-      SerdNode abs_uri_node =
-        serd_node_new_uri_from_node(node, &base_uri, &abs_uri);
-      ret = sord_new_uri_counted(world,
-                                 abs_uri_node.buf,
-                                 abs_uri_node.n_bytes,
-                                 abs_uri_node.n_chars,
-                                 true);
-      serd_node_free(&abs_uri_node);
-      return ret;
+      return sord_new_resolved_uri(world, node->buf, &base_uri);
     }
   case SERD_CURIE: {
     SerdChunk uri_prefix;
@@ -1220,14 +1562,15 @@ sord_node_from_serd_node(SordWorld*      world,
         world, SERD_ERR_BAD_CURIE, "failed to expand CURIE `%s'\n", node->buf);
       return NULL;
     }
-    const size_t uri_len = uri_prefix.len + uri_suffix.len;
-    uint8_t*     buf     = (uint8_t*)malloc(uri_len + 1);
-    memcpy(buf, uri_prefix.buf, uri_prefix.len);
-    memcpy(buf + uri_prefix.len, uri_suffix.buf, uri_suffix.len);
-    buf[uri_len] = '\0';
-    ret          = sord_new_uri_counted(
-      world, buf, uri_len, serd_strlen(buf, NULL, NULL), false);
-    return ret;
+    // Build the expanded URI in the scratch buffer, which is copied if new
+    SordBuffer* const scratch = &world->scratch;
+    sord_buffer_reset(scratch, uri_prefix.len + uri_suffix.len);
+    sord_buffer_append(uri_prefix.buf, uri_prefix.len, scratch);
+    sord_buffer_append(uri_suffix.buf, uri_suffix.len, scratch);
+    return sord_new_uri_counted(world,
+                                scratch->buf,
+                                scratch->len,
+                                serd_strlen(scratch->buf, NULL, NULL));
   }
   case SERD_BLANK:
     return sord_new_blank_counted(
@@ -1250,7 +1593,7 @@ sord_node_free(SordWorld* world, SordNode* node)
   } else if (node->refs == 0) {
     error(world, SERD_ERR_BAD_ARG, "attempt to free garbage node\n");
   } else if (--node->refs == 0) {
-    sord_node_free_internal(world, node);
+    sord_node_orphan(world, node);
   }
 }
 
@@ -1328,6 +1671,7 @@ sord_remove(SordModel* model, const SordQuad tup)
   }
 
   --model->n_quads;
+  ++model->n_removals;
 }
 
 SerdStatus
@@ -1364,5 +1708,6 @@ sord_erase(SordModel* model, SordIter* iter)
   }
 
   --model->n_quads;
+  ++model->n_removals;
   return SERD_SUCCESS;
 }
@@ -33,6 +33,51 @@
 
 #if !defined(SORD_NO_DEFAULT_CONFIG)
 
+// POSIX.1-2001: mmap()
+#  ifndef HAVE_MMAP
+#    ifdef __has_include
+#      if __has_include(<sys/mman.h>)
+#        define HAVE_MMAP 1
+#      endif
+#    endif
+#  endif
+
+// POSIX.1-2001: writev()
+#  ifndef HAVE_WRITEV
+#    ifdef __has_include
+#      if __has_include(<sys/uio.h>)
+#        define HAVE_WRITEV 1
+#      endif
+#    endif
+#  endif
+
+// POSIX.1-2001: clock_gettime()
+#  ifndef HAVE_CLOCK_GETTIME
+#    ifdef __has_include
+#      if __has_include(<unistd.h>)
+#        define HAVE_CLOCK_GETTIME 1
+#      endif
+#    endif
+#  endif
+
+// POSIX.1-2001: getrusage()
+#  ifndef HAVE_GETRUSAGE
+#    ifdef __has_include
+#      if __has_include(<sys/resource.h>)
+#        define HAVE_GETRUSAGE 1
+#      endif
+#    endif
+#  endif
+
+// POSIX.1-2001: mkstemp()
+#  ifndef HAVE_MKSTEMP
+#    ifdef __has_include
+#      if __has_include(<unistd.h>)
+#        define HAVE_MKSTEMP 1
+#      endif
+#    endif
+#  endif
+
 // The validator uses PCRE for literal pattern matching
 #  ifndef HAVE_PCRE
 #    ifdef __has_include
@@ -42,6 +87,33 @@
 #    endif
 #  endif
 
+// POSIX threads are used for loading in parallel
+#  ifndef HAVE_PTHREAD
+#    ifdef __has_include
+#      if __has_include(<pthread.h>)
+#        define HAVE_PTHREAD 1
+#      endif
+#    endif
+#  endif
+
+// zlib is used for reading and writing gzip compressed files
+#  ifndef HAVE_ZLIB
+#    ifdef __has_include
+#      if __has_include(<zlib.h>)
+#        define HAVE_ZLIB 1
+#      endif
+#    endif
+#  endif
+
+// libzstd is used for reading and writing zstd compressed files
+#  ifndef HAVE_ZSTD
+#    ifdef __has_include
+#      if __has_include(<zstd.h>)
+#        define HAVE_ZSTD 1
+#      endif
+#    endif
+#  endif
+
 #endif // !defined(SORD_NO_DEFAULT_CONFIG)
 
 /*
@@ -52,10 +124,58 @@
   if the build system defines them all.
 */
 
+#ifdef HAVE_MMAP
+#  define USE_MMAP 1
+#else
+#  define USE_MMAP 0
+#endif
+
+#ifdef HAVE_WRITEV
+#  define USE_WRITEV 1
+#else
+#  define USE_WRITEV 0
+#endif
+
+#ifdef HAVE_CLOCK_GETTIME
+#  define USE_CLOCK_GETTIME 1
+#else
+#  define USE_CLOCK_GETTIME 0
+#endif
+
+#ifdef HAVE_GETRUSAGE
+#  define USE_GETRUSAGE 1
+#else
+#  define USE_GETRUSAGE 0
+#endif
+
+#ifdef HAVE_MKSTEMP
+#  define USE_MKSTEMP 1
+#else
+#  define USE_MKSTEMP 0
+#endif
+
 #ifdef HAVE_PCRE
 #  define USE_PCRE 1
 #else
 #  define USE_PCRE 0
 #endif
 
+#ifdef HAVE_PTHREAD
+#  define USE_PTHREAD 1
+#else
+#  define USE_PTHREAD 0
+#endif
+
+#ifdef HAVE_ZLIB
+#  define USE_ZLIB 1
+#else
+#  define USE_ZLIB 0
+#endif
+
+#ifdef HAVE_ZSTD
+#  define USE_ZSTD 1
+#else
+#  define USE_ZSTD 0
+#endif
+
 #endif // SORD_CONFIG_H
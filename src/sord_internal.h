@@ -50,4 +50,28 @@ struct SordNodeImpl {
   } meta;
 };
 
+/**
+   Return an iterator to the first quad with a blank subject.
+
+   Blank nodes sort after URIs, so the quads with blank subjects are at the
+   end of the model, and the returned iterator continues to the end.
+
+   @return A new iterator, or NULL if no subject is a blank node.
+*/
+SordIter*
+sord_begin_blank_subjects(const SordModel* model);
+
+/**
+   Return the number of quads ever removed from `model`.
+
+   Nodes may be freed when quads are removed, so this can be used to check
+   that borrowed nodes are still alive.
+*/
+size_t
+sord_num_removals(const SordModel* model);
+
+/// Return the number of threads to use by default, one per processor
+unsigned
+sord_default_n_threads(void);
+
 #endif /* SORD_SORD_INTERNAL_H */
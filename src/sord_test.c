@@ -369,6 +369,648 @@ test_read(SordWorld* world, SordModel* sord, SordNode* g, const size_t n_quads)
   return ret;
 }
 
+static int
+test_read_file(SordWorld*       world,
+               const SerdSyntax syntax,
+               const unsigned   n_threads)
+{
+  static const char* const path    = "sord_test_read_file.in";
+  static const unsigned    n_lines = 8192;
+
+  // Write a file large enough to be split into several chunks or batches
+  FILE* const fd = fopen(path, "w");
+  if (!fd) {
+    return test_fail("Failed to open %s\n", path);
+  }
+  for (unsigned i = 0; i < n_lines; ++i) {
+    if (syntax == SERD_TURTLE && i % 1024 == 0) {
+      // Change prefixes throughout so batches must be expanded in order
+      fprintf(fd, "@prefix eg: <http://example.org/%u/> .\n", i);
+      fprintf(fd, "@base <http://example.org/base%u/> .\n", i);
+    }
+
+    if (syntax == SERD_TURTLE) {
+      fprintf(fd, "<s%u> eg:p%u ", i % 7, i % 3);
+    } else {
+      fprintf(fd, "_:b%u <http://example.org/p%u> ", i % 7, i % 3);
+    }
+
+    if (i % 2) {
+      fprintf(fd, "\"%u\"@en .\n", i);
+    } else {
+      fprintf(fd, "\"%u\"^^<http://example.org/type> .\n", i);
+    }
+  }
+  fclose(fd);
+
+  SordNode*  g        = sord_new_uri(world, USTR("http://example.org/g"));
+  SordModel* serial   = sord_new(world, SORD_SPO, true);
+  SordModel* parallel = sord_new(world, SORD_SPO, true);
+  SerdEnv*   env      = serd_env_new(NULL);
+  SerdStatus st       = sord_read_file(serial, env, syntax, USTR(path), g, 1);
+  if (!st) {
+    st = sord_read_file(parallel, env, syntax, USTR(path), g, n_threads);
+  }
+  serd_env_free(env);
+  remove(path);
+
+  if (st) {
+    return test_fail("Failed to read file (%s)\n", serd_strerror(st));
+  } else if (sord_num_quads(serial) != n_lines ||
+             sord_num_quads(parallel) != n_lines) {
+    return test_fail("Read %zu statements serially and %zu in parallel\n",
+                     sord_num_quads(serial),
+                     sord_num_quads(parallel));
+  }
+
+  // Check both models contain the same statements
+  SordIter* iter = sord_begin(serial);
+  for (; !sord_iter_end(iter); sord_iter_next(iter)) {
+    SordQuad tup;
+    sord_iter_get(iter, tup);
+    if (tup[SORD_GRAPH] != g || !sord_contains(parallel, tup)) {
+      return test_fail("Statement read in parallel differs\n");
+    }
+  }
+  sord_iter_free(iter);
+
+  sord_free(parallel);
+  sord_free(serial);
+  sord_node_free(world, g);
+  return 0;
+}
+
+static int
+test_read_files(SordWorld* world)
+{
+  static const char* const paths[] = {"sord_test_read_files1.ttl",
+                                      "sord_test_read_files2.ttl"};
+
+  // Write files that use the same blank label and prefix for different things
+  for (unsigned i = 0; i < 2; ++i) {
+    FILE* const fd = fopen(paths[i], "w");
+    if (!fd) {
+      return test_fail("Failed to open %s\n", paths[i]);
+    }
+
+    fprintf(fd, "@prefix eg: <http://example.org/%u/> .\n", i);
+    fprintf(fd, "_:b eg:p <file> .\n");
+    fclose(fd);
+  }
+
+  const uint8_t* const uris[] = {USTR(paths[0]), USTR(paths[1])};
+  SerdStatus           statuses[2];
+  SordModel* const     model = sord_new(world, SORD_SPO, false);
+  const SerdStatus     st =
+    sord_read_files(model, SERD_TURTLE, 2, uris, NULL, 2, statuses);
+
+  remove(paths[0]);
+  remove(paths[1]);
+
+  if (st || statuses[0] || statuses[1]) {
+    return test_fail("Failed to read files (%s)\n", serd_strerror(st));
+  } else if (sord_num_quads(model) != 2) {
+    return test_fail("Read %zu statements from files\n",
+                     sord_num_quads(model));
+  }
+
+  SordIter* const iter = sord_begin(model);
+  const SordNode* s1   = sord_iter_get_node(iter, SORD_SUBJECT);
+  const SordNode* p1   = sord_iter_get_node(iter, SORD_PREDICATE);
+  const SordNode* o1   = sord_iter_get_node(iter, SORD_OBJECT);
+  sord_iter_next(iter);
+  const SordNode* s2 = sord_iter_get_node(iter, SORD_SUBJECT);
+  const SordNode* p2 = sord_iter_get_node(iter, SORD_PREDICATE);
+  const SordNode* o2 = sord_iter_get_node(iter, SORD_OBJECT);
+  if (s1 == s2 || p1 == p2 || o1 == o2) {
+    return test_fail("Files were not read as separate documents\n");
+  }
+  sord_iter_free(iter);
+
+  sord_free(model);
+  return 0;
+}
+
+typedef struct {
+  char   buf[256];
+  size_t len;
+} TestOutput;
+
+static size_t
+test_output_sink(const void* buf, size_t len, void* stream)
+{
+  TestOutput* const output = (TestOutput*)stream;
+  if (output->len + len >= sizeof(output->buf)) {
+    return 0;
+  }
+
+  memcpy(output->buf + output->len, buf, len);
+  output->len += len;
+  output->buf[output->len] = '\0';
+  return len;
+}
+
+static int
+test_sorter(void)
+{
+  static const char* const subjects[] = {"http://example.org/c",
+                                         "http://example.org/a",
+                                         "http://example.org/c",
+                                         "http://example.org/b",
+                                         "http://example.org/a"};
+
+  const SerdNode p = serd_node_from_string(SERD_URI, USTR("http://x.org/p"));
+  const SerdNode o = serd_node_from_string(SERD_LITERAL, USTR("o"));
+
+  SerdEnv* const    env    = serd_env_new(NULL);
+  SordSorter* const sorter = sord_sorter_new(env, SERD_NTRIPLES, 0);
+
+  if (sord_sorter_new(env, SERD_TURTLE, 0)) {
+    return test_fail("Created sorter for Turtle\n");
+  }
+
+  for (unsigned i = 0; i < 5; ++i) {
+    const SerdNode s = serd_node_from_string(SERD_URI, USTR(subjects[i]));
+    sord_sorter_write_statement(sorter, 0, NULL, &s, &p, &o, NULL, NULL);
+  }
+
+  TestOutput       output = {{0}, 0};
+  const SerdStatus st = sord_sorter_finish(sorter, test_output_sink, &output);
+  sord_sorter_free(sorter);
+  serd_env_free(env);
+
+  if (st) {
+    return test_fail("Failed to sort (%s)\n", serd_strerror(st));
+  } else if (strcmp(output.buf,
+                    "<http://example.org/a> <http://x.org/p> \"o\" .\n"
+                    "<http://example.org/b> <http://x.org/p> \"o\" .\n"
+                    "<http://example.org/c> <http://x.org/p> \"o\" .\n")) {
+    return test_fail("Bad sorted output:\n%s", output.buf);
+  }
+
+  return 0;
+}
+
+typedef struct {
+  char   last[64]; ///< Last line written
+  size_t n_lines;  ///< Number of lines written
+  bool   sorted;   ///< True if every line was greater than the last
+} TestSortedOutput;
+
+static size_t
+test_sorted_sink(const void* buf, size_t len, void* stream)
+{
+  TestSortedOutput* const output = (TestSortedOutput*)stream;
+  const size_t            n      = len < 63u ? len : 63u;
+
+  if (output->n_lines++ && strncmp((const char*)buf, output->last, n) <= 0) {
+    output->sorted = false;
+  }
+
+  memcpy(output->last, buf, n);
+  output->last[n] = '\0';
+  return len;
+}
+
+static int
+test_sorter_many_runs(void)
+{
+  // Enough statements for hundreds of runs, so they must be merged early
+  static const unsigned n_statements = 1u << 19u;
+
+  const SerdNode p = serd_node_from_string(SERD_URI, USTR("http://x.org/p"));
+  const SerdNode o = serd_node_from_string(SERD_LITERAL, USTR("o"));
+
+  SerdEnv* const    env    = serd_env_new(NULL);
+  SordSorter* const sorter = sord_sorter_new(env, SERD_NTRIPLES, 0);
+
+  sord_sorter_set_directory(sorter, ".");
+  for (unsigned i = 0u; i < n_statements; ++i) {
+    char str[32];
+    snprintf(str, sizeof(str), "http://x.org/s%u", (i * 7919u) % n_statements);
+
+    const SerdNode s = serd_node_from_string(SERD_URI, USTR(str));
+    sord_sorter_write_statement(sorter, 0, NULL, &s, &p, &o, NULL, NULL);
+  }
+
+  TestSortedOutput output = {{0}, 0u, true};
+  const SerdStatus st = sord_sorter_finish(sorter, test_sorted_sink, &output);
+  sord_sorter_free(sorter);
+  serd_env_free(env);
+
+  if (st) {
+    return test_fail("Failed to sort many runs (%s)\n", serd_strerror(st));
+  } else if (output.n_lines != n_statements || !output.sorted) {
+    return test_fail("Sorted %zu of %u lines out of order\n",
+                     output.n_lines,
+                     n_statements);
+  }
+
+  return 0;
+}
+
+static int
+test_write_lines(SordWorld* world)
+{
+  SordModel* const model = sord_new(world, SORD_SPO, true);
+  SordNode* const  s     = sord_new_uri(world, USTR("http://x.org/s{}"));
+  SordNode* const  p     = sord_new_uri(world, USTR("http://x.org/p"));
+  SordNode* const  g     = sord_new_uri(world, USTR("http://x.org/g"));
+  SordNode* const  o     = sord_new_literal(
+    world, NULL, USTR("a \"quoted\"\nline\\ caf\xC3\xA9"), "fr");
+
+  const SordQuad tup = {s, p, o, g};
+  sord_add(model, tup);
+
+  TestOutput       output = {{0}, 0};
+  const SerdStatus st =
+    sord_write_lines(sord_begin(model), SERD_NQUADS, test_output_sink, &output);
+
+  sord_node_free(world, o);
+  sord_node_free(world, g);
+  sord_node_free(world, p);
+  sord_node_free(world, s);
+  sord_free(model);
+
+  if (st) {
+    return test_fail("Failed to write lines (%s)\n", serd_strerror(st));
+  } else if (strcmp(output.buf,
+                    "<http://x.org/s\\u007B\\u007D> <http://x.org/p> "
+                    "\"a \\\"quoted\\\"\\nline\\\\ caf\\u00E9\"@fr "
+                    "<http://x.org/g> .\n")) {
+    return test_fail("Bad line output:\n%s", output.buf);
+  }
+
+  return 0;
+}
+
+/// Return the number of times `needle` occurs in `haystack`
+static unsigned
+test_count_substrings(const char* haystack, const char* needle)
+{
+  unsigned n = 0u;
+  for (const char* s = haystack; (s = strstr(s, needle)); ++s) {
+    ++n;
+  }
+
+  return n;
+}
+
+static int
+test_write_abbreviated(SordWorld* world)
+{
+  SordModel* const model = sord_new(world, SORD_SPO, false);
+  SordNode* const  s     = sord_new_uri(world, USTR("http://x.org/s"));
+  SordNode* const  p     = sord_new_uri(world, USTR("http://x.org/p"));
+  SordNode* const  q     = sord_new_uri(world, USTR("http://x.org/q"));
+  SordNode* const  a     = sord_new_literal(world, NULL, USTR("a"), NULL);
+  SordNode* const  b     = sord_new_literal(world, NULL, USTR("b"), NULL);
+
+  const SordQuad tups[] = {{s, p, a, 0}, {s, p, b, 0}, {s, q, a, 0}};
+  for (unsigned i = 0u; i < 3u; ++i) {
+    sord_add(model, tups[i]);
+  }
+
+  TestOutput        output = {{0}, 0};
+  SerdEnv* const    env    = serd_env_new(NULL);
+  SerdWriter* const writer = serd_writer_new(SERD_TURTLE,
+                                             SERD_STYLE_ABBREVIATED,
+                                             env,
+                                             NULL,
+                                             test_output_sink,
+                                             &output);
+
+  const bool ok = sord_write(model, writer, NULL);
+  serd_writer_finish(writer);
+  serd_writer_free(writer);
+  serd_env_free(env);
+
+  sord_node_free(world, b);
+  sord_node_free(world, a);
+  sord_node_free(world, q);
+  sord_node_free(world, p);
+  sord_node_free(world, s);
+  sord_free(model);
+
+  // The subject and the repeated predicate should each be written once
+  if (!ok) {
+    return test_fail("Failed to write abbreviated Turtle\n");
+  } else if (test_count_substrings(output.buf, "<http://x.org/s>") != 1u ||
+             test_count_substrings(output.buf, "<http://x.org/p>") != 1u) {
+    return test_fail("Statements not abbreviated:\n%s", output.buf);
+  }
+
+  return 0;
+}
+
+/// Count brackets in output, compatible with SerdSink
+static size_t
+test_count_brackets(const void* buf, size_t len, void* stream)
+{
+  long* const depth = (long*)stream;
+  for (size_t i = 0u; i < len; ++i) {
+    const char c = ((const char*)buf)[i];
+    *depth += (c == '[') - (c == ']');
+  }
+
+  return len;
+}
+
+static int
+test_write_nested(SordWorld* world)
+{
+  static const unsigned n_levels = 1000u;
+
+  SordModel* const model = sord_new(world, SORD_SPO | SORD_OPS, false);
+  SordNode* const  p     = sord_new_uri(world, USTR("http://x.org/p"));
+  SordNode*        node  = sord_new_uri(world, USTR("http://x.org/s"));
+
+  // Make a chain of blank nodes, each used once, so written inline
+  char id[16];
+  for (unsigned i = 0u; i < n_levels; ++i) {
+    snprintf(id, sizeof(id), "b%u", i);
+
+    SordNode* const child = sord_new_blank(world, USTR(id));
+    const SordQuad  tup   = {node, p, child, NULL};
+    sord_add(model, tup);
+    sord_node_free(world, node);
+    node = child;
+  }
+
+  long              depth  = 0;
+  SerdEnv* const    env    = serd_env_new(NULL);
+  SerdWriter* const writer = serd_writer_new(SERD_TURTLE,
+                                             SERD_STYLE_ABBREVIATED,
+                                             env,
+                                             NULL,
+                                             test_count_brackets,
+                                             &depth);
+
+  const bool ok = sord_write(model, writer, NULL);
+  serd_writer_finish(writer);
+  serd_writer_free(writer);
+  serd_env_free(env);
+
+  sord_node_free(world, node);
+  sord_node_free(world, p);
+  sord_free(model);
+
+  if (!ok) {
+    return test_fail("Failed to write nested blank nodes\n");
+  } else if (depth) {
+    return test_fail("Unbalanced nested blank nodes (%ld)\n", depth);
+  }
+
+  return 0;
+}
+
+static int
+test_write_parallel(SordWorld* world)
+{
+  SordModel* const model = sord_new(world, SORD_SPO, false);
+  SordNode* const  p     = sord_new_uri(world, USTR("http://x.org/p"));
+  SordNode* const  o     = sord_new_literal(world, NULL, USTR("o"), NULL);
+
+  char uri[16];
+  for (unsigned i = 0u; i < 5u; ++i) {
+    snprintf(uri, sizeof(uri), "http://x.org/%u", i);
+
+    SordNode* const s   = sord_new_uri(world, USTR(uri));
+    const SordQuad  tup = {s, p, o, NULL};
+    sord_add(model, tup);
+    sord_node_free(world, s);
+  }
+
+  TestOutput serial = {{0}, 0};
+  sord_write_lines(sord_begin(model), SERD_NTRIPLES, test_output_sink, &serial);
+
+  int st = 0;
+  for (unsigned n_threads = 0u; !st && n_threads <= 4u; ++n_threads) {
+    TestOutput       output = {{0}, 0};
+    const SerdStatus wst    = sord_write_parallel(model,
+                                               NULL,
+                                               SERD_NTRIPLES,
+                                               (SerdStyle)0,
+                                               n_threads,
+                                               test_output_sink,
+                                               &output);
+    if (wst) {
+      st = test_fail("Failed to write in parallel (%s)\n", serd_strerror(wst));
+    } else if (strcmp(output.buf, serial.buf)) {
+      st = test_fail("Bad parallel output with %u threads:\n%s",
+                     n_threads,
+                     output.buf);
+    }
+  }
+
+  sord_node_free(world, o);
+  sord_node_free(world, p);
+  sord_free(model);
+  return st;
+}
+
+static int
+test_stats(SordWorld* world)
+{
+  const size_t     node_bytes = sord_num_node_bytes(world);
+  SordModel* const model      = sord_new(world, SORD_SPO | SORD_OPS, false);
+  SordNode* const  p = sord_new_uri(world, USTR("http://x.org/stats/p"));
+
+  char uri[32];
+  for (unsigned i = 0u; i < 2000u; ++i) {
+    snprintf(uri, sizeof(uri), "http://x.org/stats/%u", i);
+
+    SordNode* const s   = sord_new_uri(world, USTR(uri));
+    const SordQuad  tup = {s, p, s, NULL};
+    sord_add(model, tup);
+    sord_node_free(world, s);
+  }
+
+  SordIndexStats spo = {0u, 0u, 0.0};
+  SordIndexStats ops = {0u, 0u, 0.0};
+  SordIndexStats pos = {0u, 0u, 0.0};
+
+  int st = 0;
+  if (!sord_index_stats(model, SORD_SPO, false, &spo) ||
+      !sord_index_stats(model, SORD_OPS, false, &ops)) {
+    st = test_fail("Failed to get index statistics\n");
+  } else if (sord_index_stats(model, SORD_POS, false, &pos) ||
+             sord_index_stats(model, SORD_SPO, true, &pos)) {
+    st = test_fail("Got statistics for a missing index\n");
+  } else if (spo.n_pages < 2u || spo.n_bytes < spo.n_pages * 2000u ||
+             spo.fill <= 0.0 || spo.fill > 1.0) {
+    st = test_fail("Bad index statistics (%zu pages, %zu bytes, %f fill)\n",
+                   spo.n_pages,
+                   spo.n_bytes,
+                   spo.fill);
+  } else if (sord_num_node_bytes(world) < node_bytes + 2000u * 20u) {
+    st = test_fail("Node memory did not grow with nodes\n");
+  }
+
+  sord_node_free(world, p);
+  sord_free(model);
+  return st;
+}
+
+static SerdStatus
+test_count_statement(void*              handle,
+                     SerdStatementFlags flags,
+                     const SerdNode*    graph,
+                     const SerdNode*    subject,
+                     const SerdNode*    predicate,
+                     const SerdNode*    object,
+                     const SerdNode*    object_datatype,
+                     const SerdNode*    object_lang)
+{
+  ++*(size_t*)handle;
+  return SERD_SUCCESS;
+}
+
+static int
+test_deduplicator(const bool exact)
+{
+  static const char* const objects[] = {"a", "b", "a", "c", "b"};
+
+  const SerdNode s = serd_node_from_string(SERD_URI, USTR("http://x.org/s"));
+  const SerdNode p = serd_node_from_string(SERD_URI, USTR("http://x.org/p"));
+
+  size_t                  n_written = 0u;
+  SerdEnv* const          env       = serd_env_new(NULL);
+  SordDeduplicator* const dedup     = sord_deduplicator_new(
+    env, 0, exact, &n_written, NULL, NULL, test_count_statement, NULL);
+
+  for (unsigned i = 0; i < 5; ++i) {
+    const SerdNode o = serd_node_from_string(SERD_LITERAL, USTR(objects[i]));
+    sord_deduplicator_write_statement(dedup, 0, NULL, &s, &p, &o, NULL, NULL);
+  }
+
+  // The same statement in another graph is not a duplicate
+  const SerdNode g = serd_node_from_string(SERD_URI, USTR("http://x.org/g"));
+  const SerdNode o = serd_node_from_string(SERD_LITERAL, USTR("a"));
+  sord_deduplicator_write_statement(dedup, 0, &g, &s, &p, &o, NULL, NULL);
+
+  const size_t n_dropped = sord_deduplicator_num_dropped(dedup);
+  sord_deduplicator_free(dedup);
+  serd_env_free(env);
+
+  if (n_written != 4 || n_dropped != 2) {
+    return test_fail("Deduplicator wrote %zu and dropped %zu statements\n",
+                     n_written,
+                     n_dropped);
+  }
+
+  return 0;
+}
+
+static int
+test_compression(SordWorld* world, const SordCompression compression)
+{
+  static const char* const path    = "sord_test_compression.nt";
+  static const unsigned    n_lines = 4096;
+
+  if (!sord_compression_supported(compression)) {
+    return 0;
+  }
+
+  FILE* const fd = fopen(path, "wb");
+  if (!fd) {
+    return test_fail("Failed to open %s\n", path);
+  }
+
+  SordCompressor* const compressor =
+    sord_compressor_new(compression, serd_file_sink, fd);
+
+  for (unsigned i = 0; i < n_lines; ++i) {
+    char line[64];
+    snprintf(line, sizeof(line), "_:b%u <http://example.org/p> _:o .\n", i);
+    sord_compressor_write(line, strlen(line), compressor);
+  }
+
+  const SerdStatus cst = sord_compressor_finish(compressor);
+  sord_compressor_free(compressor);
+  fclose(fd);
+  if (cst) {
+    return test_fail("Failed to compress (%s)\n", serd_strerror(cst));
+  }
+
+  // Read serially from a mapping, then with a separate decompression thread
+  SordModel* serial   = sord_new(world, SORD_SPO, false);
+  SordModel* parallel = sord_new(world, SORD_SPO, false);
+  SerdEnv*   env      = serd_env_new(NULL);
+
+  SerdStatus st =
+    sord_read_file(serial, env, SERD_NTRIPLES, USTR(path), NULL, 1);
+  if (!st) {
+    st = sord_read_file(parallel, env, SERD_NTRIPLES, USTR(path), NULL, 2);
+  }
+  serd_env_free(env);
+  remove(path);
+
+  if (st) {
+    return test_fail("Failed to read compressed file (%s)\n",
+                     serd_strerror(st));
+  } else if (sord_num_quads(serial) != n_lines ||
+             sord_num_quads(parallel) != n_lines) {
+    return test_fail("Read %zu and %zu compressed statements\n",
+                     sord_num_quads(serial),
+                     sord_num_quads(parallel));
+  }
+
+  sord_free(parallel);
+  sord_free(serial);
+  return 0;
+}
+
+static int
+test_output(const bool threaded)
+{
+  static const char* const path    = "sord_test_output.txt";
+  static const size_t      n_bytes = 100000u;
+
+  FILE* const fd = fopen(path, "w+b");
+  if (!fd) {
+    return test_fail("Failed to open %s\n", path);
+  }
+
+  // Write small pieces and some larger than the buffer
+  char* const data = (char*)malloc(n_bytes);
+  for (size_t i = 0u; i < n_bytes; ++i) {
+    data[i] = (char)('a' + i % 26u);
+  }
+
+  SordOutput* const output = sord_output_new(fd, 16384u, threaded);
+  for (size_t i = 0u, len = 1u; i < n_bytes; i += len, len = len * 3u + 1u) {
+    if (i + len > n_bytes) {
+      len = n_bytes - i;
+    }
+
+    if (sord_output_write(data + i, len, output) != len) {
+      break;
+    }
+  }
+
+  const SerdStatus st = sord_output_flush(output);
+  sord_output_free(output);
+
+  char* const result = (char*)calloc(1, n_bytes);
+  rewind(fd);
+  const size_t n_read = fread(result, 1, n_bytes, fd);
+  fclose(fd);
+  remove(path);
+
+  const bool same = n_read == n_bytes && !memcmp(result, data, n_bytes);
+  free(result);
+  free(data);
+
+  if (st) {
+    return test_fail("Failed to write output (%s)\n", serd_strerror(st));
+  } else if (!same) {
+    return test_fail("Bad output (read %zu bytes)\n", n_read);
+  }
+
+  return 0;
+}
+
 static SerdStatus
 unexpected_error(void* handle, const SerdError* error)
 {
@@ -610,6 +1252,87 @@ main(int argc, char** argv)
     return finished(world, sord, EXIT_FAILURE);
   }
 
+  // Check batch interning matches interning nodes individually
+  const uint8_t* const batch_uris[] = {USTR("http://example.org"),
+                                       USTR("http://example.org/batch"),
+                                       USTR("noscheme"),
+                                       USTR("http://example.org/batch")};
+  SordNode*            batch[4];
+  sord_world_set_error_sink(world, expected_error, NULL);
+  if (sord_world_intern_batch(
+        world, SORD_URI, NULL, NULL, 4, batch_uris, batch) != 3) {
+    return test_fail("Batch interned wrong number of URIs\n");
+  }
+  sord_world_set_error_sink(world, unexpected_error, NULL);
+  if (batch[0] != uri_id || batch[1] != batch[3] || batch[2] ||
+      strcmp((const char*)sord_node_get_string(batch[1]),
+             "http://example.org/batch")) {
+    return test_fail("Batch interning of URIs failed\n");
+  }
+  for (unsigned i = 0; i < 4; ++i) {
+    sord_node_free(world, batch[i]);
+  }
+
+  const uint8_t* const batch_lits[] = {USTR("hello"), ni_hao};
+  sord_world_intern_batch(
+    world, SORD_LITERAL, NULL, "cmn", 2, batch_lits, batch);
+  if (batch[0] == lit4 || batch[0] == lit6 || batch[1] != chello) {
+    return test_fail("Batch interning of literals failed\n");
+  }
+  sord_node_free(world, batch[0]);
+  sord_node_free(world, batch[1]);
+
+  // Check lookup of existing nodes
+  const size_t n_nodes_before_find = sord_num_nodes(world);
+  if (sord_world_find_uri(world, USTR("http://example.org")) != uri_id) {
+    return test_fail("Failed to find existing URI\n");
+  } else if (sord_world_find_blank(world, USTR("testblank")) != blank_id) {
+    return test_fail("Failed to find existing blank node\n");
+  } else if (sord_world_find_literal(world, uri_id, USTR("hello"), NULL) !=
+             lit_id) {
+    return test_fail("Failed to find existing literal\n");
+  } else if (sord_world_find_literal(world, NULL, ni_hao, "cmn") != chello) {
+    return test_fail("Failed to find existing literal with language\n");
+  }
+
+  // Check lookup of non-existent nodes
+  if (sord_world_find_uri(world, USTR("http://example.org/missing"))) {
+    return test_fail("Found non-existent URI\n");
+  } else if (sord_world_find_uri(world, USTR("testblank"))) {
+    return test_fail("Found blank node as URI\n");
+  } else if (sord_world_find_blank(world, USTR("missing"))) {
+    return test_fail("Found non-existent blank node\n");
+  } else if (sord_world_find_literal(world, NULL, USTR("hello"), "fr")) {
+    return test_fail("Found literal with non-existent language\n");
+  } else if (sord_world_find_literal(world, uri_id3, USTR("hello"), NULL)) {
+    return test_fail("Found literal with non-existent datatype\n");
+  } else if (sord_num_nodes(world) != n_nodes_before_find) {
+    return test_fail("Node lookup modified world\n");
+  }
+
+  // Check unreferenced nodes are kept for reuse when a limit is set
+  sord_world_set_orphan_limit(world, 2);
+  const size_t n_nodes_before_orphan = sord_num_nodes(world);
+
+  SordNode*       orphan = sord_new_uri(world, USTR("http://example.org/o"));
+  const SordNode* orphan_addr = orphan;
+  sord_node_free(world, orphan);
+  if (sord_num_nodes(world) != n_nodes_before_orphan) {
+    return test_fail("Unreferenced node counted\n");
+  } else if (sord_world_find_uri(world, USTR("http://example.org/o"))) {
+    return test_fail("Found unreferenced node\n");
+  } else if ((orphan = sord_new_uri(world, USTR("http://example.org/o"))) !=
+             orphan_addr) {
+    return test_fail("Unreferenced node not reused\n");
+  }
+  sord_node_free(world, orphan);
+  if (sord_world_collect(world) != 1 || sord_world_collect(world) != 0) {
+    return test_fail("Failed to collect unreferenced node\n");
+  } else if (sord_num_nodes(world) != n_nodes_before_orphan) {
+    return test_fail("Node count changed by collection\n");
+  }
+  sord_world_set_orphan_limit(world, 0);
+
   // Check comparison with NULL
   sord_node_free(world, uri_id);
   sord_node_free(world, blank_id);
@@ -754,6 +1477,51 @@ main(int argc, char** argv)
     return finished(world, sord, EXIT_FAILURE);
   }
 
+  // Check cached nodes are not reused after the prefix changes
+  static const char* const prefixed = "@prefix ex: <http://example.org/a/> .\n"
+                                      "ex:s ex:p ex:o .\n"
+                                      "@prefix ex: <http://example.org/b/> .\n"
+                                      "ex:s ex:p ex:o .\n";
+
+  sord_free(sord);
+  sord   = sord_new(world, SORD_SPO, false);
+  env    = serd_env_new(&base);
+  reader = sord_new_reader(sord, env, SERD_TURTLE, NULL);
+  if ((st = serd_reader_read_string(reader, USTR(prefixed)))) {
+    fprintf(stderr, "Failed to read prefixed string (%s)\n", serd_strerror(st));
+    return finished(world, sord, EXIT_FAILURE);
+  }
+  serd_reader_free(reader);
+  serd_env_free(env);
+  if (sord_num_quads(sord) != 2) {
+    return test_fail("Read %zu triples with changing prefix, expected 2\n",
+                     sord_num_quads(sord));
+  }
+
+  // Check cached nodes are not reused after they are removed from the model
+  static const char* const repeated = "<http://example.org/s> "
+                                      "<http://example.org/p> "
+                                      "<http://example.org/o> .\n";
+
+  env    = serd_env_new(&base);
+  reader = sord_new_reader(sord, env, SERD_NTRIPLES, NULL);
+  serd_reader_read_string(reader, USTR(repeated));
+  for (iter = sord_begin(sord); !sord_iter_end(iter);) {
+    sord_erase(sord, iter);
+  }
+  sord_iter_free(iter);
+  serd_reader_read_string(reader, USTR(repeated));
+  if (sord_num_quads(sord) != 1) {
+    return test_fail("Read %zu triples after removal, expected 1\n",
+                     sord_num_quads(sord));
+  }
+
+  // Freeing a reader after its model must be safe
+  sord_free(sord);
+  sord = NULL;
+  serd_reader_free(reader);
+  serd_env_free(env);
+
   // Test SPO iteration on an SOP indexed store
   sord_free(sord);
   sord = sord_new(world, SORD_SOP, false);
@@ -763,5 +1531,20 @@ main(int argc, char** argv)
   }
   sord_iter_free(iter);
 
+  // Test reading files in parallel
+  if (test_read_file(world, SERD_NTRIPLES, 4) ||
+      test_read_file(world, SERD_NTRIPLES, 0) ||
+      test_read_file(world, SERD_TURTLE, 2) || test_read_files(world) ||
+      test_sorter() || test_sorter_many_runs() ||
+      test_write_abbreviated(world) ||
+      test_write_nested(world) || test_write_lines(world) ||
+      test_write_parallel(world) || test_stats(world) ||
+      test_deduplicator(true) || test_deduplicator(false) ||
+      test_compression(world, SORD_COMPRESSION_GZIP) ||
+      test_compression(world, SORD_COMPRESSION_ZSTD) || test_output(false) ||
+      test_output(true)) {
+    return finished(world, sord, EXIT_FAILURE);
+  }
+
   return finished(world, sord, EXIT_SUCCESS);
 }
@@ -25,6 +25,11 @@
 #  include <pcre.h>
 #endif
 
+#if USE_PTHREAD
+#  include <pthread.h>
+#  include <unistd.h>
+#endif
+
 #ifdef _WIN32
 #  include <windows.h>
 #endif
@@ -35,6 +40,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 
 #ifdef __GNUC__
 #  define SORD_LOG_FUNC(fmt, arg1) __attribute__((format(printf, fmt, arg1)))
@@ -88,8 +94,12 @@ typedef struct {
   SordNode* xsd_string;
 } URIs;
 
-static int  n_errors        = 0;
-static int  n_restrictions  = 0;
+/// Number of statements checked by each task when checking properties
+#define PROPERTY_CHUNK_SIZE 1024u
+
+/// Number of predicates or classes listed in a profile
+#define PROFILE_N_HOT_SPOTS 20u
+
 static bool one_line_errors = false;
 
 static int
@@ -110,9 +120,13 @@ print_usage(const char* name, bool error)
   FILE* const os = error ? stderr : stdout;
   fprintf(os, "Usage: %s [OPTION]... INPUT...\n", name);
   fprintf(os, "Validate RDF data\n\n");
-  fprintf(os, "  -h  Display this help and exit\n");
-  fprintf(os, "  -l  Print errors on a single line.\n");
-  fprintf(os, "  -v  Display version information and exit\n");
+  fprintf(os, "  -a ADDED    Add statements in ADDED and check changes\n");
+  fprintf(os, "  -h          Display this help and exit\n");
+  fprintf(os, "  -j THREADS  Number of threads to use (0 for auto)\n");
+  fprintf(os, "  -l          Print errors on a single line.\n");
+  fprintf(os, "  -P          Print a profile of checks after checking\n");
+  fprintf(os, "  -r REMOVED  Remove statements in REMOVED and check changes\n");
+  fprintf(os, "  -v          Display version information and exit\n");
   fprintf(os,
           "Validate RDF data.  This is a simple validator which checks\n"
           "that all used properties are actually defined.  It does not do\n"
@@ -134,565 +148,2140 @@ absolute_path(const uint8_t* path)
 #endif
 }
 
-SORD_LOG_FUNC(2, 3)
-static int
-errorf(const SordQuad quad, const char* fmt, ...)
+/// A growable array of nodes
+typedef struct {
+  const SordNode** nodes;   ///< Nodes
+  size_t           n_nodes; ///< Number of nodes
+  size_t           size;    ///< Allocated number of nodes
+} NodeArray;
+
+static void
+node_array_push(NodeArray* array, const SordNode* node)
 {
-  va_list args;
-  va_start(args, fmt);
-  fprintf(stderr, "error: ");
-  vfprintf(stderr, fmt, args);
-  va_end(args);
+  if (array->n_nodes == array->size) {
+    array->size  = array->size ? array->size * 2u : 16u;
+    array->nodes = (const SordNode**)realloc(
+      array->nodes, array->size * sizeof(const SordNode*));
+  }
 
-  const char* sep = one_line_errors ? "\t" : "\n       ";
-  fprintf(stderr,
-          "%s%s%s%s%s%s\n",
-          sep,
-          (const char*)sord_node_get_string(quad[SORD_SUBJECT]),
-          sep,
-          (const char*)sord_node_get_string(quad[SORD_PREDICATE]),
-          sep,
-          (const char*)sord_node_get_string(quad[SORD_OBJECT]));
-
-  ++n_errors;
-  return 1;
+  array->nodes[array->n_nodes++] = node;
 }
 
 static bool
-is_descendant_of(SordModel*      model,
-                 const URIs*     uris,
-                 const SordNode* child,
-                 const SordNode* parent,
-                 const SordNode* pred)
+node_array_contains(const NodeArray* array, const SordNode* node)
 {
-  if (!child) {
-    return false;
-  } else if (sord_node_equals(child, parent) ||
-             sord_ask(model, child, uris->owl_equivalentClass, parent, NULL)) {
-    return true;
-  }
-
-  SordIter* i = sord_search(model, child, pred, NULL, NULL);
-  for (; !sord_iter_end(i); sord_iter_next(i)) {
-    const SordNode* o = sord_iter_get_node(i, SORD_OBJECT);
-    if (sord_node_equals(child, o)) {
-      continue; // Weird class is explicitly a descendent of itself
-    }
-    if (is_descendant_of(model, uris, o, parent, pred)) {
-      sord_iter_free(i);
+  for (size_t i = 0u; i < array->n_nodes; ++i) {
+    if (array->nodes[i] == node) {
       return true;
     }
   }
-  sord_iter_free(i);
 
   return false;
 }
 
-static bool
-regexp_match(const uint8_t* pat, const char* str)
+/// Compare nodes by address, which is their identity since they are interned
+static int
+node_address_cmp(const void* a, const void* b)
 {
-#if USE_PCRE
-  // Append a $ to the pattern so we only match if the entire string matches
-  const size_t len  = strlen((const char*)pat);
-  char* const  regx = (char*)malloc(len + 2);
-  memcpy(regx, pat, len);
-  regx[len]     = '$';
-  regx[len + 1] = '\0';
-
-  const char* err;
-  int         erroffset;
-  pcre*       re = pcre_compile(regx, PCRE_ANCHORED, &err, &erroffset, NULL);
-  free(regx);
-  if (!re) {
-    fprintf(
-      stderr, "Error in pattern `%s' at offset %d (%s)\n", pat, erroffset, err);
-    return false;
-  }
+  const uintptr_t pa = (uintptr_t) * (const SordNode* const*)a;
+  const uintptr_t pb = (uintptr_t) * (const SordNode* const*)b;
 
-  const bool ret = pcre_exec(re, NULL, str, strlen(str), 0, 0, NULL, 0) >= 0;
-  pcre_free(re);
-  return ret;
-#endif // USE_PCRE
-  return true;
+  return (pa < pb) ? -1 : (pa > pb) ? 1 : 0;
 }
 
-static int
-bound_cmp(SordModel*      model,
-          const URIs*     uris,
-          const SordNode* literal,
-          const SordNode* type,
-          const SordNode* bound)
+static size_t
+node_slot(const SordNode* node, const size_t mask)
 {
-  const char*     str       = (const char*)sord_node_get_string(literal);
-  const char*     bound_str = (const char*)sord_node_get_string(bound);
-  const SordNode* pred      = uris->owl_onDatatype;
-  const bool      is_numeric =
-    is_descendant_of(model, uris, type, uris->xsd_decimal, pred) ||
-    is_descendant_of(model, uris, type, uris->xsd_double, pred);
-
-  if (is_numeric) {
-    const double fbound   = serd_strtod(bound_str, NULL);
-    const double fliteral = serd_strtod(str, NULL);
-    return ((fliteral < fbound) ? -1 : (fliteral > fbound) ? 1 : 0);
-  } else {
-    return strcmp(str, bound_str);
-  }
+  // Drop the low bits, which are the same for every aligned node
+  return ((uintptr_t)node >> 4u) & mask;
 }
 
+/** A set of nodes, keyed by address in an open-addressed table */
+typedef struct {
+  const SordNode** slots;     ///< Slots, with NULL if empty
+  size_t           mask;      ///< Number of slots minus one
+  size_t           n_entries; ///< Number of occupied slots
+} NodeSet;
+
 static bool
-check_restriction(SordModel*      model,
-                  const URIs*     uris,
-                  const SordNode* literal,
-                  const SordNode* type,
-                  const SordNode* restriction)
+node_set_contains(const NodeSet* set, const SordNode* node)
 {
-  size_t      len = 0;
-  const char* str = (const char*)sord_node_get_string_counted(literal, &len);
-
-  // Check xsd:pattern
-  SordIter* p = sord_search(model, restriction, uris->xsd_pattern, 0, 0);
-  if (p) {
-    const SordNode* pat = sord_iter_get_node(p, SORD_OBJECT);
-    if (!regexp_match(sord_node_get_string(pat), str)) {
-      fprintf(stderr,
-              "`%s' does not match <%s> pattern `%s'\n",
-              sord_node_get_string(literal),
-              sord_node_get_string(type),
-              sord_node_get_string(pat));
-      sord_iter_free(p);
-      return false;
-    }
-    sord_iter_free(p);
-    ++n_restrictions;
-  }
-
-  // Check xsd:minInclusive
-  SordIter* l = sord_search(model, restriction, uris->xsd_minInclusive, 0, 0);
-  if (l) {
-    const SordNode* lower = sord_iter_get_node(l, SORD_OBJECT);
-    if (bound_cmp(model, uris, literal, type, lower) < 0) {
-      fprintf(stderr,
-              "`%s' is not >= <%s> minimum `%s'\n",
-              sord_node_get_string(literal),
-              sord_node_get_string(type),
-              sord_node_get_string(lower));
-      sord_iter_free(l);
-      return false;
-    }
-    sord_iter_free(l);
-    ++n_restrictions;
+  if (!set->slots) {
+    return false;
   }
 
-  // Check xsd:maxInclusive
-  SordIter* u = sord_search(model, restriction, uris->xsd_maxInclusive, 0, 0);
-  if (u) {
-    const SordNode* upper = sord_iter_get_node(u, SORD_OBJECT);
-    if (bound_cmp(model, uris, literal, type, upper) > 0) {
-      fprintf(stderr,
-              "`%s' is not <= <%s> maximum `%s'\n",
-              sord_node_get_string(literal),
-              sord_node_get_string(type),
-              sord_node_get_string(upper));
-      sord_iter_free(u);
-      return false;
+  size_t i = node_slot(node, set->mask);
+  for (; set->slots[i]; i = (i + 1u) & set->mask) {
+    if (set->slots[i] == node) {
+      return true;
     }
-    sord_iter_free(u);
-    ++n_restrictions;
   }
 
-  return true; // Unknown restriction, be quietly tolerant
+  return false;
 }
 
-static bool
-literal_is_valid(SordModel*      model,
-                 const URIs*     uris,
-                 const SordQuad  quad,
-                 const SordNode* literal,
-                 const SordNode* type)
+static void
+node_set_insert(NodeSet* set, const SordNode* node)
 {
-  if (!type) {
-    return true;
+  if (node_set_contains(set, node)) {
+    return;
   }
 
-  /* Check that literal data is related to required type.  We don't do a
-     strict subtype check here because e.g. an xsd:decimal might be a valid
-     xsd:unsignedInt, which the pattern checks will verify, but if the
-     literal type is not related to the required type at all
-     (e.g. xsd:decimal and xsd:string) there is a problem. */
-  const SordNode* datatype = sord_node_get_datatype(literal);
-  if (datatype && datatype != type) {
-    if (!is_descendant_of(model, uris, datatype, type, uris->owl_onDatatype) &&
-        !is_descendant_of(model, uris, type, datatype, uris->owl_onDatatype) &&
-        !(sord_node_equals(datatype, uris->xsd_decimal) &&
-          is_descendant_of(
-            model, uris, type, uris->xsd_double, uris->owl_onDatatype))) {
-      errorf(quad,
-             "Literal `%s' datatype <%s> is not compatible with <%s>\n",
-             sord_node_get_string(literal),
-             sord_node_get_string(datatype),
-             sord_node_get_string(type));
-      return false;
+  const size_t n_old = set->slots ? set->mask + 1u : 0u;
+  if ((set->n_entries + 1u) * 4u > n_old * 3u) {
+    // Double the number of slots, and move every entry
+    const SordNode** const old_slots = set->slots;
+    const size_t           n_slots   = n_old ? n_old * 2u : 64u;
+
+    set->slots = (const SordNode**)calloc(n_slots, sizeof(const SordNode*));
+    set->mask  = n_slots - 1u;
+    for (size_t i = 0u; i < n_old; ++i) {
+      if (old_slots[i]) {
+        size_t j = node_slot(old_slots[i], set->mask);
+        while (set->slots[j]) {
+          j = (j + 1u) & set->mask;
+        }
+
+        set->slots[j] = old_slots[i];
+      }
     }
+
+    free(old_slots);
   }
 
-  // Find restrictions list
-  SordIter* rs = sord_search(model, type, uris->owl_withRestrictions, 0, 0);
-  if (sord_iter_end(rs)) {
-    return true; // No restrictions
+  size_t i = node_slot(node, set->mask);
+  while (set->slots[i]) {
+    i = (i + 1u) & set->mask;
   }
 
-  // Walk list, checking each restriction
-  const SordNode* head = sord_iter_get_node(rs, SORD_OBJECT);
-  while (head) {
-    SordIter* f = sord_search(model, head, uris->rdf_first, 0, 0);
-    if (!f) {
-      break; // Reached end of restrictions list without failure
-    }
+  set->slots[i] = node;
+  ++set->n_entries;
+}
 
-    // Check this restriction
-    const bool good = check_restriction(
-      model, uris, literal, type, sord_iter_get_node(f, SORD_OBJECT));
-    sord_iter_free(f);
+/**
+   Nodes in added or removed statements, and what they affect.
 
-    if (!good) {
-      sord_iter_free(rs);
-      return false; // Failed, literal is invalid
-    }
+   The affected statements are copied into small models, so they can be
+   checked in the same order as a full check without scanning the input.
+*/
+typedef struct {
+  NodeSet    subjects;   ///< Subjects of changed statements
+  NodeSet    objects;    ///< Objects of changed statements
+  NodeSet    referrers;  ///< Subjects of statements with a retyped object
+  SordModel* statements; ///< Statements to check
+  SordModel* instances;  ///< Type of every instance to check
+} Changes;
+
+/** Every ancestor of a node in a hierarchy */
+typedef struct {
+  const SordNode*  node;        ///< Node, or NULL for an empty slot
+  const SordNode** ancestors;   ///< Ancestors sorted by address, or NULL
+  size_t           n_ancestors; ///< Number of ancestors
+} Ancestors;
+
+/**
+   The transitive closure of a hierarchy like rdfs:subClassOf.
+
+   This is computed once before checking, so checking whether one node is a
+   descendant of another is a lookup rather than a recursive search of the
+   model, and the table is only read while checking on several threads.
+   Nodes that are not the subject of a hierarchy or equivalence statement are
+   not in the table, and have no ancestors but themselves.
+*/
+typedef struct {
+  Ancestors* slots;     ///< Slots, with a NULL node if empty
+  size_t     mask;      ///< Number of slots minus one
+  size_t     n_entries; ///< Number of occupied slots
+} Hierarchy;
 
-    // Seek to next list node
-    SordIter* n = sord_search(model, head, uris->rdf_rest, 0, 0);
-    head        = n ? sord_iter_get_node(n, SORD_OBJECT) : NULL;
-    sord_iter_free(n);
+static Ancestors*
+hierarchy_find(const Hierarchy* hierarchy, const SordNode* node)
+{
+  if (!hierarchy->slots) {
+    return NULL;
   }
 
-  sord_iter_free(rs);
-
-  SordIter* s = sord_search(model, type, uris->owl_onDatatype, 0, 0);
-  if (s) {
-    const SordNode* super = sord_iter_get_node(s, SORD_OBJECT);
-    const bool      good  = literal_is_valid(model, uris, quad, literal, super);
-    sord_iter_free(s);
-    return good; // Match iff literal also matches supertype
+  size_t i = node_slot(node, hierarchy->mask);
+  for (; hierarchy->slots[i].node; i = (i + 1u) & hierarchy->mask) {
+    if (hierarchy->slots[i].node == node) {
+      return &hierarchy->slots[i];
+    }
   }
 
-  return true; // Matches top level type
+  return NULL;
 }
 
-static bool
-check_type(SordModel*      model,
-           const URIs*     uris,
-           const SordQuad  quad,
-           const SordNode* node,
-           const SordNode* type)
+/// Add a node with no known ancestors, if it is not already present
+static void
+hierarchy_insert(Hierarchy* hierarchy, const SordNode* node)
 {
-  if (sord_node_equals(type, uris->rdfs_Resource) ||
-      sord_node_equals(type, uris->owl_Thing)) {
-    return true;
+  if (hierarchy_find(hierarchy, node)) {
+    return;
   }
 
-  if (sord_node_get_type(node) == SORD_LITERAL) {
-    if (sord_node_equals(type, uris->rdfs_Literal)) {
-      return true;
-    } else if (sord_node_equals(type, uris->rdf_PlainLiteral)) {
-      return !sord_node_get_language(node);
-    } else {
-      return literal_is_valid(model, uris, quad, node, type);
-    }
-  } else if (sord_node_get_type(node) == SORD_URI) {
-    if (sord_node_equals(type, uris->foaf_Document)) {
-      return true; // Questionable...
-    } else if (is_descendant_of(
-                 model, uris, type, uris->xsd_anyURI, uris->owl_onDatatype)) {
-      /* Type is any URI and this is a URI, so pass.  Restrictions on
-         anyURI subtypes are not currently checked (very uncommon). */
-      return true; // Type is anyURI, and this is a URI
-    } else {
-      SordIter* t = sord_search(model, node, uris->rdf_type, NULL, NULL);
-      for (; !sord_iter_end(t); sord_iter_next(t)) {
-        if (is_descendant_of(model,
-                             uris,
-                             sord_iter_get_node(t, SORD_OBJECT),
-                             type,
-                             uris->rdfs_subClassOf)) {
-          sord_iter_free(t);
-          return true;
+  const size_t n_old = hierarchy->slots ? hierarchy->mask + 1u : 0u;
+  if ((hierarchy->n_entries + 1u) * 4u > n_old * 3u) {
+    // Double the number of slots, and move every entry
+    Ancestors* const old_slots = hierarchy->slots;
+    const size_t     n_slots   = n_old ? n_old * 2u : 64u;
+
+    hierarchy->slots = (Ancestors*)calloc(n_slots, sizeof(Ancestors));
+    hierarchy->mask  = n_slots - 1u;
+    for (size_t i = 0u; i < n_old; ++i) {
+      if (old_slots[i].node) {
+        size_t j = node_slot(old_slots[i].node, hierarchy->mask);
+        while (hierarchy->slots[j].node) {
+          j = (j + 1u) & hierarchy->mask;
         }
+
+        hierarchy->slots[j] = old_slots[i];
       }
-      sord_iter_free(t);
-      return false;
     }
-  } else {
-    return true; // Blanks often lack explicit types, ignore
-  }
 
-  return false;
-}
+    free(old_slots);
+  }
 
-static uint64_t
-count_non_blanks(SordIter* i, SordQuadIndex field)
-{
-  uint64_t n = 0;
-  for (; !sord_iter_end(i); sord_iter_next(i)) {
-    const SordNode* node = sord_iter_get_node(i, field);
-    if (sord_node_get_type(node) != SORD_BLANK) {
-      ++n;
-    }
+  size_t i = node_slot(node, hierarchy->mask);
+  while (hierarchy->slots[i].node) {
+    i = (i + 1u) & hierarchy->mask;
   }
-  return n;
+
+  hierarchy->slots[i].node = node;
+  ++hierarchy->n_entries;
 }
 
-static int
-check_properties(SordModel* model, URIs* uris)
+/// Find every ancestor of the node in `entry`
+static void
+hierarchy_close(const Hierarchy* hierarchy,
+                SordModel*       model,
+                const SordNode*  pred,
+                const SordNode*  equivalent,
+                Ancestors*       entry)
 {
-  int       st = 0;
-  SordIter* i  = sord_begin(model);
-  for (; !sord_iter_end(i); sord_iter_next(i)) {
-    SordQuad quad;
-    sord_iter_get(i, quad);
-
-    const SordNode* subj = quad[SORD_SUBJECT];
-    const SordNode* pred = quad[SORD_PREDICATE];
-    const SordNode* obj  = quad[SORD_OBJECT];
-
-    bool      is_any_property = false;
-    SordIter* t = sord_search(model, pred, uris->rdf_type, NULL, NULL);
-    for (; !sord_iter_end(t); sord_iter_next(t)) {
-      if (is_descendant_of(model,
-                           uris,
-                           sord_iter_get_node(t, SORD_OBJECT),
-                           uris->rdf_Property,
-                           uris->rdfs_subClassOf)) {
-        is_any_property = true;
-        break;
+  NodeArray ancestors = {NULL, 0u, 0u};
+  NodeArray queue     = {NULL, 0u, 0u};
+
+  node_array_push(&queue, entry->node);
+  for (size_t q = 0u; q < queue.n_nodes; ++q) {
+    const SordNode* const  node  = queue.nodes[q];
+    const Ancestors* const known = q ? hierarchy_find(hierarchy, node) : NULL;
+    if (known && known->ancestors) {
+      // Already closed, so reuse its ancestors
+      for (size_t i = 0u; i < known->n_ancestors; ++i) {
+        node_array_push(&ancestors, known->ancestors[i]);
       }
+      continue;
     }
-    sord_iter_free(t);
-
-    const bool is_ObjectProperty =
-      sord_ask(model, pred, uris->rdf_type, uris->owl_ObjectProperty, 0);
-    const bool is_FunctionalProperty =
-      sord_ask(model, pred, uris->rdf_type, uris->owl_FunctionalProperty, 0);
-    const bool is_InverseFunctionalProperty = sord_ask(
-      model, pred, uris->rdf_type, uris->owl_InverseFunctionalProperty, 0);
-    const bool is_DatatypeProperty =
-      sord_ask(model, pred, uris->rdf_type, uris->owl_DatatypeProperty, 0);
 
-    if (!is_any_property) {
-      st = errorf(quad, "Use of undefined property");
-    }
+    node_array_push(&ancestors, node);
 
-    if (!sord_ask(model, pred, uris->rdfs_label, NULL, NULL)) {
-      st =
-        errorf(quad, "Property <%s> has no label", sord_node_get_string(pred));
+    // Equivalent nodes are ancestors, but their own ancestors are not
+    SordIter* e = sord_search(model, node, equivalent, NULL, NULL);
+    for (; !sord_iter_end(e); sord_iter_next(e)) {
+      node_array_push(&ancestors, sord_iter_get_node(e, SORD_OBJECT));
     }
-
-    if (is_DatatypeProperty && sord_node_get_type(obj) != SORD_LITERAL) {
-      st = errorf(quad, "Datatype property with non-literal value");
+    sord_iter_free(e);
+
+    // Visit each parent once, which also stops at cycles
+    SordIter* p = sord_search(model, node, pred, NULL, NULL);
+    for (; !sord_iter_end(p); sord_iter_next(p)) {
+      const SordNode* const parent = sord_iter_get_node(p, SORD_OBJECT);
+      if (!node_array_contains(&queue, parent)) {
+        node_array_push(&queue, parent);
+      }
     }
+    sord_iter_free(p);
+  }
 
-    if (is_ObjectProperty && sord_node_get_type(obj) == SORD_LITERAL) {
-      st = errorf(quad, "Object property with literal value");
-    }
+  // Sort ancestors and remove duplicates
+  qsort(ancestors.nodes,
+        ancestors.n_nodes,
+        sizeof(const SordNode*),
+        node_address_cmp);
 
-    if (is_FunctionalProperty) {
-      SordIter*      o = sord_search(model, subj, pred, NULL, NULL);
-      const unsigned n = count_non_blanks(o, SORD_OBJECT);
-      if (n > 1) {
-        st = errorf(quad, "Functional property with %u objects", n);
-      }
-      sord_iter_free(o);
+  size_t n_unique = 0u;
+  for (size_t i = 0u; i < ancestors.n_nodes; ++i) {
+    if (!n_unique || ancestors.nodes[i] != ancestors.nodes[n_unique - 1u]) {
+      ancestors.nodes[n_unique++] = ancestors.nodes[i];
     }
+  }
 
-    if (is_InverseFunctionalProperty) {
-      SordIter*      s = sord_search(model, NULL, pred, obj, NULL);
-      const unsigned n = count_non_blanks(s, SORD_SUBJECT);
-      if (n > 1) {
-        st = errorf(quad, "Inverse functional property with %u subjects", n);
-      }
-      sord_iter_free(s);
-    }
+  entry->ancestors   = ancestors.nodes;
+  entry->n_ancestors = n_unique;
+  free(queue.nodes);
+}
 
-    if (sord_node_equals(pred, uris->rdf_type) &&
-        !sord_ask(model, obj, uris->rdf_type, uris->rdfs_Class, NULL) &&
-        !sord_ask(model, obj, uris->rdf_type, uris->owl_Class, NULL)) {
-      st = errorf(quad, "Type is not a rdfs:Class or owl:Class");
-    }
+/**
+   Compute the ancestors of every node in a hierarchy.
 
-    if (sord_node_get_type(obj) == SORD_LITERAL &&
-        !literal_is_valid(
-          model, uris, quad, obj, sord_node_get_datatype(obj))) {
-      st = errorf(quad, "Literal does not match datatype");
+   @param hierarchy The hierarchy to initialise.
+   @param model Model to read statements from.
+   @param pred Predicate from a node to its parents.
+   @param equivalent Predicate from a node to equivalent nodes.
+*/
+static void
+hierarchy_init(Hierarchy*      hierarchy,
+               SordModel*      model,
+               const SordNode* pred,
+               const SordNode* equivalent)
+{
+  memset(hierarchy, 0, sizeof(Hierarchy));
+
+  // Add every node that has a parent or an equivalent
+  const SordNode* const preds[] = {pred, equivalent};
+  for (unsigned p = 0u; p < 2u; ++p) {
+    SordIter* i = sord_search(model, NULL, preds[p], NULL, NULL);
+    for (; !sord_iter_end(i); sord_iter_next(i)) {
+      hierarchy_insert(hierarchy, sord_iter_get_node(i, SORD_SUBJECT));
     }
+    sord_iter_free(i);
+  }
 
-    SordIter* r = sord_search(model, pred, uris->rdfs_range, NULL, NULL);
-    for (; !sord_iter_end(r); sord_iter_next(r)) {
-      const SordNode* range = sord_iter_get_node(r, SORD_OBJECT);
-      if (!check_type(model, uris, quad, obj, range)) {
-        st = errorf(
-          quad, "Object not in range <%s>\n", sord_node_get_string(range));
-      }
+  // Close every node, which reuses the ancestors of nodes already closed
+  for (size_t i = 0u; hierarchy->slots && i <= hierarchy->mask; ++i) {
+    if (hierarchy->slots[i].node) {
+      hierarchy_close(
+        hierarchy, model, pred, equivalent, &hierarchy->slots[i]);
     }
-    sord_iter_free(r);
+  }
+}
 
-    SordIter* d = sord_search(model, pred, uris->rdfs_domain, NULL, NULL);
-    if (d) {
-      const SordNode* domain = sord_iter_get_node(d, SORD_OBJECT);
-      if (!check_type(model, uris, quad, subj, domain)) {
-        st = errorf(
-          quad, "Subject not in domain <%s>", sord_node_get_string(domain));
-      }
-      sord_iter_free(d);
-    }
+static void
+hierarchy_free(Hierarchy* hierarchy)
+{
+  for (size_t i = 0u; hierarchy->slots && i <= hierarchy->mask; ++i) {
+    free(hierarchy->slots[i].ancestors);
   }
-  sord_iter_free(i);
 
-  return st;
+  free(hierarchy->slots);
 }
 
-static int
-check_instance(SordModel*      model,
-               const URIs*     uris,
-               const SordNode* restriction,
-               const SordQuad  quad)
-{
-  const SordNode* instance = quad[SORD_SUBJECT];
-  int             st       = 0;
+#if USE_PCRE
 
-  const SordNode* prop =
-    sord_get(model, restriction, uris->owl_onProperty, NULL, NULL);
-  if (!prop) {
-    return 0;
-  }
+// pcre_jit_exec() takes a stack for each match, so threads can share code
+#  if defined(PCRE_STUDY_JIT_COMPILE) && \
+    (PCRE_MAJOR > 8 || (PCRE_MAJOR == 8 && PCRE_MINOR >= 32))
+#    define USE_PCRE_JIT 1
+#  else
+#    define USE_PCRE_JIT 0
+#  endif
 
-  const unsigned values = sord_count(model, instance, prop, NULL, NULL);
+/** A compiled xsd:pattern */
+typedef struct {
+  const SordNode* pattern; ///< Pattern node, or NULL for an empty slot
+  pcre*           re;      ///< Compiled expression, or NULL if invalid
+  pcre_extra*     extra;   ///< Study data and JIT code, or NULL
+  bool            jit;     ///< True if compiled to machine code
+} Regex;
+
+/**
+   Compiled patterns, keyed by node.
+
+   Nodes are interned, so patterns are found by pointer without comparing
+   strings.  This is an open-addressed table, since patterns are never
+   removed until the end.  Every pattern in the model is compiled before
+   checking, so the table is only read while checking on several threads.
+*/
+typedef struct {
+  Regex* slots;     ///< Slots, with a NULL pattern if empty
+  size_t mask;      ///< Number of slots minus one
+  size_t n_entries; ///< Number of occupied slots
+} RegexCache;
 
-  // Check exact cardinality
-  const SordNode* card =
-    sord_get(model, restriction, uris->owl_cardinality, NULL, NULL);
-  if (card) {
-    const unsigned c = atoi((const char*)sord_node_get_string(card));
-    if (values != c) {
-      st = errorf(quad,
-                  "Property %s on %s has %u != %u values",
-                  sord_node_get_string(prop),
-                  sord_node_get_string(instance),
-                  values,
-                  c);
-    }
+#endif // USE_PCRE
+
+/**
+   A kind of check, which is timed separately when profiling.
+
+   Hierarchy lookups are only counted, since reading the clock would take
+   longer than the lookup itself, so their time is included in the check
+   that made them.
+*/
+typedef enum {
+  CHECK_PROPERTY,    ///< Use of a property in a statement
+  CHECK_TYPE,        ///< Node is an instance of a type
+  CHECK_LITERAL,     ///< Literal is valid for a datatype
+  CHECK_RESTRICTION, ///< Literal is in a datatype restriction range
+  CHECK_PATTERN,     ///< Literal matches a datatype pattern
+  CHECK_CARDINALITY, ///< Instance of a restricted class has valid values
+  CHECK_HIERARCHY,   ///< Class or datatype is a descendant of another
+} CheckKind;
+
+#define N_CHECK_KINDS ((unsigned)CHECK_HIERARCHY + 1u)
+
+static const char* const check_kind_names[] = {"property",
+                                               "type",
+                                               "literal",
+                                               "restriction",
+                                               "pattern",
+                                               "cardinality",
+                                               "hierarchy"};
+
+/// Statistics for some checks
+typedef struct {
+  size_t calls;    ///< Number of checks
+  double seconds;  ///< Time spent checking
+  size_t searches; ///< Number of searches of the model
+} CheckStats;
+
+/// Statistics for the checks on a predicate or class
+typedef struct {
+  const SordNode* node;  ///< Predicate or class, or NULL for an empty slot
+  CheckStats      stats; ///< Statistics, including nested checks
+} NodeStats;
+
+typedef struct ProfileFrameImpl ProfileFrame;
+
+/// A running check, which is on the stack of the function that runs it
+struct ProfileFrameImpl {
+  ProfileFrame*   parent;        ///< Check that this check is nested in
+  CheckKind       kind;          ///< Kind of check
+  const SordNode* key;           ///< Predicate or class, or NULL
+  double          start;         ///< Time when the check started
+  double          child_seconds; ///< Time spent in nested checks
+  size_t          searches;      ///< Number of searches before the check
+};
+
+/**
+   Statistics about the checks run on one thread.
+
+   The times for each kind of check exclude nested checks, so they add up to
+   the time spent checking on this thread, while those for each predicate or
+   class include them.
+*/
+typedef struct {
+  CheckStats    kinds[N_CHECK_KINDS]; ///< Statistics for each kind of check
+  NodeStats*    nodes;                ///< Statistics for each key
+  size_t        mask;                 ///< Number of node slots minus one
+  size_t        n_entries;            ///< Number of occupied node slots
+  size_t        n_searches;           ///< Total number of searches
+  ProfileFrame* top;                  ///< Innermost running check
+} Profile;
+
+/**
+   State for running checks on one thread.
+
+   Messages are written to a log rather than directly to stderr, so the logs
+   of checks that run in parallel can be printed in order.
+*/
+typedef struct {
+  SordModel*       model;          ///< Model being validated
+  const URIs*      uris;           ///< Vocabulary URIs
+  const Hierarchy* classes;        ///< Superclasses of each class
+  const Hierarchy* datatypes;      ///< Base datatypes of each datatype
+  const Changes*   changes;        ///< Changes to check, or NULL for all
+  Profile*         profile;        ///< Statistics, or NULL if not profiling
+  char*            log;            ///< Messages from the current task
+  size_t           log_len;        ///< Length of log in bytes
+  size_t           log_size;       ///< Allocated size of log in bytes
+  int              n_errors;       ///< Number of errors found
+  int              n_restrictions; ///< Number of restrictions checked
+#if USE_PCRE
+  const RegexCache* regexes;   ///< Every pattern in the model
+  pcre_jit_stack*   jit_stack; ///< Stack for JIT matches on this thread
+#endif
+} Checker;
+
+SORD_LOG_FUNC(2, 0)
+static void
+checker_vprintf(Checker* c, const char* fmt, va_list args)
+{
+  va_list copy;
+  va_copy(copy, args);
+  const int len = vsnprintf(NULL, 0, fmt, copy);
+  va_end(copy);
+  if (len <= 0) {
+    return;
   }
 
-  // Check minimum cardinality
-  const SordNode* minCard =
-    sord_get(model, restriction, uris->owl_minCardinality, NULL, NULL);
-  if (minCard) {
-    const unsigned m = atoi((const char*)sord_node_get_string(minCard));
-    if (values < m) {
-      st = errorf(quad,
-                  "Property %s on %s has %u < %u values",
-                  sord_node_get_string(prop),
-                  sord_node_get_string(instance),
-                  values,
-                  m);
-    }
+  if (c->log_len + (size_t)len + 1u > c->log_size) {
+    c->log_size = (c->log_len + (size_t)len + 1u) * 2u;
+    c->log      = (char*)realloc(c->log, c->log_size);
   }
 
-  // Check maximum cardinality
-  const SordNode* maxCard =
-    sord_get(model, restriction, uris->owl_maxCardinality, NULL, NULL);
-  if (maxCard) {
-    const unsigned m = atoi((const char*)sord_node_get_string(maxCard));
+  vsnprintf(c->log + c->log_len, (size_t)len + 1u, fmt, args);
+  c->log_len += (size_t)len;
+}
+
+SORD_LOG_FUNC(2, 3)
+static void
+checker_printf(Checker* c, const char* fmt, ...)
+{
+  va_list args;
+  va_start(args, fmt);
+  checker_vprintf(c, fmt, args);
+  va_end(args);
+}
+
+SORD_LOG_FUNC(3, 4)
+static int
+errorf(Checker* c, const SordQuad quad, const char* fmt, ...)
+{
+  va_list args;
+  va_start(args, fmt);
+  checker_printf(c, "error: ");
+  checker_vprintf(c, fmt, args);
+  va_end(args);
+
+  const char* sep = one_line_errors ? "\t" : "\n       ";
+  checker_printf(c,
+                 "%s%s%s%s%s%s\n",
+                 sep,
+                 (const char*)sord_node_get_string(quad[SORD_SUBJECT]),
+                 sep,
+                 (const char*)sord_node_get_string(quad[SORD_PREDICATE]),
+                 sep,
+                 (const char*)sord_node_get_string(quad[SORD_OBJECT]));
+
+  ++c->n_errors;
+  return 1;
+}
+
+/// Return true if statements about `node` must be checked
+static bool
+is_changed(const Checker* c, const SordNode* node)
+{
+  return !c->changes || node_set_contains(&c->changes->subjects, node);
+}
+
+static double
+current_seconds(void)
+{
+#if USE_CLOCK_GETTIME
+  struct timespec now = {0, 0};
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (double)now.tv_sec + (double)now.tv_nsec * 1e-9;
+#else
+  return (double)clock() / CLOCKS_PER_SEC;
+#endif
+}
+
+/// Return the statistics for `node`, adding them if necessary
+static NodeStats*
+profile_node_stats(Profile* profile, const SordNode* node)
+{
+  const size_t n_old = profile->nodes ? profile->mask + 1u : 0u;
+  if ((profile->n_entries + 1u) * 4u > n_old * 3u) {
+    // Double the number of slots, and move every entry
+    NodeStats* const old_nodes = profile->nodes;
+    const size_t     n_slots   = n_old ? n_old * 2u : 64u;
+
+    profile->nodes = (NodeStats*)calloc(n_slots, sizeof(NodeStats));
+    profile->mask  = n_slots - 1u;
+    for (size_t i = 0u; i < n_old; ++i) {
+      if (old_nodes[i].node) {
+        size_t j = node_slot(old_nodes[i].node, profile->mask);
+        while (profile->nodes[j].node) {
+          j = (j + 1u) & profile->mask;
+        }
+
+        profile->nodes[j] = old_nodes[i];
+      }
+    }
+
+    free(old_nodes);
+  }
+
+  size_t i = node_slot(node, profile->mask);
+  for (; profile->nodes[i].node; i = (i + 1u) & profile->mask) {
+    if (profile->nodes[i].node == node) {
+      return &profile->nodes[i];
+    }
+  }
+
+  profile->nodes[i].node = node;
+  ++profile->n_entries;
+  return &profile->nodes[i];
+}
+
+/**
+   Start timing a check if profiling.
+
+   @param key Predicate or class to record the check for, or NULL.
+*/
+static void
+profile_enter(Checker*        c,
+              ProfileFrame*   frame,
+              const CheckKind kind,
+              const SordNode* key)
+{
+  Profile* const profile = c->profile;
+  if (profile) {
+    frame->parent        = profile->top;
+    frame->kind          = kind;
+    frame->key           = key;
+    frame->child_seconds = 0.0;
+    frame->searches      = profile->n_searches;
+    frame->start         = current_seconds();
+    profile->top         = frame;
+  }
+}
+
+/// Finish timing a check started with profile_enter()
+static void
+profile_leave(Checker* c, ProfileFrame* frame)
+{
+  Profile* const profile = c->profile;
+  if (!profile) {
+    return;
+  }
+
+  const double      elapsed = current_seconds() - frame->start;
+  CheckStats* const stats   = &profile->kinds[frame->kind];
+
+  ++stats->calls;
+  stats->seconds += elapsed - frame->child_seconds;
+
+  profile->top = frame->parent;
+  if (frame->parent) {
+    frame->parent->child_seconds += elapsed;
+  }
+
+  if (frame->key) {
+    NodeStats* const node = profile_node_stats(profile, frame->key);
+
+    ++node->stats.calls;
+    node->stats.seconds += elapsed;
+    node->stats.searches += profile->n_searches - frame->searches;
+  }
+}
+
+/// Count a check without timing it, if profiling
+static void
+profile_count(Checker* c, const CheckKind kind)
+{
+  if (c->profile) {
+    ++c->profile->kinds[kind].calls;
+  }
+}
+
+/// Count a search of the model, for the innermost running check
+static void
+profile_search(Checker* c)
+{
+  Profile* const profile = c->profile;
+  if (profile) {
+    ++profile->n_searches;
+    if (profile->top) {
+      ++profile->kinds[profile->top->kind].searches;
+    }
+  }
+}
+
+static SordIter*
+checker_search(Checker*        c,
+               const SordNode* s,
+               const SordNode* p,
+               const SordNode* o,
+               const SordNode* g)
+{
+  profile_search(c);
+  return sord_search(c->model, s, p, o, g);
+}
+
+static bool
+checker_ask(Checker*        c,
+            const SordNode* s,
+            const SordNode* p,
+            const SordNode* o,
+            const SordNode* g)
+{
+  profile_search(c);
+  return sord_ask(c->model, s, p, o, g);
+}
+
+static uint64_t
+checker_count(Checker*        c,
+              const SordNode* s,
+              const SordNode* p,
+              const SordNode* o,
+              const SordNode* g)
+{
+  profile_search(c);
+  return sord_count(c->model, s, p, o, g);
+}
+
+/// Add the statistics in `src` to those in `dst`
+static void
+profile_merge(Profile* dst, const Profile* src)
+{
+  for (unsigned k = 0u; k < N_CHECK_KINDS; ++k) {
+    dst->kinds[k].calls += src->kinds[k].calls;
+    dst->kinds[k].seconds += src->kinds[k].seconds;
+    dst->kinds[k].searches += src->kinds[k].searches;
+  }
+
+  for (size_t i = 0u; src->nodes && i <= src->mask; ++i) {
+    if (src->nodes[i].node) {
+      NodeStats* const node = profile_node_stats(dst, src->nodes[i].node);
+
+      node->stats.calls += src->nodes[i].stats.calls;
+      node->stats.seconds += src->nodes[i].stats.seconds;
+      node->stats.searches += src->nodes[i].stats.searches;
+    }
+  }
+
+  dst->n_searches += src->n_searches;
+}
+
+static int
+node_stats_time_cmp(const void* a, const void* b)
+{
+  const double sa = ((const NodeStats*)a)->stats.seconds;
+  const double sb = ((const NodeStats*)b)->stats.seconds;
+
+  return (sa > sb) ? -1 : (sa < sb) ? 1 : 0;
+}
+
+/**
+   Print the kinds of check, and the slowest predicates and classes.
+
+   @param wall_seconds Elapsed time from the start to the end of checking.
+   @param n_threads Number of threads that checked, whose times are summed.
+*/
+static void
+print_profile(const Profile* profile,
+              const double   wall_seconds,
+              const unsigned n_threads)
+{
+  // Rank kinds of check by time, with an insertion sort since there are few
+  unsigned kinds[N_CHECK_KINDS];
+  for (unsigned k = 0u; k < N_CHECK_KINDS; ++k) {
+    const double seconds = profile->kinds[k].seconds;
+
+    unsigned i = k;
+    for (; i > 0u && profile->kinds[kinds[i - 1u]].seconds < seconds; --i) {
+      kinds[i] = kinds[i - 1u];
+    }
+
+    kinds[i] = k;
+  }
+
+  double check_seconds = 0.0;
+  for (unsigned k = 0u; k < N_CHECK_KINDS; ++k) {
+    check_seconds += profile->kinds[k].seconds;
+  }
+
+  fprintf(stderr,
+          "Checked in %.6f seconds of wall time with %zu searches\n"
+          "Checks took %.6f seconds summed over %u threads\n\n",
+          wall_seconds,
+          profile->n_searches,
+          check_seconds,
+          n_threads);
+
+  fprintf(stderr,
+          "%-12s %12s %12s %12s\n",
+          "Check",
+          "Seconds",
+          "Calls",
+          "Searches");
+  for (unsigned k = 0u; k < N_CHECK_KINDS; ++k) {
+    const CheckStats* const stats = &profile->kinds[kinds[k]];
+    if (kinds[k] == CHECK_HIERARCHY) {
+      // Only counted, and timed as part of other checks
+      fprintf(stderr,
+              "%-12s %12s %12zu %12zu\n",
+              check_kind_names[kinds[k]],
+              "-",
+              stats->calls,
+              stats->searches);
+    } else {
+      fprintf(stderr,
+              "%-12s %12.6f %12zu %12zu\n",
+              check_kind_names[kinds[k]],
+              stats->seconds,
+              stats->calls,
+              stats->searches);
+    }
+  }
+
+  // Rank predicates and classes by time
+  NodeStats* const nodes =
+    (NodeStats*)calloc(profile->n_entries + 1u, sizeof(NodeStats));
+  size_t n_nodes = 0u;
+  for (size_t i = 0u; profile->nodes && i <= profile->mask; ++i) {
+    if (profile->nodes[i].node) {
+      nodes[n_nodes++] = profile->nodes[i];
+    }
+  }
+
+  qsort(nodes, n_nodes, sizeof(NodeStats), node_stats_time_cmp);
+
+  fprintf(stderr,
+          "\n%12s %12s %12s  %s\n",
+          "Seconds",
+          "Calls",
+          "Searches",
+          "Predicate or class");
+  for (size_t i = 0u; i < n_nodes && i < PROFILE_N_HOT_SPOTS; ++i) {
+    fprintf(stderr,
+            "%12.6f %12zu %12zu  %s\n",
+            nodes[i].stats.seconds,
+            nodes[i].stats.calls,
+            nodes[i].stats.searches,
+            (const char*)sord_node_get_string(nodes[i].node));
+  }
+
+  free(nodes);
+}
+
+/**
+   Return the object of the first statement that matches (s p ?).
+
+   Unlike sord_get(), this does not add a reference to the node, so it does
+   not modify anything and can be called from several threads at once.
+*/
+static const SordNode*
+get_object(Checker* c, const SordNode* s, const SordNode* p)
+{
+  SordIter* const       i = checker_search(c, s, p, NULL, NULL);
+  const SordNode* const o = i ? sord_iter_get_node(i, SORD_OBJECT) : NULL;
+  sord_iter_free(i);
+  return o;
+}
+
+static bool
+is_descendant_of(Checker*         c,
+                 const Hierarchy* hierarchy,
+                 const SordNode*  child,
+                 const SordNode*  parent)
+{
+  if (!child) {
+    return false;
+  } else if (child == parent) {
+    return true;
+  }
+
+  profile_count(c, CHECK_HIERARCHY);
+
+  const Ancestors* const ancestors = hierarchy_find(hierarchy, child);
+
+  return ancestors && bsearch(&parent,
+                              ancestors->ancestors,
+                              ancestors->n_ancestors,
+                              sizeof(const SordNode*),
+                              node_address_cmp);
+}
+
+#if USE_PCRE
+
+static size_t
+regex_slot(const RegexCache* cache, const SordNode* pattern)
+{
+  // Drop the low bits, which are the same for every aligned node
+  return ((uintptr_t)pattern >> 4u) & cache->mask;
+}
+
+static Regex
+regex_compile(const SordNode* pattern)
+{
+  Regex regex = {pattern, NULL, NULL, false};
+
+  // Append a $ to the pattern so we only match if the entire string matches
+  size_t               len  = 0;
+  const uint8_t* const pat  = sord_node_get_string_counted(pattern, &len);
+  char* const          regx = (char*)malloc(len + 2);
+  memcpy(regx, pat, len);
+  regx[len]     = '$';
+  regx[len + 1] = '\0';
+
+  const char* err       = NULL;
+  int         erroffset = 0;
+  regex.re = pcre_compile(regx, PCRE_ANCHORED, &err, &erroffset, NULL);
+  free(regx);
+  if (!regex.re) {
+    fprintf(stderr,
+            "Error in pattern `%s' at offset %d (%s)\n",
+            (const char*)pat,
+            erroffset,
+            err);
+    return regex;
+  }
+
+  // Study the pattern, and compile it to machine code if possible
+  const char* study_err = NULL;
+#  if USE_PCRE_JIT
+  int jit     = 0;
+  regex.extra = pcre_study(regex.re, PCRE_STUDY_JIT_COMPILE, &study_err);
+  if (regex.extra) {
+    pcre_fullinfo(regex.re, regex.extra, PCRE_INFO_JIT, &jit);
+  }
+
+  regex.jit = jit;
+#  else
+  regex.extra = pcre_study(regex.re, 0, &study_err);
+#  endif
+
+  return regex;
+}
+
+static void
+regex_free(Regex* regex)
+{
+#  ifdef PCRE_STUDY_JIT_COMPILE
+  pcre_free_study(regex->extra);
+#  else
+  pcre_free(regex->extra);
+#  endif
+  pcre_free(regex->re);
+}
+
+/// Double the number of slots in `cache`, and move every entry
+static void
+regex_cache_grow(RegexCache* cache)
+{
+  Regex* const old_slots = cache->slots;
+  const size_t n_old     = old_slots ? cache->mask + 1u : 0u;
+  const size_t n_slots   = n_old ? n_old * 2u : 16u;
+
+  cache->slots = (Regex*)calloc(n_slots, sizeof(Regex));
+  cache->mask  = n_slots - 1u;
+  for (size_t i = 0u; i < n_old; ++i) {
+    if (old_slots[i].pattern) {
+      size_t j = regex_slot(cache, old_slots[i].pattern);
+      while (cache->slots[j].pattern) {
+        j = (j + 1u) & cache->mask;
+      }
+
+      cache->slots[j] = old_slots[i];
+    }
+  }
+
+  free(old_slots);
+}
+
+/// Return the compiled pattern for `pattern`, or NULL if it is not cached
+static const Regex*
+regex_cache_find(const RegexCache* cache, const SordNode* pattern)
+{
+  if (!cache->slots) {
+    return NULL;
+  }
+
+  size_t i = regex_slot(cache, pattern);
+  for (; cache->slots[i].pattern; i = (i + 1u) & cache->mask) {
+    if (cache->slots[i].pattern == pattern) {
+      return &cache->slots[i];
+    }
+  }
+
+  return NULL;
+}
+
+/**
+   Compile every pattern in `model` into `cache`.
+
+   Patterns are compiled in the order of the model, so errors in them are
+   reported once, in the same order with any number of threads.
+*/
+static void
+regex_cache_init(RegexCache* cache, SordModel* model, const URIs* uris)
+{
+  memset(cache, 0, sizeof(RegexCache));
+
+  SordIter* i = sord_search(model, NULL, uris->xsd_pattern, NULL, NULL);
+  for (; !sord_iter_end(i); sord_iter_next(i)) {
+    const SordNode* const pattern = sord_iter_get_node(i, SORD_OBJECT);
+    if (!regex_cache_find(cache, pattern)) {
+      if (!cache->slots ||
+          (cache->n_entries + 1u) * 4u > (cache->mask + 1u) * 3u) {
+        regex_cache_grow(cache);
+      }
+
+      size_t j = regex_slot(cache, pattern);
+      while (cache->slots[j].pattern) {
+        j = (j + 1u) & cache->mask;
+      }
+
+      cache->slots[j] = regex_compile(pattern);
+      ++cache->n_entries;
+    }
+  }
+  sord_iter_free(i);
+}
+
+static void
+regex_cache_clear(RegexCache* cache)
+{
+  for (size_t i = 0u; cache->slots && i <= cache->mask; ++i) {
+    if (cache->slots[i].pattern) {
+      regex_free(&cache->slots[i]);
+    }
+  }
+
+  free(cache->slots);
+}
+
+#endif // USE_PCRE
+
+static bool
+regexp_match(Checker* c, const SordNode* pattern, const char* str, size_t len)
+{
+#if USE_PCRE
+  ProfileFrame frame;
+  profile_enter(c, &frame, CHECK_PATTERN, NULL);
+
+  const Regex* const regex = regex_cache_find(c->regexes, pattern);
+
+  int rc = -1;
+  if (!regex || !regex->re) {
+    // Invalid patterns never match, and were reported when compiled
+#  if USE_PCRE_JIT
+  } else if (regex->jit) {
+    if (!c->jit_stack) {
+      c->jit_stack = pcre_jit_stack_alloc(32 * 1024, 1024 * 1024);
+    }
+
+    rc = pcre_jit_exec(regex->re,
+                       regex->extra,
+                       str,
+                       (int)len,
+                       0,
+                       0,
+                       NULL,
+                       0,
+                       c->jit_stack);
+#  endif
+  } else {
+    rc = pcre_exec(regex->re, regex->extra, str, (int)len, 0, 0, NULL, 0);
+  }
+
+  const bool result = rc >= 0;
+
+  profile_leave(c, &frame);
+  return result;
+#else
+  (void)c;
+  (void)pattern;
+  (void)str;
+  (void)len;
+  return true;
+#endif
+}
+
+static int
+bound_cmp(Checker*        c,
+          const SordNode* literal,
+          const SordNode* type,
+          const SordNode* bound)
+{
+  const char* str       = (const char*)sord_node_get_string(literal);
+  const char* bound_str = (const char*)sord_node_get_string(bound);
+  const bool  is_numeric =
+    is_descendant_of(c, c->datatypes, type, c->uris->xsd_decimal) ||
+    is_descendant_of(c, c->datatypes, type, c->uris->xsd_double);
+
+  if (is_numeric) {
+    const double fbound   = serd_strtod(bound_str, NULL);
+    const double fliteral = serd_strtod(str, NULL);
+    return ((fliteral < fbound) ? -1 : (fliteral > fbound) ? 1 : 0);
+  } else {
+    return strcmp(str, bound_str);
+  }
+}
+
+static bool
+do_check_restriction(Checker*        c,
+                     const SordNode* literal,
+                     const SordNode* type,
+                     const SordNode* restriction)
+{
+  const URIs* const uris = c->uris;
+
+  size_t      len = 0;
+  const char* str = (const char*)sord_node_get_string_counted(literal, &len);
+
+  // Check xsd:pattern
+  SordIter* p = checker_search(c, restriction, uris->xsd_pattern, 0, 0);
+  if (p) {
+    const SordNode* pat = sord_iter_get_node(p, SORD_OBJECT);
+    if (!regexp_match(c, pat, str, len)) {
+      checker_printf(c,
+                     "`%s' does not match <%s> pattern `%s'\n",
+                     sord_node_get_string(literal),
+                     sord_node_get_string(type),
+                     sord_node_get_string(pat));
+      sord_iter_free(p);
+      return false;
+    }
+    sord_iter_free(p);
+    ++c->n_restrictions;
+  }
+
+  // Check xsd:minInclusive
+  SordIter* l = checker_search(c, restriction, uris->xsd_minInclusive, 0, 0);
+  if (l) {
+    const SordNode* lower = sord_iter_get_node(l, SORD_OBJECT);
+    if (bound_cmp(c, literal, type, lower) < 0) {
+      checker_printf(c,
+                     "`%s' is not >= <%s> minimum `%s'\n",
+                     sord_node_get_string(literal),
+                     sord_node_get_string(type),
+                     sord_node_get_string(lower));
+      sord_iter_free(l);
+      return false;
+    }
+    sord_iter_free(l);
+    ++c->n_restrictions;
+  }
+
+  // Check xsd:maxInclusive
+  SordIter* u = checker_search(c, restriction, uris->xsd_maxInclusive, 0, 0);
+  if (u) {
+    const SordNode* upper = sord_iter_get_node(u, SORD_OBJECT);
+    if (bound_cmp(c, literal, type, upper) > 0) {
+      checker_printf(c,
+                     "`%s' is not <= <%s> maximum `%s'\n",
+                     sord_node_get_string(literal),
+                     sord_node_get_string(type),
+                     sord_node_get_string(upper));
+      sord_iter_free(u);
+      return false;
+    }
+    sord_iter_free(u);
+    ++c->n_restrictions;
+  }
+
+  return true; // Unknown restriction, be quietly tolerant
+}
+
+static bool
+check_restriction(Checker*        c,
+                  const SordNode* literal,
+                  const SordNode* type,
+                  const SordNode* restriction)
+{
+  ProfileFrame frame;
+  profile_enter(c, &frame, CHECK_RESTRICTION, NULL);
+
+  const bool result = do_check_restriction(c, literal, type, restriction);
+
+  profile_leave(c, &frame);
+  return result;
+}
+
+static bool
+do_literal_is_valid(Checker*        c,
+                    const SordQuad  quad,
+                    const SordNode* literal,
+                    const SordNode* type)
+{
+  const URIs* const uris = c->uris;
+
+  if (!type) {
+    return true;
+  }
+
+  /* Check that literal data is related to required type.  We don't do a
+     strict subtype check here because e.g. an xsd:decimal might be a valid
+     xsd:unsignedInt, which the pattern checks will verify, but if the
+     literal type is not related to the required type at all
+     (e.g. xsd:decimal and xsd:string) there is a problem. */
+  const SordNode* datatype = sord_node_get_datatype(literal);
+  if (datatype && datatype != type) {
+    if (!is_descendant_of(c, c->datatypes, datatype, type) &&
+        !is_descendant_of(c, c->datatypes, type, datatype) &&
+        !(sord_node_equals(datatype, uris->xsd_decimal) &&
+          is_descendant_of(c, c->datatypes, type, uris->xsd_double))) {
+      errorf(c,
+             quad,
+             "Literal `%s' datatype <%s> is not compatible with <%s>\n",
+             sord_node_get_string(literal),
+             sord_node_get_string(datatype),
+             sord_node_get_string(type));
+      return false;
+    }
+  }
+
+  // Find restrictions list
+  SordIter* rs = checker_search(c, type, uris->owl_withRestrictions, 0, 0);
+  if (sord_iter_end(rs)) {
+    return true; // No restrictions
+  }
+
+  // Walk list, checking each restriction
+  const SordNode* head = sord_iter_get_node(rs, SORD_OBJECT);
+  while (head) {
+    SordIter* f = checker_search(c, head, uris->rdf_first, 0, 0);
+    if (!f) {
+      break; // Reached end of restrictions list without failure
+    }
+
+    // Check this restriction
+    const bool good = check_restriction(
+      c, literal, type, sord_iter_get_node(f, SORD_OBJECT));
+    sord_iter_free(f);
+
+    if (!good) {
+      sord_iter_free(rs);
+      return false; // Failed, literal is invalid
+    }
+
+    // Seek to next list node
+    SordIter* n = checker_search(c, head, uris->rdf_rest, 0, 0);
+    head        = n ? sord_iter_get_node(n, SORD_OBJECT) : NULL;
+    sord_iter_free(n);
+  }
+
+  sord_iter_free(rs);
+
+  SordIter* s = checker_search(c, type, uris->owl_onDatatype, 0, 0);
+  if (s) {
+    const SordNode* super = sord_iter_get_node(s, SORD_OBJECT);
+    const bool      good  = do_literal_is_valid(c, quad, literal, super);
+    sord_iter_free(s);
+    return good; // Match iff literal also matches supertype
+  }
+
+  return true; // Matches top level type
+}
+
+static bool
+literal_is_valid(Checker*        c,
+                 const SordQuad  quad,
+                 const SordNode* literal,
+                 const SordNode* type)
+{
+  ProfileFrame frame;
+  profile_enter(c, &frame, CHECK_LITERAL, NULL);
+
+  const bool result = do_literal_is_valid(c, quad, literal, type);
+
+  profile_leave(c, &frame);
+  return result;
+}
+
+static bool
+do_check_type(Checker*        c,
+              const SordQuad  quad,
+              const SordNode* node,
+              const SordNode* type)
+{
+  const URIs* const uris = c->uris;
+
+  if (sord_node_equals(type, uris->rdfs_Resource) ||
+      sord_node_equals(type, uris->owl_Thing)) {
+    return true;
+  }
+
+  if (sord_node_get_type(node) == SORD_LITERAL) {
+    if (sord_node_equals(type, uris->rdfs_Literal)) {
+      return true;
+    } else if (sord_node_equals(type, uris->rdf_PlainLiteral)) {
+      return !sord_node_get_language(node);
+    } else {
+      return literal_is_valid(c, quad, node, type);
+    }
+  } else if (sord_node_get_type(node) == SORD_URI) {
+    if (sord_node_equals(type, uris->foaf_Document)) {
+      return true; // Questionable...
+    } else if (is_descendant_of(c, c->datatypes, type, uris->xsd_anyURI)) {
+      /* Type is any URI and this is a URI, so pass.  Restrictions on
+         anyURI subtypes are not currently checked (very uncommon). */
+      return true; // Type is anyURI, and this is a URI
+    } else {
+      SordIter* t = checker_search(c, node, uris->rdf_type, NULL, NULL);
+      for (; !sord_iter_end(t); sord_iter_next(t)) {
+        if (is_descendant_of(
+              c, c->classes, sord_iter_get_node(t, SORD_OBJECT), type)) {
+          sord_iter_free(t);
+          return true;
+        }
+      }
+      sord_iter_free(t);
+      return false;
+    }
+  } else {
+    return true; // Blanks often lack explicit types, ignore
+  }
+
+  return false;
+}
+
+static bool
+check_type(Checker*        c,
+           const SordQuad  quad,
+           const SordNode* node,
+           const SordNode* type)
+{
+  ProfileFrame frame;
+  profile_enter(c, &frame, CHECK_TYPE, NULL);
+
+  const bool result = do_check_type(c, quad, node, type);
+
+  profile_leave(c, &frame);
+  return result;
+}
+
+static uint64_t
+count_non_blanks(SordIter* i, SordQuadIndex field)
+{
+  uint64_t n = 0;
+  for (; !sord_iter_end(i); sord_iter_next(i)) {
+    const SordNode* node = sord_iter_get_node(i, field);
+    if (sord_node_get_type(node) != SORD_BLANK) {
+      ++n;
+    }
+  }
+  return n;
+}
+
+/// Check the use of the property in a statement
+static void
+check_property(Checker* c, const SordQuad quad)
+{
+  const URIs* const uris = c->uris;
+
+  const SordNode* subj = quad[SORD_SUBJECT];
+  const SordNode* pred = quad[SORD_PREDICATE];
+  const SordNode* obj  = quad[SORD_OBJECT];
+
+  ProfileFrame frame;
+  profile_enter(c, &frame, CHECK_PROPERTY, pred);
+
+  bool      is_any_property = false;
+  SordIter* t = checker_search(c, pred, uris->rdf_type, NULL, NULL);
+  for (; !sord_iter_end(t); sord_iter_next(t)) {
+    if (is_descendant_of(c,
+                         c->classes,
+                         sord_iter_get_node(t, SORD_OBJECT),
+                         uris->rdf_Property)) {
+      is_any_property = true;
+      break;
+    }
+  }
+  sord_iter_free(t);
+
+  const bool is_ObjectProperty =
+    checker_ask(c, pred, uris->rdf_type, uris->owl_ObjectProperty, 0);
+  const bool is_FunctionalProperty =
+    checker_ask(c, pred, uris->rdf_type, uris->owl_FunctionalProperty, 0);
+  const bool is_InverseFunctionalProperty = checker_ask(
+    c, pred, uris->rdf_type, uris->owl_InverseFunctionalProperty, 0);
+  const bool is_DatatypeProperty =
+    checker_ask(c, pred, uris->rdf_type, uris->owl_DatatypeProperty, 0);
+
+  if (!is_any_property) {
+    errorf(c, quad, "Use of undefined property");
+  }
+
+  if (!checker_ask(c, pred, uris->rdfs_label, NULL, NULL)) {
+    errorf(c, quad, "Property <%s> has no label", sord_node_get_string(pred));
+  }
+
+  if (is_DatatypeProperty && sord_node_get_type(obj) != SORD_LITERAL) {
+    errorf(c, quad, "Datatype property with non-literal value");
+  }
+
+  if (is_ObjectProperty && sord_node_get_type(obj) == SORD_LITERAL) {
+    errorf(c, quad, "Object property with literal value");
+  }
+
+  if (is_FunctionalProperty) {
+    SordIter*      o = checker_search(c, subj, pred, NULL, NULL);
+    const unsigned n = count_non_blanks(o, SORD_OBJECT);
+    if (n > 1) {
+      errorf(c, quad, "Functional property with %u objects", n);
+    }
+    sord_iter_free(o);
+  }
+
+  if (is_InverseFunctionalProperty) {
+    SordIter*      s = checker_search(c, NULL, pred, obj, NULL);
+    const unsigned n = count_non_blanks(s, SORD_SUBJECT);
+    if (n > 1) {
+      errorf(c, quad, "Inverse functional property with %u subjects", n);
+    }
+    sord_iter_free(s);
+  }
+
+  if (sord_node_equals(pred, uris->rdf_type) &&
+      !checker_ask(c, obj, uris->rdf_type, uris->rdfs_Class, NULL) &&
+      !checker_ask(c, obj, uris->rdf_type, uris->owl_Class, NULL)) {
+    errorf(c, quad, "Type is not a rdfs:Class or owl:Class");
+  }
+
+  if (sord_node_get_type(obj) == SORD_LITERAL &&
+      !literal_is_valid(c, quad, obj, sord_node_get_datatype(obj))) {
+    errorf(c, quad, "Literal does not match datatype");
+  }
+
+  SordIter* r = checker_search(c, pred, uris->rdfs_range, NULL, NULL);
+  for (; !sord_iter_end(r); sord_iter_next(r)) {
+    const SordNode* range = sord_iter_get_node(r, SORD_OBJECT);
+    if (!check_type(c, quad, obj, range)) {
+      errorf(
+        c, quad, "Object not in range <%s>\n", sord_node_get_string(range));
+    }
+  }
+  sord_iter_free(r);
+
+  SordIter* d = checker_search(c, pred, uris->rdfs_domain, NULL, NULL);
+  if (d) {
+    const SordNode* domain = sord_iter_get_node(d, SORD_OBJECT);
+    if (!check_type(c, quad, subj, domain)) {
+      errorf(
+        c, quad, "Subject not in domain <%s>", sord_node_get_string(domain));
+    }
+    sord_iter_free(d);
+  }
+
+  profile_leave(c, &frame);
+}
+
+static void
+check_instance(Checker*        c,
+               const SordNode* restriction,
+               const SordQuad  quad)
+{
+  const URIs* const uris     = c->uris;
+  const SordNode*   instance = quad[SORD_SUBJECT];
+
+  ProfileFrame frame;
+  profile_enter(c, &frame, CHECK_CARDINALITY, quad[SORD_OBJECT]);
+
+  const SordNode* prop = get_object(c, restriction, uris->owl_onProperty);
+  if (!prop) {
+    profile_leave(c, &frame);
+    return;
+  }
+
+  const unsigned values = checker_count(c, instance, prop, NULL, NULL);
+
+  // Check exact cardinality
+  const SordNode* card =
+    get_object(c, restriction, uris->owl_cardinality);
+  if (card) {
+    const unsigned n = atoi((const char*)sord_node_get_string(card));
+    if (values != n) {
+      errorf(c,
+             quad,
+             "Property %s on %s has %u != %u values",
+             sord_node_get_string(prop),
+             sord_node_get_string(instance),
+             values,
+             n);
+    }
+  }
+
+  // Check minimum cardinality
+  const SordNode* minCard =
+    get_object(c, restriction, uris->owl_minCardinality);
+  if (minCard) {
+    const unsigned m = atoi((const char*)sord_node_get_string(minCard));
+    if (values < m) {
+      errorf(c,
+             quad,
+             "Property %s on %s has %u < %u values",
+             sord_node_get_string(prop),
+             sord_node_get_string(instance),
+             values,
+             m);
+    }
+  }
+
+  // Check maximum cardinality
+  const SordNode* maxCard =
+    get_object(c, restriction, uris->owl_maxCardinality);
+  if (maxCard) {
+    const unsigned m = atoi((const char*)sord_node_get_string(maxCard));
     if (values < m) {
-      st = errorf(quad,
-                  "Property %s on %s has %u > %u values",
-                  sord_node_get_string(prop),
-                  sord_node_get_string(instance),
-                  values,
-                  m);
+      errorf(c,
+             quad,
+             "Property %s on %s has %u > %u values",
+             sord_node_get_string(prop),
+             sord_node_get_string(instance),
+             values,
+             m);
     }
   }
 
   // Check someValuesFrom
   SordIter* sf =
-    sord_search(model, restriction, uris->owl_someValuesFrom, NULL, NULL);
+    checker_search(c, restriction, uris->owl_someValuesFrom, NULL, NULL);
   if (sf) {
     const SordNode* type = sord_iter_get_node(sf, SORD_OBJECT);
 
-    SordIter* v     = sord_search(model, instance, prop, NULL, NULL);
+    SordIter* v     = checker_search(c, instance, prop, NULL, NULL);
     bool      found = false;
     for (; !sord_iter_end(v); sord_iter_next(v)) {
       const SordNode* value = sord_iter_get_node(v, SORD_OBJECT);
-      if (check_type(model, uris, quad, value, type)) {
+      if (check_type(c, quad, value, type)) {
         found = true;
         break;
       }
     }
     if (!found) {
-      st = errorf(quad,
-                  "%s has no <%s> values of type <%s>\n",
-                  sord_node_get_string(instance),
-                  sord_node_get_string(prop),
-                  sord_node_get_string(type));
+      errorf(c,
+             quad,
+             "%s has no <%s> values of type <%s>\n",
+             sord_node_get_string(instance),
+             sord_node_get_string(prop),
+             sord_node_get_string(type));
     }
     sord_iter_free(v);
   }
   sord_iter_free(sf);
 
-  return st;
+  profile_leave(c, &frame);
 }
 
-static int
-check_class_instances(SordModel*      model,
-                      const URIs*     uris,
+/**
+   Check the instances of a class and its subclasses against a restriction.
+
+   @param all If true, check every instance, otherwise only changed ones.
+*/
+static void
+check_class_instances(Checker*        c,
                       const SordNode* restriction,
-                      const SordNode* klass)
+                      const SordNode* klass,
+                      const bool      all)
 {
-  // Check immediate instances of this class
-  SordIter* i = sord_search(model, NULL, uris->rdf_type, klass, NULL);
+  const URIs* const uris = c->uris;
+
+  // Check immediate instances of this class, found among changes if possible
+  SordModel* const instances = all ? c->model : c->changes->instances;
+  profile_search(c);
+  SordIter* i = sord_search(instances, NULL, uris->rdf_type, klass, NULL);
   for (; !sord_iter_end(i); sord_iter_next(i)) {
     SordQuad quad;
     sord_iter_get(i, quad);
-    check_instance(model, uris, restriction, quad);
+    check_instance(c, restriction, quad);
   }
   sord_iter_free(i);
 
   // Check instances of all subclasses recursively
-  SordIter* s = sord_search(model, NULL, uris->rdfs_subClassOf, klass, NULL);
+  SordIter* s = checker_search(c, NULL, uris->rdfs_subClassOf, klass, NULL);
   for (; !sord_iter_end(s); sord_iter_next(s)) {
     const SordNode* subklass = sord_iter_get_node(s, SORD_SUBJECT);
-    check_class_instances(model, uris, restriction, subklass);
+    check_class_instances(
+      c, restriction, subklass, all || is_changed(c, subklass));
   }
   sord_iter_free(s);
+}
 
-  return 0;
+/// Check the instances of every class with a restriction, from its type
+static void
+check_restriction_instances(Checker* c, const SordQuad quad)
+{
+  const URIs* const uris        = c->uris;
+  const SordNode*   restriction = quad[SORD_SUBJECT];
+  if (!get_object(c, restriction, uris->owl_onProperty)) {
+    return;
+  }
+
+  SordIter* s =
+    checker_search(c, NULL, uris->rdfs_subClassOf, restriction, NULL);
+  for (; !sord_iter_end(s); sord_iter_next(s)) {
+    const SordNode* klass = sord_iter_get_node(s, SORD_SUBJECT);
+    check_class_instances(c, restriction, klass, is_changed(c, restriction));
+  }
+  sord_iter_free(s);
 }
 
-static int
-check_instances(SordModel* model, const URIs* uris)
+/// Function to check one statement
+typedef void (*CheckFunc)(Checker* c, const SordQuad quad);
+
+/** A check that is run on every statement that matches a pattern */
+typedef struct {
+  SordModel* model;      ///< Model of statements to check
+  SordQuad   pattern;    ///< Pattern of statements to check
+  CheckFunc  check;      ///< Function to check each statement
+  size_t     chunk_size; ///< Number of statements checked by each task
+} Pass;
+
+/** The log of a finished task, which is printed once all before it are */
+typedef struct {
+  char*  buf;  ///< Messages
+  size_t len;  ///< Length of messages in bytes
+  bool   done; ///< True once the task is finished
+} TaskLog;
+
+/**
+   A chunk of statements to check.
+
+   A chunk is either a range of the model from `begin` to the first statement
+   about `end`, or an array of statements found by a pattern.
+*/
+typedef struct {
+  SordIter*       begin;   ///< Start of range, or NULL for an array
+  const SordNode* end;     ///< Subject that ends the range, or NULL
+  SordQuad*       quads;   ///< First statement in array
+  size_t          n_quads; ///< Number of statements in array
+} PassTask;
+
+/**
+   A pass being run by several threads.
+
+   Statements are divided into chunks before the pass starts, and each thread
+   takes the next chunk as a task, so work is balanced even if some
+   statements take much longer to check than others.  The messages from each
+   task are printed in the order of the statements, so the output is the same
+   with any number of threads.
+*/
+typedef struct {
+  const Pass* pass;       ///< Pass to run
+  PassTask*   tasks;      ///< Chunks of statements to check
+  size_t      n_tasks;    ///< Number of tasks
+  size_t      next_task;  ///< Index of the next task to take
+  TaskLog*    logs;       ///< Log of each task
+  size_t      logs_size;  ///< Allocated number of logs
+  size_t      next_print; ///< Index of the next log to print
+#if USE_PTHREAD
+  pthread_mutex_t mutex; ///< Protects the fields above
+#endif
+} PassRun;
+
+typedef struct {
+  PassRun* run;     ///< Shared run of the pass
+  Checker* checker; ///< State for this thread
+} PassWorker;
+
+static void
+pass_lock(PassRun* run)
+{
+#if USE_PTHREAD
+  pthread_mutex_lock(&run->mutex);
+#else
+  (void)run;
+#endif
+}
+
+static void
+pass_unlock(PassRun* run)
+{
+#if USE_PTHREAD
+  pthread_mutex_unlock(&run->mutex);
+#else
+  (void)run;
+#endif
+}
+
+/// Finish a task with the log in `c`, and print every log that is ready
+static void
+pass_finish_task(PassRun* run, Checker* c, const size_t task)
+{
+  pass_lock(run);
+
+  if (task >= run->logs_size) {
+    const size_t old_size = run->logs_size;
+
+    run->logs_size = (task + 1u) * 2u;
+    run->logs = (TaskLog*)realloc(run->logs, run->logs_size * sizeof(TaskLog));
+    memset(run->logs + old_size,
+           0,
+           (run->logs_size - old_size) * sizeof(TaskLog));
+  }
+
+  const TaskLog log = {c->log, c->log_len, true};
+  run->logs[task]   = log;
+  c->log            = NULL;
+  c->log_len        = 0u;
+  c->log_size       = 0u;
+
+  for (; run->next_print < run->logs_size && run->logs[run->next_print].done;
+       ++run->next_print) {
+    TaskLog* const next = &run->logs[run->next_print];
+    if (next->len) {
+      fwrite(next->buf, 1, next->len, stderr);
+    }
+
+    free(next->buf);
+    next->buf = NULL;
+  }
+
+  pass_unlock(run);
+}
+
+static void*
+pass_work(void* data)
+{
+  PassWorker* const worker = (PassWorker*)data;
+  PassRun* const    run    = worker->run;
+  Checker* const    c      = worker->checker;
+  const Pass* const pass   = run->pass;
+
+  for (;;) {
+    pass_lock(run);
+    const size_t task = run->next_task++;
+    pass_unlock(run);
+    if (task >= run->n_tasks) {
+      break;
+    }
+
+    const PassTask* const t = &run->tasks[task];
+    if (t->begin) {
+      // Check every statement up to the first about the end subject
+      for (SordIter* i = t->begin; !sord_iter_end(i); sord_iter_next(i)) {
+        SordQuad quad;
+        sord_iter_get(i, quad);
+        if (quad[SORD_SUBJECT] == t->end) {
+          break;
+        }
+
+        pass->check(c, quad);
+      }
+    } else {
+      for (size_t i = 0u; i < t->n_quads; ++i) {
+        pass->check(c, t->quads[i]);
+      }
+    }
+
+    pass_finish_task(run, c, task);
+  }
+
+  return NULL;
+}
+
+/**
+   Divide the statements checked by a pass into tasks.
+
+   When every statement is checked, the model is split into ranges of
+   subjects with sord_split(), which is cheap.
+   Statements that match a pattern are collected into an array first, since
+   there are usually few of them, and their number is unknown.
+
+   @param quads Set to the array of matching statements, if any.
+*/
+static void
+pass_split(PassRun* run, SordQuad** quads)
+{
+  const Pass* const pass  = run->pass;
+  SordModel* const  model = pass->model;
+  const size_t      chunk = pass->chunk_size;
+
+  *quads = NULL;
+  if (!pass->pattern[0] && !pass->pattern[1] && !pass->pattern[2] &&
+      !pass->pattern[3]) {
+    const size_t     n_quads = sord_num_quads(model);
+    const size_t     n       = n_quads > chunk ? n_quads / chunk : 1u;
+    SordIter** const iters   = (SordIter**)calloc(n, sizeof(SordIter*));
+
+    run->n_tasks = sord_split(model, n, iters);
+    run->tasks   = (PassTask*)calloc(run->n_tasks, sizeof(PassTask));
+    for (size_t i = 0u; i < run->n_tasks; ++i) {
+      run->tasks[i].begin = iters[i];
+      run->tasks[i].end   = i + 1u < run->n_tasks
+                              ? sord_iter_get_node(iters[i + 1u], SORD_SUBJECT)
+                              : NULL;
+    }
+
+    free(iters);
+    return;
+  }
+
+  size_t    n_quads = 0u;
+  size_t    size    = 0u;
+  SordIter* i       = sord_find(model, pass->pattern);
+  for (; !sord_iter_end(i); sord_iter_next(i)) {
+    if (n_quads == size) {
+      size   = size ? size * 2u : 16u;
+      *quads = (SordQuad*)realloc(*quads, size * sizeof(SordQuad));
+    }
+
+    sord_iter_get(i, (*quads)[n_quads++]);
+  }
+  sord_iter_free(i);
+
+  run->n_tasks = (n_quads + chunk - 1u) / chunk;
+  run->tasks   = (PassTask*)calloc(run->n_tasks, sizeof(PassTask));
+  for (size_t t = 0u; t < run->n_tasks; ++t) {
+    const size_t start = t * chunk;
+
+    run->tasks[t].quads   = *quads + start;
+    run->tasks[t].n_quads = n_quads - start < chunk ? n_quads - start : chunk;
+  }
+}
+
+/// Run a pass with one checker per thread
+static void
+run_pass(const Pass* pass, Checker* checkers, const unsigned n_threads)
+{
+  PassRun run;
+  memset(&run, 0, sizeof(run));
+  run.pass = pass;
+
+  SordQuad* quads = NULL;
+  pass_split(&run, &quads);
+
+#if USE_PTHREAD
+  pthread_mutex_init(&run.mutex, NULL);
+
+  PassWorker* const workers =
+    (PassWorker*)calloc(n_threads, sizeof(PassWorker));
+  pthread_t* const threads = (pthread_t*)calloc(n_threads, sizeof(pthread_t));
+
+  unsigned n_started = 0u;
+  for (unsigned i = 1u; i < n_threads; ++i) {
+    workers[i].run     = &run;
+    workers[i].checker = &checkers[i];
+    if (!pthread_create(&threads[i], NULL, pass_work, &workers[i])) {
+      n_started = i;
+    } else {
+      break;
+    }
+  }
+
+  // Work on this thread as well, which is enough if no thread started
+  workers[0].run     = &run;
+  workers[0].checker = &checkers[0];
+  pass_work(&workers[0]);
+
+  for (unsigned i = 1u; i <= n_started; ++i) {
+    pthread_join(threads[i], NULL);
+  }
+
+  free(threads);
+  free(workers);
+  pthread_mutex_destroy(&run.mutex);
+#else
+  (void)n_threads;
+
+  PassWorker worker = {&run, &checkers[0]};
+  pass_work(&worker);
+#endif
+
+  for (size_t i = 0u; i < run.n_tasks; ++i) {
+    sord_iter_free(run.tasks[i].begin);
+  }
+
+  free(run.tasks);
+  free(quads);
+  free(run.logs);
+}
+
+/// Read every file as a separate document, in parallel if requested
+static void
+read_files(SordModel*         model,
+           const size_t       n_files,
+           const char* const* files,
+           const unsigned     n_threads)
+{
+  uint8_t**   paths    = (uint8_t**)calloc(n_files, sizeof(uint8_t*));
+  SerdStatus* statuses = (SerdStatus*)calloc(n_files, sizeof(SerdStatus));
+
+  size_t n_paths = 0u;
+  for (size_t i = 0u; i < n_files; ++i) {
+    const uint8_t* input       = (const uint8_t*)files[i];
+    uint8_t*       rel_in_path = serd_file_uri_parse(input, NULL);
+    uint8_t*       in_path     = absolute_path(rel_in_path);
+
+    free(rel_in_path);
+    if (!in_path) {
+      fprintf(stderr, "Skipping file %s\n", input);
+      continue;
+    }
+
+    paths[n_paths++] = in_path;
+  }
+
+  sord_read_files(model,
+                  SERD_TURTLE,
+                  n_paths,
+                  (const uint8_t* const*)paths,
+                  NULL,
+                  n_threads,
+                  statuses);
+
+  for (size_t i = 0u; i < n_paths; ++i) {
+    if (statuses[i]) {
+      fprintf(stderr,
+              "error reading %s: %s\n",
+              paths[i],
+              serd_strerror(statuses[i]));
+    }
+
+    free(paths[i]);
+  }
+  free(statuses);
+  free(paths);
+}
+
+/// Return true if a change to a statement with `pred` can affect any other
+static bool
+is_schema_predicate(const URIs* uris, const SordNode* pred)
+{
+  return pred == uris->rdfs_subClassOf || pred == uris->owl_equivalentClass ||
+         pred == uris->owl_onDatatype || pred == uris->owl_withRestrictions ||
+         pred == uris->rdf_first || pred == uris->rdf_rest ||
+         pred == uris->xsd_pattern || pred == uris->xsd_minInclusive ||
+         pred == uris->xsd_maxInclusive;
+}
+
+/**
+   Apply added and removed statements to `model`.
+
+   Blank nodes in added statements are renamed so they are distinct from
+   those in the model, since they are from a different document.  For the
+   same reason, removed statements with blank nodes never match any in the
+   model, so they are ignored.
+
+   The type of a value can affect whether the subjects that refer to it
+   satisfy owl:someValuesFrom restrictions, so the subjects of statements
+   with the subject of an rdf:type change as their object are also recorded.
+
+   @param changes Set to the nodes affected by every change.
+   @return True if a change may affect statements that are not about the
+   nodes in `changes`, so everything must be checked.
+*/
+static bool
+apply_changes(SordWorld*  world,
+              SordModel*  model,
+              SordModel*  added,
+              SordModel*  removed,
+              const URIs* uris,
+              Changes*    changes)
 {
-  int       st = 0;
-  SordIter* r =
-    sord_search(model, NULL, uris->rdf_type, uris->owl_Restriction, NULL);
+  NodeSet   retyped        = {NULL, 0u, 0u};
+  bool      schema_changed = false;
+  size_t    n_ignored      = 0u;
+  SordIter* r              = sord_begin(removed);
   for (; !sord_iter_end(r); sord_iter_next(r)) {
-    const SordNode* restriction = sord_iter_get_node(r, SORD_SUBJECT);
-    const SordNode* prop =
-      sord_get(model, restriction, uris->owl_onProperty, NULL, NULL);
-    if (!prop) {
+    SordQuad quad;
+    sord_iter_get(r, quad);
+    if (sord_node_get_type(quad[SORD_SUBJECT]) == SORD_BLANK ||
+        sord_node_get_type(quad[SORD_OBJECT]) == SORD_BLANK) {
+      ++n_ignored;
       continue;
     }
 
-    SordIter* c =
-      sord_search(model, NULL, uris->rdfs_subClassOf, restriction, NULL);
-    for (; !sord_iter_end(c); sord_iter_next(c)) {
-      const SordNode* klass = sord_iter_get_node(c, SORD_SUBJECT);
-      check_class_instances(model, uris, restriction, klass);
+    sord_remove(model, quad);
+    node_set_insert(&changes->subjects, quad[SORD_SUBJECT]);
+    node_set_insert(&changes->objects, quad[SORD_OBJECT]);
+    schema_changed |= is_schema_predicate(uris, quad[SORD_PREDICATE]);
+    if (quad[SORD_PREDICATE] == uris->rdf_type) {
+      node_set_insert(&retyped, quad[SORD_SUBJECT]);
     }
-    sord_iter_free(c);
   }
   sord_iter_free(r);
 
-  return st;
+  if (n_ignored) {
+    fprintf(stderr,
+            "warning: Ignored %zu removed statements with blank nodes\n",
+            n_ignored);
+  }
+
+  SordIter* a = sord_begin(added);
+  for (; !sord_iter_end(a); sord_iter_next(a)) {
+    SordQuad quad;
+    sord_iter_get(a, quad);
+
+    SordNode* renamed[4] = {NULL, NULL, NULL, NULL};
+    for (unsigned i = 0u; i < 4u; ++i) {
+      if (quad[i] && sord_node_get_type(quad[i]) == SORD_BLANK) {
+        const size_t len = strlen((const char*)sord_node_get_string(quad[i]));
+        char* const  id  = (char*)malloc(len + 2u);
+        id[0]            = 'd';
+        memcpy(id + 1, sord_node_get_string(quad[i]), len + 1u);
+        renamed[i] = sord_new_blank(world, (const uint8_t*)id);
+        quad[i]    = renamed[i];
+        free(id);
+      }
+    }
+
+    sord_add(model, quad);
+    node_set_insert(&changes->subjects, quad[SORD_SUBJECT]);
+    node_set_insert(&changes->objects, quad[SORD_OBJECT]);
+    schema_changed |= is_schema_predicate(uris, quad[SORD_PREDICATE]);
+    if (quad[SORD_PREDICATE] == uris->rdf_type) {
+      node_set_insert(&retyped, quad[SORD_SUBJECT]);
+    }
+
+    for (unsigned i = 0u; i < 4u; ++i) {
+      sord_node_free(world, renamed[i]);
+    }
+  }
+  sord_iter_free(a);
+
+  // Find every subject that refers to a retyped node in the changed model
+  for (size_t i = 0u; retyped.slots && i <= retyped.mask; ++i) {
+    if (retyped.slots[i]) {
+      SordIter* u = sord_search(model, NULL, NULL, retyped.slots[i], NULL);
+      for (; !sord_iter_end(u); sord_iter_next(u)) {
+        node_set_insert(&changes->referrers,
+                        sord_iter_get_node(u, SORD_SUBJECT));
+      }
+      sord_iter_free(u);
+    }
+  }
+  free(retyped.slots);
+
+  return schema_changed;
+}
+
+/// Return true if instances of `klass` are properties
+static bool
+is_property_class(const URIs*      uris,
+                  const Hierarchy* classes,
+                  const SordNode*  klass)
+{
+  if (klass == uris->rdf_Property || klass == uris->owl_ObjectProperty ||
+      klass == uris->owl_DatatypeProperty ||
+      klass == uris->owl_FunctionalProperty ||
+      klass == uris->owl_InverseFunctionalProperty) {
+    return true;
+  }
+
+  const SordNode* const  property  = uris->rdf_Property;
+  const Ancestors* const ancestors = hierarchy_find(classes, klass);
+
+  return ancestors && bsearch(&property,
+                              ancestors->ancestors,
+                              ancestors->n_ancestors,
+                              sizeof(const SordNode*),
+                              node_address_cmp);
+}
+
+/// Return true if `node` has a property type, or no type at all
+static bool
+may_be_property(SordModel*       model,
+                const URIs*      uris,
+                const Hierarchy* classes,
+                const SordNode*  node)
+{
+  bool      typed    = false;
+  bool      property = false;
+  SordIter* t        = sord_search(model, node, uris->rdf_type, NULL, NULL);
+  for (; !property && !sord_iter_end(t); sord_iter_next(t)) {
+    const SordNode* const type = sord_iter_get_node(t, SORD_OBJECT);
+
+    typed    = true;
+    property = is_property_class(uris, classes, type);
+  }
+  sord_iter_free(t);
+
+  return property || !typed;
+}
+
+/**
+   Return true if a statement in `changed` may describe a property.
+
+   Every use of a predicate is checked against its types, label, domain, and
+   range, but statements can not be found by predicate without searching the
+   whole model, so if any of these change, everything must be checked.  A
+   label is taken to be that of a property if its subject has a property
+   type, or no type at all.
+*/
+static bool
+changes_property(SordModel*       changed,
+                 SordModel*       model,
+                 const URIs*      uris,
+                 const Hierarchy* classes)
+{
+  bool      result = false;
+  SordIter* i      = sord_begin(changed);
+  for (; !result && !sord_iter_end(i); sord_iter_next(i)) {
+    SordQuad quad;
+    sord_iter_get(i, quad);
+
+    const SordNode* const subj = quad[SORD_SUBJECT];
+    const SordNode* const pred = quad[SORD_PREDICATE];
+    if (sord_node_get_type(subj) == SORD_URI) {
+      result = pred == uris->rdfs_domain || pred == uris->rdfs_range ||
+               (pred == uris->rdf_type &&
+                is_property_class(uris, classes, quad[SORD_OBJECT])) ||
+               (pred == uris->rdfs_label &&
+                may_be_property(model, uris, classes, subj));
+    }
+  }
+  sord_iter_free(i);
+
+  return result;
+}
+
+/// Add every statement in `src` that matches a pattern to `dst`
+static void
+add_matches(SordModel*      dst,
+            SordModel*      src,
+            const SordNode* s,
+            const SordNode* p,
+            const SordNode* o)
+{
+  SordIter* i = sord_search(src, s, p, o, NULL);
+  for (; !sord_iter_end(i); sord_iter_next(i)) {
+    SordQuad quad;
+    sord_iter_get(i, quad);
+    sord_add(dst, quad);
+  }
+  sord_iter_free(i);
+}
+
+/**
+   Find the statements and instances in `model` that `changes` affect.
+
+   Statements are found from the changed nodes with the SPO and OPS indices,
+   so this takes time proportional to the size of the changes, not the model.
+   Statements found more than once are only added once.
+*/
+static void
+find_changed(SordWorld*  world,
+             SordModel*  model,
+             const URIs* uris,
+             Changes*    changes)
+{
+  const NodeSet* const subjects  = &changes->subjects;
+  const NodeSet* const objects   = &changes->objects;
+  const NodeSet* const referrers = &changes->referrers;
+
+  changes->statements = sord_new(world, SORD_SPO, false);
+  changes->instances  = sord_new(world, SORD_SPO | SORD_OPS, false);
+
+  // Statements about or with a changed node, and changed instances
+  for (size_t i = 0u; subjects->slots && i <= subjects->mask; ++i) {
+    const SordNode* const node = subjects->slots[i];
+    if (node) {
+      add_matches(changes->statements, model, node, NULL, NULL);
+      add_matches(changes->statements, model, NULL, NULL, node);
+      add_matches(changes->instances, model, node, uris->rdf_type, NULL);
+    }
+  }
+
+  // Instances with a value whose type changed
+  for (size_t i = 0u; referrers->slots && i <= referrers->mask; ++i) {
+    const SordNode* const node = referrers->slots[i];
+    if (node) {
+      add_matches(changes->instances, model, node, uris->rdf_type, NULL);
+    }
+  }
+
+  // Statements of inverse functional properties with a changed object
+  const SordNode* const ifp = uris->owl_InverseFunctionalProperty;
+  for (size_t i = 0u; objects->slots && i <= objects->mask; ++i) {
+    const SordNode* const node = objects->slots[i];
+    if (node && !node_set_contains(subjects, node)) {
+      SordIter* o = sord_search(model, NULL, NULL, node, NULL);
+      for (; !sord_iter_end(o); sord_iter_next(o)) {
+        SordQuad quad;
+        sord_iter_get(o, quad);
+        if (sord_ask(model, quad[SORD_PREDICATE], uris->rdf_type, ifp, NULL)) {
+          sord_add(changes->statements, quad);
+        }
+      }
+      sord_iter_free(o);
+    }
+  }
+}
+
+#if USE_PTHREAD && defined(_SC_NPROCESSORS_ONLN)
+
+static unsigned
+default_n_threads(void)
+{
+  const long n_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+  return (n_cpus > 0) ? (unsigned)n_cpus : 1u;
+}
+
+#else
+
+static unsigned
+default_n_threads(void)
+{
+  return 1u;
 }
 
+#endif
+
 int
 main(int argc, char** argv)
 {
@@ -700,10 +2289,48 @@ main(int argc, char** argv)
     return print_usage(argv[0], true);
   }
 
-  int a = 1;
+  const char** added_files =
+    (const char**)calloc((size_t)argc, sizeof(const char*));
+  const char** removed_files =
+    (const char**)calloc((size_t)argc, sizeof(const char*));
+  size_t       n_added       = 0u;
+  size_t       n_removed     = 0u;
+
+  bool profile   = false;
+  long n_threads = 1;
+  int  a         = 1;
   for (; a < argc && argv[a][0] == '-'; ++a) {
-    if (argv[a][1] == 'l') {
+    if (argv[a][1] == 'a' || argv[a][1] == 'r') {
+      if (++a == argc) {
+        fprintf(stderr,
+                "%s: Option requires an argument -- '%c'\n",
+                argv[0],
+                argv[a - 1][1]);
+        return print_usage(argv[0], true);
+      }
+
+      if (argv[a - 1][1] == 'a') {
+        added_files[n_added++] = argv[a];
+      } else {
+        removed_files[n_removed++] = argv[a];
+      }
+    } else if (argv[a][1] == 'j') {
+      if (++a == argc) {
+        fprintf(stderr, "%s: Option requires an argument -- 'j'\n", argv[0]);
+        return print_usage(argv[0], true);
+      }
+
+      char* endptr = NULL;
+      n_threads    = strtol(argv[a], &endptr, 10);
+      if (*endptr || n_threads < 0 || n_threads > 1024) {
+        fprintf(
+          stderr, "%s: Invalid number of threads `%s'\n", argv[0], argv[a]);
+        return print_usage(argv[0], true);
+      }
+    } else if (argv[a][1] == 'l') {
       one_line_errors = true;
+    } else if (argv[a][1] == 'P') {
+      profile = true;
     } else if (argv[a][1] == 'v') {
       return print_version();
     } else {
@@ -712,37 +2339,22 @@ main(int argc, char** argv)
     }
   }
 
-  SordWorld*  world  = sord_world_new();
-  SordModel*  model  = sord_new(world, SORD_SPO | SORD_OPS, false);
-  SerdEnv*    env    = serd_env_new(&SERD_NODE_NULL);
-  SerdReader* reader = sord_new_reader(model, env, SERD_TURTLE, NULL);
-
-  for (; a < argc; ++a) {
-    const uint8_t* input       = (const uint8_t*)argv[a];
-    uint8_t*       rel_in_path = serd_file_uri_parse(input, NULL);
-    uint8_t*       in_path     = absolute_path(rel_in_path);
-
-    free(rel_in_path);
-    if (!in_path) {
-      fprintf(stderr, "Skipping file %s\n", input);
-      continue;
-    }
-
-    SerdURI  base_uri;
-    SerdNode base_uri_node =
-      serd_node_new_file_uri(in_path, NULL, &base_uri, true);
+  SordWorld* world = sord_world_new();
+  SordModel* model = sord_new(world, SORD_SPO | SORD_OPS, false);
 
-    serd_env_set_base_uri(env, &base_uri_node);
-    const SerdStatus st = serd_reader_read_file(reader, in_path);
-    if (st) {
-      fprintf(stderr, "error reading %s: %s\n", in_path, serd_strerror(st));
-    }
+  const int n_inputs = argc - a;
+  read_files(model,
+             (size_t)n_inputs,
+             (const char* const*)argv + a,
+             (unsigned)n_threads);
 
-    serd_node_free(&base_uri_node);
-    free(in_path);
-  }
-  serd_reader_free(reader);
-  serd_env_free(env);
+  // Read changes into separate models, which are applied below
+  SordModel* added   = sord_new(world, SORD_SPO, false);
+  SordModel* removed = sord_new(world, SORD_SPO, false);
+  read_files(added, n_added, added_files, (unsigned)n_threads);
+  read_files(removed, n_removed, removed_files, (unsigned)n_threads);
+  free(removed_files);
+  free(added_files);
 
 #define URI(prefix, suffix) \
   uris.prefix##_##suffix = sord_new_uri(world, NS_##prefix #suffix)
@@ -790,15 +2402,123 @@ main(int argc, char** argv)
   fprintf(stderr, "warning: Built without PCRE, datatypes not checked.\n");
 #endif
 
-  const int prop_st = check_properties(model, &uris);
-  const int inst_st = check_instances(model, &uris);
+  // Apply any changes
+  Changes changes;
+  memset(&changes, 0, sizeof(changes));
+
+  const bool changed = n_added || n_removed;
+  const bool schema_changed =
+    changed && apply_changes(world, model, added, removed, &uris, &changes);
+
+  // Find every ancestor of every class and datatype once, before checking
+  Hierarchy classes;
+  Hierarchy datatypes;
+  hierarchy_init(
+    &classes, model, uris.rdfs_subClassOf, uris.owl_equivalentClass);
+  hierarchy_init(
+    &datatypes, model, uris.owl_onDatatype, uris.owl_equivalentClass);
+
+  // Check only what the changes affect, unless they may affect anything
+  const bool incremental =
+    changed && !schema_changed &&
+    !changes_property(added, model, &uris, &classes) &&
+    !changes_property(removed, model, &uris, &classes);
+  if (incremental) {
+    find_changed(world, model, &uris, &changes);
+  }
+
+  // Check every affected statement, then the instances of every restriction
+  const Pass properties = {incremental ? changes.statements : model,
+                           {NULL, NULL, NULL, NULL},
+                           check_property,
+                           PROPERTY_CHUNK_SIZE};
+  const Pass instances = {model,
+                          {NULL, uris.rdf_type, uris.owl_Restriction, NULL},
+                          check_restriction_instances,
+                          1u};
+
+#if USE_PCRE
+  // Compile every pattern once, so checkers on every thread can share them
+  RegexCache regexes;
+  regex_cache_init(&regexes, model, &uris);
+#endif
+
+  const unsigned n_checkers =
+    n_threads ? (unsigned)n_threads : default_n_threads();
+  Checker* const checkers = (Checker*)calloc(n_checkers, sizeof(Checker));
+  for (unsigned i = 0u; i < n_checkers; ++i) {
+    checkers[i].model     = model;
+    checkers[i].uris      = &uris;
+    checkers[i].classes   = &classes;
+    checkers[i].datatypes = &datatypes;
+    checkers[i].changes   = incremental ? &changes : NULL;
+    checkers[i].profile =
+      profile ? (Profile*)calloc(1, sizeof(Profile)) : NULL;
+#if USE_PCRE
+    checkers[i].regexes = &regexes;
+#endif
+  }
+
+  const double check_start = current_seconds();
+
+  run_pass(&properties, checkers, n_checkers);
+
+  // Only errors in properties affect the exit status, as they always have
+  int n_property_errors = 0;
+  for (unsigned i = 0u; i < n_checkers; ++i) {
+    n_property_errors += checkers[i].n_errors;
+  }
+
+  run_pass(&instances, checkers, n_checkers);
+
+  if (profile) {
+    // Print the statistics of every thread together
+    Profile total;
+    memset(&total, 0, sizeof(total));
+    for (unsigned i = 0u; i < n_checkers; ++i) {
+      profile_merge(&total, checkers[i].profile);
+    }
+
+    print_profile(&total, current_seconds() - check_start, n_checkers);
+    free(total.nodes);
+  }
+
+  int n_errors       = 0;
+  int n_restrictions = 0;
+  for (unsigned i = 0u; i < n_checkers; ++i) {
+    n_errors += checkers[i].n_errors;
+    n_restrictions += checkers[i].n_restrictions;
+#if USE_PCRE
+    if (checkers[i].jit_stack) {
+      pcre_jit_stack_free(checkers[i].jit_stack);
+    }
+#endif
+    if (checkers[i].profile) {
+      free(checkers[i].profile->nodes);
+      free(checkers[i].profile);
+    }
+    free(checkers[i].log);
+  }
+  free(checkers);
+#if USE_PCRE
+  regex_cache_clear(&regexes);
+#endif
+  hierarchy_free(&datatypes);
+  hierarchy_free(&classes);
+  sord_free(changes.instances);
+  sord_free(changes.statements);
+  free(changes.referrers.slots);
+  free(changes.objects.slots);
+  free(changes.subjects.slots);
 
   printf("Found %d errors among %d files (checked %d restrictions)\n",
          n_errors,
-         argc - 1,
+         n_inputs,
          n_restrictions);
 
+  sord_free(removed);
+  sord_free(added);
   sord_free(model);
   sord_world_free(world);
-  return prop_st || inst_st;
+  return n_property_errors > 0;
 }
@@ -14,6 +14,8 @@
   OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
 */
 
+#define _POSIX_C_SOURCE 200809L // for clock_gettime and getrusage
+
 #include "serd/serd.h"
 #include "sord/sord.h"
 #include "sord_config.h"
@@ -22,11 +24,17 @@
 #  include <windows.h>
 #endif
 
+#if USE_GETRUSAGE
+#  include <sys/resource.h>
+#endif
+
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 
 #define SORDI_ERROR(msg) fprintf(stderr, "sordi: " msg)
 #define SORDI_ERRORF(fmt, ...) fprintf(stderr, "sordi: " fmt, __VA_ARGS__)
@@ -59,10 +67,20 @@ print_usage(const char* name, bool error)
   fprintf(os, "Load and re-serialise RDF data.\n");
   fprintf(os, "Use - for INPUT to read from standard input.\n\n");
   fprintf(os, "  -h           Display this help and exit\n");
-  fprintf(os, "  -i SYNTAX    Input syntax (`turtle' or `ntriples')\n");
-  fprintf(os, "  -o SYNTAX    Output syntax (`turtle' or `ntriples')\n");
+  fprintf(os, "  -i SYNTAX    Input syntax (turtle/ntriples/nquads/trig)\n");
+  fprintf(os, "  -j THREADS   Number of threads to use (0 for auto)\n");
+  fprintf(os, "  -n           Load input without writing any output\n");
+  fprintf(os, "  -o SYNTAX    Output syntax (turtle/ntriples/nquads/trig)\n");
+  fprintf(os, "  -p S P O G   Only write statements that match a pattern\n");
   fprintf(os, "  -s INPUT     Parse INPUT as string (terminates options)\n");
+  fprintf(os, "  -S           Print statistics as JSON to stderr\n");
+  fprintf(os, "  -t           Write statements as they are read\n");
+  fprintf(os, "  -T DIRECTORY Write temporary files for -x to DIRECTORY\n");
+  fprintf(os, "  -u MEMORY    Stream, dropping duplicates within MEMORY MiB\n");
+  fprintf(os, "  -U MEMORY    Like -u, but remember statements by hash only\n");
   fprintf(os, "  -v           Display version information and exit\n");
+  fprintf(os, "  -x MEMORY    Sort in MEMORY MiB without loading a model\n");
+  fprintf(os, "  -z FORMAT    Compress output (gzip/zstd)\n");
   return error ? 1 : 0;
 }
 
@@ -73,6 +91,10 @@ set_syntax(SerdSyntax* syntax, const char* name)
     *syntax = SERD_TURTLE;
   } else if (!strcmp(name, "ntriples")) {
     *syntax = SERD_NTRIPLES;
+  } else if (!strcmp(name, "nquads")) {
+    *syntax = SERD_NQUADS;
+  } else if (!strcmp(name, "trig")) {
+    *syntax = SERD_TRIG;
   } else {
     SORDI_ERRORF("unknown syntax `%s'\n", name);
     return false;
@@ -80,6 +102,395 @@ set_syntax(SerdSyntax* syntax, const char* name)
   return true;
 }
 
+static bool
+set_compression(SordCompression* compression, const char* name)
+{
+  if (!strcmp(name, "gzip")) {
+    *compression = SORD_COMPRESSION_GZIP;
+  } else if (!strcmp(name, "zstd")) {
+    *compression = SORD_COMPRESSION_ZSTD;
+  } else {
+    SORDI_ERRORF("unknown compression `%s'\n", name);
+    return false;
+  }
+
+  if (!sord_compression_supported(*compression)) {
+    SORDI_ERRORF("`%s' compression is not supported by this build\n", name);
+    return false;
+  }
+
+  return true;
+}
+
+/// Parse an amount of memory in MiB
+static bool
+parse_memory(const char* str, long* mib)
+{
+  char* endptr = NULL;
+  *mib         = strtol(str, &endptr, 10);
+  if (*endptr || *mib < 1 || *mib > 1048576) {
+    SORDI_ERRORF("invalid amount of memory `%s'\n", str);
+    return false;
+  }
+
+  return true;
+}
+
+/**
+   Return the indices needed to find a pattern without filtering.
+
+   A model always has SPO, and graph indices are added when the graph is
+   given, so this only adds another index when the subject is not given first.
+*/
+static unsigned
+pattern_indices(const char* const pattern[4])
+{
+  const bool s = strcmp(pattern[SORD_SUBJECT], "_");
+  const bool p = strcmp(pattern[SORD_PREDICATE], "_");
+  const bool o = strcmp(pattern[SORD_OBJECT], "_");
+
+  if (s) {
+    return (o && !p) ? SORD_SOP : SORD_SPO;
+  }
+
+  if (p) {
+    return o ? SORD_OPS : SORD_POS;
+  }
+
+  return o ? SORD_OPS : SORD_SPO;
+}
+
+/**
+   Set `node` to the node written as `str` in a pattern.
+
+   Nodes are written as in Turtle, as <URI>, prefix:name, _:label, or "text"
+   optionally followed by @lang or ^^datatype.  CURIEs and relative URIs are
+   resolved with the prefixes and base URI of the input.  A lone `_' is a
+   wildcard, which sets `node` to NULL.
+*/
+static bool
+parse_pattern_node(SordWorld* const  world,
+                   SerdEnv* const    env,
+                   const char* const str,
+                   SordNode** const  node)
+{
+  *node = NULL;
+  if (!strcmp(str, "_")) {
+    return true;
+  }
+
+  // Copy the string so parts of it can be terminated in place
+  const size_t len  = strlen(str);
+  char* const  copy = (char*)calloc(len + 1u, 1u);
+  memcpy(copy, str, len);
+
+  bool valid = true;
+  if (copy[0] == '<' && len > 1 && copy[len - 1] == '>') {
+    copy[len - 1] = '\0';
+
+    const SerdNode uri =
+      serd_node_from_string(SERD_URI, (const uint8_t*)copy + 1);
+
+    *node = sord_node_from_serd_node(world, env, &uri, NULL, NULL);
+  } else if (!strncmp(copy, "_:", 2)) {
+    const SerdNode blank =
+      serd_node_from_string(SERD_BLANK, (const uint8_t*)copy + 2);
+
+    *node = sord_node_from_serd_node(world, env, &blank, NULL, NULL);
+  } else if (copy[0] == '"') {
+    char* const end    = strrchr(copy, '"');
+    SerdNode    lang   = SERD_NODE_NULL;
+    SordNode*   dtype  = NULL;
+    const char* suffix = end + 1;
+    if (end == copy) {
+      valid = false;
+    } else if (suffix[0] == '@') {
+      lang = serd_node_from_string(SERD_LITERAL, (const uint8_t*)suffix + 1);
+    } else if (!strncmp(suffix, "^^", 2)) {
+      valid = parse_pattern_node(world, env, suffix + 2, &dtype) && dtype;
+    } else {
+      valid = !suffix[0];
+    }
+
+    if (valid) {
+      *end = '\0';
+
+      const SerdNode text =
+        serd_node_from_string(SERD_LITERAL, (const uint8_t*)copy + 1);
+
+      *node = sord_node_from_serd_node(world,
+                                       env,
+                                       &text,
+                                       sord_node_to_serd_node(dtype),
+                                       lang.buf ? &lang : NULL);
+    }
+
+    sord_node_free(world, dtype);
+  } else {
+    const SerdNode curie =
+      serd_node_from_string(SERD_CURIE, (const uint8_t*)copy);
+
+    *node = sord_node_from_serd_node(world, env, &curie, NULL, NULL);
+  }
+
+  free(copy);
+  if (!*node) {
+    SORDI_ERRORF("invalid pattern node `%s'\n", str);
+    return false;
+  }
+
+  return true;
+}
+
+/// Return a time in seconds, which is only meaningful for intervals
+static double
+current_seconds(void)
+{
+#if USE_CLOCK_GETTIME
+  struct timespec now = {0, 0};
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (double)now.tv_sec + (double)now.tv_nsec * 1e-9;
+#else
+  return (double)clock() / CLOCKS_PER_SEC;
+#endif
+}
+
+/// Return the peak resident set size of this process in bytes, or zero
+static size_t
+peak_rss(void)
+{
+#if USE_GETRUSAGE
+  struct rusage usage;
+  if (!getrusage(RUSAGE_SELF, &usage)) {
+#  ifdef __APPLE__
+    return (size_t)usage.ru_maxrss;
+#  else
+    return (size_t)usage.ru_maxrss * 1024u; // In KiB elsewhere
+#  endif
+  }
+#endif
+
+  return 0u;
+}
+
+/**
+   Print statistics about loading and writing a model as JSON.
+
+   Times are in seconds.  Every index the model has is listed, named by its
+   ordering, with a G prefix for indices with graphs.
+*/
+static void
+print_stats(FILE* const            os,
+            const SordWorld* const world,
+            const SordModel* const model,
+            const double           load_seconds,
+            const double           write_seconds)
+{
+  static const char* const orders[] = {
+    "SPO", "SOP", "OPS", "OSP", "PSO", "POS"};
+
+  const size_t n_quads = sord_num_quads(model);
+  const double rate =
+    (load_seconds > 0.0) ? (double)n_quads / load_seconds : 0.0;
+
+  fprintf(os, "{\n");
+  fprintf(os, "  \"load_seconds\": %.6f,\n", load_seconds);
+  fprintf(os, "  \"write_seconds\": %.6f,\n", write_seconds);
+  fprintf(os, "  \"quads_per_second\": %.0f,\n", rate);
+  fprintf(os, "  \"nodes\": %zu,\n", sord_num_nodes(world));
+  fprintf(os, "  \"quads\": %zu,\n", n_quads);
+  fprintf(os, "  \"node_bytes\": %zu,\n", sord_num_node_bytes(world));
+  fprintf(os, "  \"indices\": {");
+
+  const char* sep = "";
+  for (unsigned g = 0u; g < 2u; ++g) {
+    for (unsigned i = 0u; i < 6u; ++i) {
+      SordIndexStats index = {0u, 0u, 0.0};
+      if (sord_index_stats(model, (SordIndexOption)(1u << i), g, &index)) {
+        fprintf(os,
+                "%s\n    \"%s%s\": "
+                "{\"pages\": %zu, \"bytes\": %zu, \"fill\": %.3f}",
+                sep,
+                g ? "G" : "",
+                orders[i],
+                index.n_pages,
+                index.n_bytes,
+                index.fill);
+        sep = ",";
+      }
+    }
+  }
+
+  fprintf(os, "\n  },\n");
+
+  const size_t rss = peak_rss();
+  if (rss) {
+    fprintf(os, "  \"peak_rss_bytes\": %zu\n", rss);
+  } else {
+    fprintf(os, "  \"peak_rss_bytes\": null\n");
+  }
+
+  fprintf(os, "}\n");
+}
+
+static SerdStyle
+output_style(SerdSyntax syntax)
+{
+  if (syntax == SERD_NTRIPLES || syntax == SERD_NQUADS) {
+    // Escape to ASCII like sord_write_lines(), so all paths write the same
+    return (SerdStyle)(SERD_STYLE_RESOLVED | SERD_STYLE_ASCII);
+  }
+
+  return (SerdStyle)(SERD_STYLE_RESOLVED | SERD_STYLE_CURIED |
+                     SERD_STYLE_ABBREVIATED);
+}
+
+/**
+   Write each statement in a range as it is, then free the range.
+
+   Unlike sord_write_iter(), this does not write blank nodes inline, since a
+   range that matches a pattern may not include every statement about them.
+*/
+static void
+write_flat(SordIter* const iter, SerdWriter* const writer)
+{
+  SerdStatus st = SERD_SUCCESS;
+  for (; !st && !sord_iter_end(iter); sord_iter_next(iter)) {
+    const SordNode* const o    = sord_iter_get_node(iter, SORD_OBJECT);
+    const char* const     lang = sord_node_get_language(o);
+
+    SerdNode language = SERD_NODE_NULL;
+    if (lang) {
+      language = serd_node_from_string(SERD_LITERAL, (const uint8_t*)lang);
+    }
+
+    st = serd_writer_write_statement(
+      writer,
+      0,
+      NULL,
+      sord_node_to_serd_node(sord_iter_get_node(iter, SORD_SUBJECT)),
+      sord_node_to_serd_node(sord_iter_get_node(iter, SORD_PREDICATE)),
+      sord_node_to_serd_node(o),
+      sord_node_to_serd_node(sord_node_get_datatype(o)),
+      lang ? &language : NULL);
+  }
+
+  sord_iter_free(iter);
+}
+
+/**
+   Read input and write it sorted and deduplicated without building a model.
+
+   This only buffers up to `max_memory` bytes of statements, and spills the
+   rest to temporary files in `directory`, or the default if it is NULL.
+*/
+static SerdStatus
+sort_input(SerdEnv*       env,
+           SerdSyntax     input_syntax,
+           SerdSyntax     output_syntax,
+           size_t         max_memory,
+           const char*    directory,
+           FILE*          in_fd,
+           const uint8_t* in_name,
+           const uint8_t* input,
+           SerdSink       sink,
+           void*          stream)
+{
+  SordSorter* const sorter = sord_sorter_new(env, output_syntax, max_memory);
+  if (!sorter) {
+    SORDI_ERROR("sorting requires `ntriples' or `nquads' output\n");
+    return SERD_ERR_BAD_ARG;
+  }
+
+  sord_sorter_set_directory(sorter, directory);
+
+  SerdReader* const reader =
+    serd_reader_new(input_syntax,
+                    sorter,
+                    NULL,
+                    (SerdBaseSink)sord_sorter_set_base_uri,
+                    (SerdPrefixSink)sord_sorter_set_prefix,
+                    (SerdStatementSink)sord_sorter_write_statement,
+                    NULL);
+
+  const SerdStatus st = in_fd
+                          ? sord_reader_read_file_handle(reader, in_fd, in_name)
+                          : serd_reader_read_string(reader, input);
+
+  serd_reader_free(reader);
+
+  // Write whatever was read, even if there was an error, like a model
+  const SerdStatus fst = sord_sorter_finish(sorter, sink, stream);
+  if (fst) {
+    SORDI_ERROR("failed to write temporary file\n");
+  }
+
+  sord_sorter_free(sorter);
+  return (st > SERD_FAILURE) ? st : fst;
+}
+
+/**
+   Read input and write each statement as it is read without building a model.
+
+   If `dedup_memory` is not zero, statements already seen within that many
+   bytes of memory are dropped, otherwise every statement is written.
+*/
+static SerdStatus
+stream_input(SerdEnv*       env,
+             const SerdURI* base_uri,
+             SerdSyntax     input_syntax,
+             SerdSyntax     output_syntax,
+             size_t         dedup_memory,
+             bool           dedup_exact,
+             FILE*          in_fd,
+             const uint8_t* in_name,
+             const uint8_t* input,
+             SerdSink       sink,
+             void*          stream)
+{
+  SerdWriter* const writer = serd_writer_new(
+    output_syntax, output_style(output_syntax), env, base_uri, sink, stream);
+
+  SordDeduplicator* const dedup =
+    dedup_memory ? sord_deduplicator_new(
+                     env,
+                     dedup_memory,
+                     dedup_exact,
+                     writer,
+                     (SerdBaseSink)serd_writer_set_base_uri,
+                     (SerdPrefixSink)serd_writer_set_prefix,
+                     (SerdStatementSink)serd_writer_write_statement,
+                     (SerdEndSink)serd_writer_end_anon)
+                 : NULL;
+
+  SerdReader* const reader =
+    dedup ? serd_reader_new(
+              input_syntax,
+              dedup,
+              NULL,
+              (SerdBaseSink)sord_deduplicator_set_base_uri,
+              (SerdPrefixSink)sord_deduplicator_set_prefix,
+              (SerdStatementSink)sord_deduplicator_write_statement,
+              (SerdEndSink)sord_deduplicator_end_anon)
+          : serd_reader_new(input_syntax,
+                            writer,
+                            NULL,
+                            (SerdBaseSink)serd_writer_set_base_uri,
+                            (SerdPrefixSink)serd_writer_set_prefix,
+                            (SerdStatementSink)serd_writer_write_statement,
+                            (SerdEndSink)serd_writer_end_anon);
+
+  const SerdStatus st = in_fd
+                          ? sord_reader_read_file_handle(reader, in_fd, in_name)
+                          : serd_reader_read_string(reader, input);
+
+  serd_reader_free(reader);
+  sord_deduplicator_free(dedup);
+  serd_writer_finish(writer);
+  serd_writer_free(writer);
+  return st;
+}
+
 int
 main(int argc, char** argv)
 {
@@ -87,12 +498,23 @@ main(int argc, char** argv)
     return print_usage(argv[0], true);
   }
 
-  FILE*          in_fd         = NULL;
-  SerdSyntax     input_syntax  = SERD_TURTLE;
-  SerdSyntax     output_syntax = SERD_NTRIPLES;
-  bool           from_file     = true;
-  const uint8_t* in_name       = NULL;
-  int            a             = 1;
+  FILE*           in_fd         = NULL;
+  SerdSyntax      input_syntax  = SERD_TURTLE;
+  SerdSyntax      output_syntax = SERD_NTRIPLES;
+  SordCompression compression   = SORD_COMPRESSION_NONE;
+  bool            from_file     = true;
+  const uint8_t*  in_name       = NULL;
+  long            n_threads     = 1;
+  long            sort_memory   = 0;
+  const char*     sort_dir      = NULL;
+  long            dedup_memory  = 0;
+  bool            dedup_exact   = true;
+  bool            streaming     = false;
+  const char*     pattern[4]    = {"_", "_", "_", "_"};
+  bool            filtered      = false;
+  bool            skip_output   = false;
+  bool            show_stats    = false;
+  int             a             = 1;
   for (; a < argc && argv[a][0] == '-'; ++a) {
     if (argv[a][1] == '\0') {
       in_name = (const uint8_t*)"(stdin)";
@@ -102,6 +524,12 @@ main(int argc, char** argv)
       return print_usage(argv[0], false);
     } else if (argv[a][1] == 'v') {
       return print_version();
+    } else if (argv[a][1] == 'n') {
+      skip_output = true;
+    } else if (argv[a][1] == 't') {
+      streaming = true;
+    } else if (argv[a][1] == 'S') {
+      show_stats = true;
     } else if (argv[a][1] == 's') {
       in_name   = (const uint8_t*)"(string)";
       from_file = false;
@@ -115,6 +543,18 @@ main(int argc, char** argv)
       if (!set_syntax(&input_syntax, argv[a])) {
         return print_usage(argv[0], true);
       }
+    } else if (argv[a][1] == 'j') {
+      if (++a == argc) {
+        SORDI_ERROR("option requires an argument -- 'j'\n\n");
+        return print_usage(argv[0], true);
+      }
+
+      char* endptr = NULL;
+      n_threads    = strtol(argv[a], &endptr, 10);
+      if (*endptr || n_threads < 0 || n_threads > 1024) {
+        SORDI_ERRORF("invalid number of threads `%s'\n", argv[a]);
+        return print_usage(argv[0], true);
+      }
     } else if (argv[a][1] == 'o') {
       if (++a == argc) {
         SORDI_ERROR("option requires an argument -- 'o'\n\n");
@@ -123,6 +563,51 @@ main(int argc, char** argv)
       if (!set_syntax(&output_syntax, argv[a])) {
         return print_usage(argv[0], true);
       }
+    } else if (argv[a][1] == 'p') {
+      if (argc - a <= 4) {
+        SORDI_ERROR("option requires 4 arguments -- 'p'\n\n");
+        return print_usage(argv[0], true);
+      }
+
+      for (unsigned i = 0u; i < 4u; ++i) {
+        pattern[i] = argv[++a];
+      }
+
+      filtered = true;
+    } else if (argv[a][1] == 'u' || argv[a][1] == 'U') {
+      if (++a == argc) {
+        SORDI_ERRORF("option requires an argument -- '%c'\n\n",
+                     argv[a - 1][1]);
+        return print_usage(argv[0], true);
+      }
+      if (!parse_memory(argv[a], &dedup_memory)) {
+        return print_usage(argv[0], true);
+      }
+
+      dedup_exact = argv[a - 1][1] == 'u';
+      streaming   = true;
+    } else if (argv[a][1] == 'T') {
+      if (++a == argc) {
+        SORDI_ERROR("option requires an argument -- 'T'\n\n");
+        return print_usage(argv[0], true);
+      }
+      sort_dir = argv[a];
+    } else if (argv[a][1] == 'x') {
+      if (++a == argc) {
+        SORDI_ERROR("option requires an argument -- 'x'\n\n");
+        return print_usage(argv[0], true);
+      }
+      if (!parse_memory(argv[a], &sort_memory)) {
+        return print_usage(argv[0], true);
+      }
+    } else if (argv[a][1] == 'z') {
+      if (++a == argc) {
+        SORDI_ERROR("option requires an argument -- 'z'\n\n");
+        return print_usage(argv[0], true);
+      }
+      if (!set_compression(&compression, argv[a])) {
+        return print_usage(argv[0], true);
+      }
     } else {
       SORDI_ERRORF("invalid option -- '%s'\n", argv[a] + 1);
       return print_usage(argv[0], true);
@@ -134,6 +619,16 @@ main(int argc, char** argv)
     return print_usage(argv[0], true);
   }
 
+  if (streaming && sort_memory) {
+    SORDI_ERROR("streaming and sorting can not be used together\n");
+    return print_usage(argv[0], true);
+  }
+
+  if ((filtered || skip_output || show_stats) && (streaming || sort_memory)) {
+    SORDI_ERROR("-n, -p, and -S can not be used when streaming or sorting\n");
+    return print_usage(argv[0], true);
+  }
+
   uint8_t*       input_path = NULL;
   const uint8_t* input      = (const uint8_t*)argv[a++];
   if (from_file) {
@@ -158,51 +653,161 @@ main(int argc, char** argv)
     base = serd_node_new_file_uri(input, NULL, &base_uri, true);
   }
 
-  SordWorld*  world  = sord_world_new();
-  SordModel*  sord   = sord_new(world, SORD_SPO | SORD_OPS, false);
-  SerdEnv*    env    = serd_env_new(&base);
-  SerdReader* reader = sord_new_reader(sord, env, input_syntax, NULL);
+  FILE*             out_fd = stdout;
+  SordOutput* const output = sord_output_new(out_fd, 0u, n_threads != 1);
+  SerdSink          sink   = (SerdSink)sord_output_write;
+  void*             stream = output;
+  SerdEnv*          env    = serd_env_new(&base);
+  SerdStatus        status = SERD_SUCCESS;
 
-  SerdStatus status = (from_file)
-                        ? serd_reader_read_file_handle(reader, in_fd, in_name)
-                        : serd_reader_read_string(reader, input);
+  SordCompressor* const compressor =
+    sord_compressor_new(compression, (SerdSink)sord_output_write, output);
+  if (compressor) {
+    sink   = (SerdSink)sord_compressor_write;
+    stream = compressor;
+  }
 
-  serd_reader_free(reader);
+  if (streaming) {
+    status = stream_input(env,
+                          &base_uri,
+                          input_syntax,
+                          output_syntax,
+                          (size_t)dedup_memory << 20u,
+                          dedup_exact,
+                          from_file ? in_fd : NULL,
+                          in_name,
+                          input,
+                          sink,
+                          stream);
+  } else if (sort_memory) {
+    status = sort_input(env,
+                        input_syntax,
+                        output_syntax,
+                        (size_t)sort_memory << 20u,
+                        sort_dir,
+                        from_file ? in_fd : NULL,
+                        in_name,
+                        input,
+                        sink,
+                        stream);
+  } else {
+    // Only build the indices needed to find the pattern, if there is one
+    const unsigned indices =
+      filtered ? pattern_indices(pattern) : (SORD_SPO | SORD_OPS);
 
-  FILE*    out_fd    = stdout;
-  SerdEnv* write_env = serd_env_new(&base);
+    const double load_start = current_seconds();
 
-  int output_style = SERD_STYLE_RESOLVED;
-  if (output_syntax == SERD_NTRIPLES) {
-    output_style |= SERD_STYLE_ASCII;
-  } else {
-    output_style |= SERD_STYLE_CURIED | SERD_STYLE_ABBREVIATED;
+    SordWorld*  world  = sord_world_new();
+    const bool  graphs = strcmp(pattern[SORD_GRAPH], "_");
+    SordModel*  sord   = sord_new(world, indices, graphs);
+    SerdReader* reader = sord_new_reader(sord, env, input_syntax, NULL);
+
+    if (from_file && in_fd != stdin && n_threads != 1) {
+      status = sord_read_file(
+        sord, env, input_syntax, input, NULL, (unsigned)n_threads);
+    } else if (from_file) {
+      status = sord_reader_read_file_handle(reader, in_fd, in_name);
+    } else {
+      status = serd_reader_read_string(reader, input);
+    }
+
+    serd_reader_free(reader);
+
+    const double load_end = current_seconds();
+
+    // Resolve the pattern with the prefixes and base URI of the input
+    SordNode* nodes[4] = {NULL, NULL, NULL, NULL};
+    bool      valid    = true;
+    for (unsigned i = 0u; i < 4u; ++i) {
+      valid = parse_pattern_node(world, env, pattern[i], &nodes[i]) && valid;
+    }
+
+    const SordQuad pat = {nodes[0], nodes[1], nodes[2], nodes[3]};
+
+    if (!valid) {
+      status = SERD_ERR_BAD_ARG;
+    } else if (skip_output) {
+      // Only load the input, for example to measure loading with -S
+    } else if (n_threads != 1 && !filtered) {
+      // Write ranges of the model on several threads
+      if (sord_write_parallel(sord,
+                              env,
+                              output_syntax,
+                              output_style(output_syntax),
+                              (unsigned)n_threads,
+                              sink,
+                              stream) > SERD_FAILURE) {
+        perror("sordi: write error");
+        status = SERD_ERR_UNKNOWN;
+      }
+    } else if (output_syntax == SERD_NTRIPLES ||
+               output_syntax == SERD_NQUADS) {
+      // Write lines directly from the model, which is much faster
+      if (sord_write_lines(sord_find(sord, pat), output_syntax, sink, stream) >
+          SERD_FAILURE) {
+        perror("sordi: write error");
+        status = SERD_ERR_UNKNOWN;
+      }
+    } else {
+      SerdEnv* write_env = serd_env_new(&base);
+
+      SerdWriter* writer = serd_writer_new(output_syntax,
+                                           output_style(output_syntax),
+                                           write_env,
+                                           &base_uri,
+                                           sink,
+                                           stream);
+
+      // Write @prefix directives
+      serd_env_foreach(env, (SerdPrefixSink)serd_writer_set_prefix, writer);
+
+      // Write statements, abbreviated unless only some are written
+      if (filtered) {
+        write_flat(sord_find(sord, pat), writer);
+      } else {
+        sord_write_iter(sord_find(sord, pat), writer);
+      }
+
+      serd_writer_finish(writer);
+      serd_writer_free(writer);
+      serd_env_free(write_env);
+    }
+
+    if (show_stats) {
+      const double write_end = current_seconds();
+
+      print_stats(
+        stderr, world, sord, load_end - load_start, write_end - load_end);
+    }
+
+    for (unsigned i = 0u; i < 4u; ++i) {
+      sord_node_free(world, nodes[i]);
+    }
+
+    sord_free(sord);
+    sord_world_free(world);
   }
 
-  SerdWriter* writer = serd_writer_new(output_syntax,
-                                       (SerdStyle)output_style,
-                                       write_env,
-                                       &base_uri,
-                                       serd_file_sink,
-                                       stdout);
+  if (compressor) {
+    if (sord_compressor_finish(compressor)) {
+      SORDI_ERROR("failed to write compressed output\n");
+      status = SERD_ERR_UNKNOWN;
+    }
 
-  // Write @prefix directives
-  serd_env_foreach(env, (SerdPrefixSink)serd_writer_set_prefix, writer);
+    sord_compressor_free(compressor);
+  }
 
-  // Write statements
-  sord_write(sord, writer, NULL);
+  if (sord_output_flush(output) && status <= SERD_FAILURE) {
+    perror("sordi: write error");
+    status = SERD_ERR_UNKNOWN;
+  }
 
-  serd_writer_finish(writer);
-  serd_writer_free(writer);
+  sord_output_free(output);
 
   serd_env_free(env);
-  serd_env_free(write_env);
   serd_node_free(&base);
   free(input_path);
 
-  sord_free(sord);
-  sord_world_free(world);
-
   if (from_file) {
     fclose(in_fd);
   }
@@ -0,0 +1,530 @@
+/*
+  Copyright 2021 David Robillard <d@drobilla.net>
+
+  Permission to use, copy, modify, and/or distribute this software for any
+  purpose with or without fee is hereby granted, provided that the above
+  copyright notice and this permission notice appear in all copies.
+
+  THIS SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+
+#define _POSIX_C_SOURCE 200809L // for mkstemp, fdopen, and unlink
+
+#include "sord_config.h" // IWYU pragma: keep
+
+#include "serd/serd.h"
+#include "sord/sord.h"
+
+#if USE_MKSTEMP
+#  include <unistd.h>
+#endif
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/// Minimum size of the buffer for a run
+#define SORD_SORT_MIN_MEMORY (64u << 10u)
+
+/**
+   Maximum number of runs merged at once, limited by open files.
+
+   Runs are merged as soon as there are this many of the same level, so at
+   most this many minus one of each level are open at once.  Since each level
+   is this many times larger than the last, this keeps the number of open
+   files far below the usual limit of 1024 even for huge inputs.
+*/
+#define SORD_SORT_MAX_RUNS 64u
+
+/// A growable buffer that holds one line
+typedef struct {
+  uint8_t* buf;  ///< Line including the newline
+  size_t   len;  ///< Length of line in bytes
+  size_t   size; ///< Allocated size of buf in bytes
+} SordSortLine;
+
+/// A sorted run in a temporary file
+typedef struct {
+  FILE*    file;  ///< Sorted lines
+  unsigned level; ///< Number of merges that produced this run
+} SordSortRun;
+
+/** A run being read during a merge */
+typedef struct {
+  FILE*        file; ///< Sorted run
+  SordSortLine line; ///< Current line
+} SordSortCursor;
+
+struct SordSorterImpl {
+  SerdWriter*     writer;    ///< Writer that writes lines to buf
+  uint8_t*        buf;       ///< Lines of the current run
+  size_t          len;       ///< Length of lines in bytes
+  size_t          size;      ///< Allocated size of buf in bytes
+  const uint8_t** lines;     ///< Start of each line in buf
+  size_t          n_lines;   ///< Number of lines in buf
+  size_t          max_lines; ///< Maximum number of lines before a new run
+  bool            overflow;  ///< True if the last line did not fit in buf
+  SordSortRun*    runs;      ///< Sorted runs, from largest to smallest
+  size_t          n_runs;    ///< Number of runs
+  char*           directory; ///< Directory for temporary files, or NULL
+  SerdStatus      status;    ///< First error writing runs
+};
+
+/// Compare newline-terminated lines, where a prefix sorts first
+static int
+sord_sort_compare(const uint8_t* a, const uint8_t* b)
+{
+  while (*a == *b && *a != '\n') {
+    ++a;
+    ++b;
+  }
+
+  return (int)*a - (int)*b;
+}
+
+static int
+sord_sort_compare_lines(const void* a, const void* b)
+{
+  return sord_sort_compare(*(const uint8_t* const*)a,
+                           *(const uint8_t* const*)b);
+}
+
+static size_t
+sord_sort_line_length(const uint8_t* const line)
+{
+  return (size_t)((const uint8_t*)strchr((const char*)line, '\n') - line) + 1u;
+}
+
+/// Write output to a temporary file, compatible with SerdSink
+static size_t
+sord_sort_file_sink(const void* buf, size_t len, void* stream)
+{
+  return fwrite(buf, 1, len, (FILE*)stream);
+}
+
+/**
+   Create a temporary file, which is deleted when it is closed.
+
+   If a directory is set, or the TMPDIR environment variable is, then the file
+   is created there, otherwise it is created wherever tmpfile() does.
+*/
+static FILE*
+sord_sorter_temp_file(const SordSorter* const sorter)
+{
+#if USE_MKSTEMP
+  const char* const dir =
+    sorter->directory ? sorter->directory : getenv("TMPDIR");
+
+  if (dir && *dir) {
+    static const char name[] = "/sord.XXXXXX";
+
+    const size_t dir_len = strlen(dir);
+    char* const  path    = (char*)malloc(dir_len + sizeof(name));
+    memcpy(path, dir, dir_len);
+    memcpy(path + dir_len, name, sizeof(name));
+
+    FILE*     file = NULL;
+    const int fd   = mkstemp(path);
+    if (fd >= 0) {
+      unlink(path); // Delete when closed, like tmpfile()
+      if (!(file = fdopen(fd, "w+b"))) {
+        close(fd);
+      }
+    }
+
+    free(path);
+    return file;
+  }
+#else
+  (void)sorter;
+#endif
+
+  return tmpfile();
+}
+
+/**
+   Append writer output to the current run, compatible with SerdSink.
+
+   The buffer is only grown when it contains no complete lines, since the
+   line pointers would otherwise be invalidated.  If a line does not fit in
+   a full buffer, the overflow flag is set and the sorter starts a new run.
+*/
+static size_t
+sord_sorter_sink(const void* buf, size_t len, void* stream)
+{
+  SordSorter* const sorter = (SordSorter*)stream;
+  if (sorter->len + len + 1u > sorter->size) {
+    if (sorter->n_lines) {
+      sorter->overflow = true;
+      return len;
+    }
+
+    sorter->size = (sorter->len + len + 1u) * 2u;
+    sorter->buf  = (uint8_t*)realloc(sorter->buf, sorter->size);
+  }
+
+  memcpy(sorter->buf + sorter->len, buf, len);
+  sorter->len += len;
+  return len;
+}
+
+/// Read the next line of a run into its cursor, or clear it at the end
+static bool
+sord_sort_cursor_next(SordSortCursor* const cursor)
+{
+  SordSortLine* const line = &cursor->line;
+
+  line->len = 0u;
+  for (;;) {
+    if (line->size - line->len < 2u) {
+      line->size = line->size ? line->size * 2u : 256u;
+      line->buf  = (uint8_t*)realloc(line->buf, line->size);
+    }
+
+    char* const str = (char*)line->buf + line->len;
+    if (!fgets(str, (int)(line->size - line->len), cursor->file)) {
+      break;
+    }
+
+    line->len += strlen(str);
+    if (line->buf[line->len - 1u] == '\n') {
+      return true;
+    }
+  }
+
+  line->len = 0u;
+  return false;
+}
+
+static bool
+sord_sort_cursor_less(const SordSortCursor* const a,
+                      const SordSortCursor* const b)
+{
+  return sord_sort_compare(a->line.buf, b->line.buf) < 0;
+}
+
+/// Restore the heap property of `heap` from `i` down
+static void
+sord_sort_sift_down(SordSortCursor** const heap,
+                    const size_t           n,
+                    size_t                 i)
+{
+  for (;;) {
+    const size_t l        = 2u * i + 1u;
+    const size_t r        = l + 1u;
+    size_t       smallest = i;
+    if (l < n && sord_sort_cursor_less(heap[l], heap[smallest])) {
+      smallest = l;
+    }
+    if (r < n && sord_sort_cursor_less(heap[r], heap[smallest])) {
+      smallest = r;
+    }
+    if (smallest == i) {
+      return;
+    }
+
+    SordSortCursor* const tmp = heap[i];
+    heap[i]                   = heap[smallest];
+    heap[smallest]            = tmp;
+    i                         = smallest;
+  }
+}
+
+/**
+   Merge sorted runs into a sink, skipping duplicate lines.
+
+   The runs are closed afterwards.
+*/
+static SerdStatus
+sord_sort_merge(const SordSortRun* const runs,
+                const size_t             n_runs,
+                SerdSink                 sink,
+                void* const              stream)
+{
+  SordSortCursor* const cursors =
+    (SordSortCursor*)calloc(n_runs, sizeof(SordSortCursor));
+  SordSortCursor** const heap =
+    (SordSortCursor**)calloc(n_runs, sizeof(SordSortCursor*));
+
+  SerdStatus st     = SERD_SUCCESS;
+  size_t     n_heap = 0u;
+  for (size_t i = 0u; i < n_runs; ++i) {
+    cursors[i].file = runs[i].file;
+    if (fseek(runs[i].file, 0, SEEK_SET)) {
+      st = SERD_ERR_UNKNOWN;
+    } else if (sord_sort_cursor_next(&cursors[i])) {
+      heap[n_heap++] = &cursors[i];
+    }
+  }
+
+  for (size_t i = n_heap / 2u; i-- > 0u;) {
+    sord_sort_sift_down(heap, n_heap, i);
+  }
+
+  SordSortLine last = {NULL, 0u, 0u};
+  while (n_heap) {
+    SordSortLine* const line = &heap[0]->line;
+    if (!last.len || sord_sort_compare(line->buf, last.buf)) {
+      if (sink(line->buf, line->len, stream) != line->len) {
+        st = SERD_ERR_UNKNOWN;
+        break;
+      }
+
+      // Swap buffers rather than copying, the cursor reuses the old one
+      const SordSortLine tmp = last;
+      last                   = *line;
+      *line                  = tmp;
+    }
+
+    if (!sord_sort_cursor_next(heap[0])) {
+      heap[0] = heap[--n_heap];
+    }
+
+    sord_sort_sift_down(heap, n_heap, 0u);
+  }
+
+  for (size_t i = 0u; i < n_runs; ++i) {
+    if (ferror(runs[i].file)) {
+      st = SERD_ERR_UNKNOWN;
+    }
+
+    fclose(runs[i].file);
+    free(cursors[i].line.buf);
+  }
+
+  free(last.buf);
+  free(heap);
+  free(cursors);
+  return st;
+}
+
+/// Merge the last `n` runs of `sorter` into one larger run
+static SerdStatus
+sord_sorter_merge_last(SordSorter* const sorter, const size_t n)
+{
+  FILE* const file = sord_sorter_temp_file(sorter);
+  if (!file) {
+    return SERD_ERR_UNKNOWN;
+  }
+
+  // Runs are ordered by level, so the first one is the largest
+  const size_t      first = sorter->n_runs - n;
+  const SordSortRun run   = {file, sorter->runs[first].level + 1u};
+
+  SerdStatus st =
+    sord_sort_merge(sorter->runs + first, n, sord_sort_file_sink, file);
+
+  if (!st && fflush(file)) {
+    st = SERD_ERR_UNKNOWN;
+  }
+
+  sorter->runs[first] = run;
+  sorter->n_runs      = first + 1u;
+  return st;
+}
+
+/// Sort the current run and write it to a new temporary file
+static void
+sord_sorter_flush(SordSorter* const sorter)
+{
+  if (!sorter->n_lines) {
+    return;
+  }
+
+  qsort((void*)sorter->lines,
+        sorter->n_lines,
+        sizeof(const uint8_t*),
+        sord_sort_compare_lines);
+
+  FILE* const file = sord_sorter_temp_file(sorter);
+  if (!file) {
+    sorter->status = sorter->status ? sorter->status : SERD_ERR_UNKNOWN;
+  } else {
+    const uint8_t* last = NULL;
+    for (size_t i = 0u; i < sorter->n_lines; ++i) {
+      const uint8_t* const line = sorter->lines[i];
+      if (!last || sord_sort_compare(line, last)) {
+        fwrite(line, 1, sord_sort_line_length(line), file);
+        last = line;
+      }
+    }
+
+    if (fflush(file) || ferror(file)) {
+      sorter->status = sorter->status ? sorter->status : SERD_ERR_UNKNOWN;
+    }
+
+    const SordSortRun run = {file, 0u};
+
+    sorter->runs = (SordSortRun*)realloc(
+      sorter->runs, (sorter->n_runs + 1u) * sizeof(SordSortRun));
+    sorter->runs[sorter->n_runs++] = run;
+
+    // Merge runs as soon as there are enough of the same level
+    while (!sorter->status && sorter->n_runs >= SORD_SORT_MAX_RUNS &&
+           sorter->runs[sorter->n_runs - SORD_SORT_MAX_RUNS].level ==
+             sorter->runs[sorter->n_runs - 1u].level) {
+      sorter->status = sord_sorter_merge_last(sorter, SORD_SORT_MAX_RUNS);
+    }
+  }
+
+  sorter->len     = 0u;
+  sorter->n_lines = 0u;
+}
+
+SordSorter*
+sord_sorter_new(SerdEnv* env, SerdSyntax syntax, size_t max_memory)
+{
+  if (syntax != SERD_NTRIPLES && syntax != SERD_NQUADS) {
+    return NULL;
+  }
+
+  if (max_memory < SORD_SORT_MIN_MEMORY) {
+    max_memory = SORD_SORT_MIN_MEMORY;
+  }
+
+  SordSorter* const sorter = (SordSorter*)calloc(1, sizeof(SordSorter));
+
+  // Use most memory for lines, and the rest for pointers to them
+  sorter->size      = max_memory / 4u * 3u;
+  sorter->buf       = (uint8_t*)malloc(sorter->size);
+  sorter->max_lines = max_memory / 4u / sizeof(const uint8_t*);
+  sorter->lines =
+    (const uint8_t**)malloc(sorter->max_lines * sizeof(const uint8_t*));
+
+  SerdURI base_uri = SERD_URI_NULL;
+  serd_env_get_base_uri(env, &base_uri);
+
+  sorter->writer =
+    serd_writer_new(syntax,
+                    (SerdStyle)(SERD_STYLE_ASCII | SERD_STYLE_RESOLVED),
+                    env,
+                    &base_uri,
+                    sord_sorter_sink,
+                    sorter);
+
+  return sorter;
+}
+
+void
+sord_sorter_free(SordSorter* sorter)
+{
+  if (sorter) {
+    for (size_t i = 0u; i < sorter->n_runs; ++i) {
+      if (sorter->runs[i].file) {
+        fclose(sorter->runs[i].file);
+      }
+    }
+
+    serd_writer_free(sorter->writer);
+    free(sorter->runs);
+    free(sorter->directory);
+    free(sorter->lines);
+    free(sorter->buf);
+    free(sorter);
+  }
+}
+
+void
+sord_sorter_set_directory(SordSorter* sorter, const char* path)
+{
+  const size_t len = path ? strlen(path) : 0u;
+
+  free(sorter->directory);
+  sorter->directory = len ? (char*)malloc(len + 1u) : NULL;
+  if (len) {
+    memcpy(sorter->directory, path, len + 1u);
+  }
+}
+
+SerdStatus
+sord_sorter_set_base_uri(SordSorter* sorter, const SerdNode* uri)
+{
+  return serd_writer_set_base_uri(sorter->writer, uri);
+}
+
+SerdStatus
+sord_sorter_set_prefix(SordSorter*     sorter,
+                       const SerdNode* name,
+                       const SerdNode* uri)
+{
+  return serd_writer_set_prefix(sorter->writer, name, uri);
+}
+
+SerdStatus
+sord_sorter_write_statement(SordSorter*        sorter,
+                            SerdStatementFlags flags,
+                            const SerdNode*    graph,
+                            const SerdNode*    subject,
+                            const SerdNode*    predicate,
+                            const SerdNode*    object,
+                            const SerdNode*    object_datatype,
+                            const SerdNode*    object_lang)
+{
+  if (sorter->n_lines == sorter->max_lines) {
+    sord_sorter_flush(sorter);
+  }
+
+  size_t     start = sorter->len;
+  SerdStatus st    = serd_writer_write_statement(sorter->writer,
+                                                 flags,
+                                                 graph,
+                                                 subject,
+                                                 predicate,
+                                                 object,
+                                                 object_datatype,
+                                                 object_lang);
+
+  if (sorter->overflow) {
+    // Line did not fit, so start a new run and write it there
+    sorter->len      = start;
+    sorter->overflow = false;
+    sord_sorter_flush(sorter);
+    start = sorter->len;
+    st    = serd_writer_write_statement(sorter->writer,
+                                        flags,
+                                        graph,
+                                        subject,
+                                        predicate,
+                                        object,
+                                        object_datatype,
+                                        object_lang);
+  }
+
+  if (!st && sorter->len > start) {
+    sorter->buf[sorter->len] = '\0'; // Terminate for sord_sort_line_length()
+    sorter->lines[sorter->n_lines++] = sorter->buf + start;
+  } else {
+    sorter->len = start;
+  }
+
+  return st;
+}
+
+SerdStatus
+sord_sorter_finish(SordSorter* sorter, SerdSink sink, void* stream)
+{
+  serd_writer_finish(sorter->writer);
+  sord_sorter_flush(sorter);
+
+  // Merge the smallest runs until there are few enough to merge at once
+  SerdStatus st = sorter->status;
+  while (!st && sorter->n_runs > SORD_SORT_MAX_RUNS) {
+    st = sord_sorter_merge_last(sorter, SORD_SORT_MAX_RUNS);
+  }
+
+  if (!st) {
+    st = sord_sort_merge(sorter->runs, sorter->n_runs, sink, stream);
+    sorter->n_runs = 0u;
+  }
+
+  return st;
+}
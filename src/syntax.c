@@ -14,37 +14,138 @@
   OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
 */
 
+#include "sord_config.h" // IWYU pragma: keep
+#include "sord_internal.h"
+
 #include "serd/serd.h"
 #include "sord/sord.h"
+#include "zix/hash.h"
+
+#if USE_PTHREAD
+#  include <pthread.h>
+#endif
+
+#ifdef __SSE2__
+#  include <emmintrin.h>
+#endif
 
 #include <stdbool.h>
 #include <stdint.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
+/// Size of the output buffer for writing lines
+#define SORD_LINE_BUF_SIZE (1u << 20u)
+
+/// Maximum length of an escape sequence for a single character
+#define SORD_LINE_MAX_ESCAPE 10u
+
+/// Approximate number of quads in each range written in parallel
+#define SORD_EXPORT_CHUNK_QUADS (1u << 16u)
+
+/**
+   The node most recently resolved for one statement position.
+
+   Abbreviated Turtle repeats the same subject and predicate for many
+   statements in a row, so remembering the last one saves most lookups.  The
+   node is borrowed from the model, which keeps it alive as long as it is in
+   some statement, so the cache is only valid until a statement is removed.
+*/
+typedef struct {
+  const SordNode* node;     ///< Resolved node (borrowed from the model)
+  uint8_t*        buf;      ///< Copy of the string of the source node
+  size_t          buf_size; ///< Size of buf in bytes
+  size_t          n_bytes;  ///< Length of the string of the source node
+  SerdType        type;     ///< Type of the source node
+} SordInserterCache;
+
 struct SordInserterImpl {
-  SordModel* model;
-  SerdEnv*   env;
+  SordModel*        model;
+  SerdEnv*          env;
+  size_t            n_removals; ///< Removals from model when last inserted
+  SordInserterCache graph;
+  SordInserterCache subject;
+  SordInserterCache predicate;
 };
 
+/// Clear all cached nodes, which must be done whenever the env changes
+static void
+sord_inserter_clear(SordInserter* inserter)
+{
+  inserter->graph.node     = NULL;
+  inserter->subject.node   = NULL;
+  inserter->predicate.node = NULL;
+}
+
+/**
+   Return the node for `node`, from `cache` if possible.
+
+   If the node is not in the cache, then `new_node` is set to a new reference
+   to the resolved node, which must be freed once it is in the model.
+*/
+static const SordNode*
+sord_inserter_resolve(SordInserter*      inserter,
+                      SordInserterCache* cache,
+                      const SerdNode*    node,
+                      SordNode**         new_node)
+{
+  *new_node = NULL;
+  if (!node) {
+    return NULL;
+  }
+
+  if (cache->node && cache->type == node->type &&
+      cache->n_bytes == node->n_bytes &&
+      !memcmp(cache->buf, node->buf, node->n_bytes)) {
+    return cache->node;
+  }
+
+  SordWorld* world = sord_get_world(inserter->model);
+  SordNode*  resolved =
+    sord_node_from_serd_node(world, inserter->env, node, NULL, NULL);
+  if (!resolved) {
+    return NULL;
+  }
+
+  if (node->n_bytes >= cache->buf_size) {
+    cache->buf_size = node->n_bytes + 1;
+    cache->buf      = (uint8_t*)realloc(cache->buf, cache->buf_size);
+  }
+
+  memcpy(cache->buf, node->buf, node->n_bytes);
+  cache->node    = resolved;
+  cache->n_bytes = node->n_bytes;
+  cache->type    = node->type;
+  *new_node      = resolved;
+  return resolved;
+}
+
 SordInserter*
 sord_inserter_new(SordModel* model, SerdEnv* env)
 {
-  SordInserter* inserter = (SordInserter*)malloc(sizeof(SordInserter));
-  inserter->model        = model;
-  inserter->env          = env;
+  SordInserter* inserter = (SordInserter*)calloc(1, sizeof(SordInserter));
+  inserter->model      = model;
+  inserter->env        = env;
+  inserter->n_removals = sord_num_removals(model);
   return inserter;
 }
 
 void
 sord_inserter_free(SordInserter* inserter)
 {
-  free(inserter);
+  if (inserter) {
+    free(inserter->graph.buf);
+    free(inserter->subject.buf);
+    free(inserter->predicate.buf);
+    free(inserter);
+  }
 }
 
 SerdStatus
 sord_inserter_set_base_uri(SordInserter* inserter, const SerdNode* uri)
 {
+  sord_inserter_clear(inserter);
   return serd_env_set_base_uri(inserter->env, uri);
 }
 
@@ -53,6 +154,7 @@ sord_inserter_set_prefix(SordInserter*   inserter,
                          const SerdNode* name,
                          const SerdNode* uri)
 {
+  sord_inserter_clear(inserter);
   return serd_env_set_prefix(inserter->env, name, uri);
 }
 
@@ -69,25 +171,42 @@ sord_inserter_write_statement(SordInserter*      inserter,
   SordWorld* world = sord_get_world(inserter->model);
   SerdEnv*   env   = inserter->env;
 
-  SordNode* g = sord_node_from_serd_node(world, env, graph, NULL, NULL);
-  SordNode* s = sord_node_from_serd_node(world, env, subject, NULL, NULL);
-  SordNode* p = sord_node_from_serd_node(world, env, predicate, NULL, NULL);
+  // Cached nodes may have been freed if anything was removed from the model
+  const size_t n_removals = sord_num_removals(inserter->model);
+  if (n_removals != inserter->n_removals) {
+    sord_inserter_clear(inserter);
+    inserter->n_removals = n_removals;
+  }
+
+  // Graph, subject, and predicate are borrowed from the cache if possible
+  SordNode*       new_nodes[3] = {NULL, NULL, NULL};
+  const SordNode* g =
+    sord_inserter_resolve(inserter, &inserter->graph, graph, &new_nodes[0]);
+  const SordNode* s = sord_inserter_resolve(
+    inserter, &inserter->subject, subject, &new_nodes[1]);
+  const SordNode* p = sord_inserter_resolve(
+    inserter, &inserter->predicate, predicate, &new_nodes[2]);
+
   SordNode* o =
     sord_node_from_serd_node(world, env, object, object_datatype, object_lang);
 
-  if (!s || !p || !o) {
-    return SERD_ERR_BAD_ARG;
+  const bool valid = s && p && o;
+  if (valid) {
+    const SordQuad tup = {s, p, o, g};
+    sord_add(inserter->model, tup);
+  } else {
+    // New nodes are not in the model, so they will be freed below
+    sord_inserter_clear(inserter);
   }
 
-  const SordQuad tup = {s, p, o, g};
-  sord_add(inserter->model, tup);
+  // Drop new references, since the model now refers to any nodes it needs
+  for (unsigned i = 0u; i < 3u; ++i) {
+    sord_node_free(world, new_nodes[i]);
+  }
 
   sord_node_free(world, o);
-  sord_node_free(world, p);
-  sord_node_free(world, s);
-  sord_node_free(world, g);
 
-  return SERD_SUCCESS;
+  return valid ? SERD_SUCCESS : SERD_ERR_BAD_ARG;
 }
 
 SORD_API
@@ -115,18 +234,113 @@ sord_new_reader(SordModel* model,
   return reader;
 }
 
+/** The range of statements about an inline blank node in a plan */
+typedef struct {
+  const SordNode* node;  ///< Blank node
+  size_t          begin; ///< Index of the first statement about node
+  size_t          end;   ///< Index after the last statement about node
+} SordAnonRange;
+
+/**
+   Statements about blank nodes that are written inline.
+
+   A blank node that is the object of only one statement is written there as
+   an anonymous node, so its description is needed in the middle of another
+   subject.  Rather than searching for each one, they are collected in one
+   pass over the blank subjects, and found by node when needed.
+*/
+typedef struct {
+  SordQuad* quads;   ///< Statements with inline subjects, grouped by subject
+  size_t    n_quads; ///< Number of statements in quads
+  ZixHash*  ranges;  ///< SordAnonRange for each inline subject
+} SordAnonPlan;
+
+/** An anonymous node that is being written */
+typedef struct {
+  const SordNode* node; ///< Blank node
+  size_t          next; ///< Index of the next statement in the plan
+  size_t          end;  ///< Index after the last statement in the plan
+} SordAnonFrame;
+
+/** State for writing statements to a serd writer */
+typedef struct {
+  SordModel*     model;      ///< Model being written
+  SerdWriter*    writer;     ///< Writer to write statements to
+  SordAnonPlan*  plan;       ///< Inline statements, built when first needed
+  SordAnonFrame* stack;      ///< Stack of anonymous nodes being written
+  size_t         stack_size; ///< Allocated size of stack in frames
+} SordStatementWriter;
+
+static ZixHashCode
+sord_anon_range_hash(const void* value)
+{
+  return (ZixHashCode)(uintptr_t)((const SordAnonRange*)value)->node;
+}
+
+static bool
+sord_anon_range_equal(const void* a, const void* b)
+{
+  return ((const SordAnonRange*)a)->node == ((const SordAnonRange*)b)->node;
+}
+
+/// Collect the statements about every inline blank node in `model`
+static void
+sord_anon_plan_build(SordAnonPlan* const plan, const SordModel* const model)
+{
+  plan->ranges = zix_hash_new(
+    sord_anon_range_hash, sord_anon_range_equal, sizeof(SordAnonRange));
+
+  size_t        size  = 0u;
+  SordAnonRange range = {NULL, 0u, 0u};
+  SordIter*     iter  = sord_begin_blank_subjects(model);
+  for (; !sord_iter_end(iter); sord_iter_next(iter)) {
+    SordQuad tup;
+    sord_iter_get(iter, tup);
+    if (!sord_node_is_inline_object(tup[SORD_SUBJECT])) {
+      continue;
+    }
+
+    if (tup[SORD_SUBJECT] != range.node) {
+      if (range.node) {
+        zix_hash_insert(plan->ranges, &range, NULL);
+      }
+
+      range.node  = tup[SORD_SUBJECT];
+      range.begin = plan->n_quads;
+    }
+
+    if (plan->n_quads == size) {
+      size        = size ? size * 2u : 64u;
+      plan->quads = (SordQuad*)realloc(plan->quads, size * sizeof(SordQuad));
+    }
+
+    memcpy(plan->quads[plan->n_quads++], tup, sizeof(SordQuad));
+    range.end = plan->n_quads;
+  }
+
+  if (range.node) {
+    zix_hash_insert(plan->ranges, &range, NULL);
+  }
+
+  sord_iter_free(iter);
+}
+
+static void
+sord_anon_plan_clear(SordAnonPlan* const plan)
+{
+  zix_hash_free(plan->ranges);
+  free(plan->quads);
+}
+
 static SerdStatus
-write_statement(SordModel*         sord,
-                SerdWriter*        writer,
-                SordQuad           tup,
-                SerdStatementFlags flags)
+write_quad(SerdWriter* const        writer,
+           const SerdStatementFlags flags,
+           const SordNode* const*   tup)
 {
-  const SordNode* s  = tup[SORD_SUBJECT];
-  const SordNode* p  = tup[SORD_PREDICATE];
   const SordNode* o  = tup[SORD_OBJECT];
   const SordNode* d  = sord_node_get_datatype(o);
-  const SerdNode* ss = sord_node_to_serd_node(s);
-  const SerdNode* sp = sord_node_to_serd_node(p);
+  const SerdNode* ss = sord_node_to_serd_node(tup[SORD_SUBJECT]);
+  const SerdNode* sp = sord_node_to_serd_node(tup[SORD_PREDICATE]);
   const SerdNode* so = sord_node_to_serd_node(o);
   const SerdNode* sd = sord_node_to_serd_node(d);
 
@@ -140,36 +354,75 @@ write_statement(SordModel*         sord,
     language.buf     = (const uint8_t*)lang_str;
   }
 
-  // TODO: Subject abbreviation
+  return serd_writer_write_statement(
+    writer, flags, NULL, ss, sp, so, sd, &language);
+}
+
+/**
+   Write a statement, with any inline objects written as anonymous nodes.
 
-  if (sord_node_is_inline_object(s) && !(flags & SERD_ANON_CONT)) {
-    return SERD_SUCCESS;
+   Nested anonymous nodes are written from an explicit stack, so their depth
+   is not limited by the call stack.
+*/
+static SerdStatus
+write_statement(SordStatementWriter* const w, const SordQuad tup)
+{
+  if (sord_node_is_inline_object(tup[SORD_SUBJECT])) {
+    return SERD_SUCCESS; // Written where it is the object
   }
 
-  SerdStatus st = SERD_SUCCESS;
-  if (sord_node_is_inline_object(o)) {
-    SordQuad  sub_pat  = {o, 0, 0, 0};
-    SordIter* sub_iter = sord_find(sord, sub_pat);
-
-    SerdStatementFlags start_flags =
-      flags | ((sub_iter) ? SERD_ANON_O_BEGIN : SERD_EMPTY_O);
-
-    st = serd_writer_write_statement(
-      writer, start_flags, NULL, ss, sp, so, sd, &language);
-
-    if (!st && sub_iter) {
-      flags |= SERD_ANON_CONT;
-      for (; !st && !sord_iter_end(sub_iter); sord_iter_next(sub_iter)) {
-        SordQuad sub_tup;
-        sord_iter_get(sub_iter, sub_tup);
-        st = write_statement(sord, writer, sub_tup, flags);
+  /* Statements arrive grouped by subject and predicate, which the writer
+     abbreviates by comparing with the previous statement, so there is no
+     need to look ahead here. */
+
+  const SordNode* const* quad  = tup;
+  size_t                 depth = 0u;
+  SerdStatus             st    = SERD_SUCCESS;
+  while (!st) {
+    const SordNode* const    o     = quad[SORD_OBJECT];
+    const SerdStatementFlags flags = depth ? SERD_ANON_CONT : 0;
+
+    if (sord_node_is_inline_object(o)) {
+      if (!w->plan->ranges) {
+        sord_anon_plan_build(w->plan, w->model);
+      }
+
+      const SordAnonRange        key   = {o, 0u, 0u};
+      const SordAnonRange* const range =
+        (const SordAnonRange*)zix_hash_find(w->plan->ranges, &key);
+
+      if (!range) {
+        st = write_quad(w->writer, flags | SERD_EMPTY_O, quad);
+      } else if (!(st = write_quad(
+                     w->writer, flags | SERD_ANON_O_BEGIN, quad))) {
+        if (depth == w->stack_size) {
+          w->stack_size = w->stack_size ? w->stack_size * 2u : 16u;
+          w->stack      = (SordAnonFrame*)realloc(
+            w->stack, w->stack_size * sizeof(SordAnonFrame));
+        }
+
+        const SordAnonFrame frame = {o, range->begin, range->end};
+        w->stack[depth++]         = frame;
       }
-      sord_iter_free(sub_iter);
-      serd_writer_end_anon(writer, so);
+    } else {
+      st = write_quad(w->writer, flags, quad);
+    }
+
+    // Move to the next statement, closing any finished anonymous nodes
+    while (!st && depth) {
+      SordAnonFrame* const top = &w->stack[depth - 1u];
+      if (top->next < top->end) {
+        quad = w->plan->quads[top->next++];
+        break;
+      }
+
+      --depth;
+      serd_writer_end_anon(w->writer, sord_node_to_serd_node(top->node));
+    }
+
+    if (!depth) {
+      break;
     }
-  } else {
-    st = serd_writer_write_statement(
-      writer, flags, NULL, ss, sp, so, sd, &language);
   }
 
   return st;
@@ -190,14 +443,693 @@ sord_write_iter(SordIter* iter, SerdWriter* writer)
     return false;
   }
 
-  SordModel* model = (SordModel*)sord_iter_get_model(iter);
-  SerdStatus st    = SERD_SUCCESS;
+  SordAnonPlan        plan = {NULL, 0u, NULL};
+  SordStatementWriter w    = {
+    (SordModel*)sord_iter_get_model(iter), writer, &plan, NULL, 0u};
+
+  SerdStatus st = SERD_SUCCESS;
   for (; !st && !sord_iter_end(iter); sord_iter_next(iter)) {
     SordQuad tup;
     sord_iter_get(iter, tup);
-    st = write_statement(model, writer, tup, 0);
+    st = write_statement(&w, tup);
   }
   sord_iter_free(iter);
 
+  sord_anon_plan_clear(&plan);
+  free(w.stack);
   return !st;
 }
+
+/** Buffered writer for N-Triples or N-Quads lines */
+typedef struct {
+  SerdSink   sink;   ///< Sink for output
+  void*      stream; ///< Stream for sink
+  uint8_t*   buf;    ///< Output buffer
+  size_t     len;    ///< Length of output in buf
+  SerdStatus status; ///< Error writing to sink
+} SordLineWriter;
+
+/// Context of a string, which determines which characters are escaped
+typedef enum { SORD_LINE_URI, SORD_LINE_STRING } SordLineContext;
+
+static void
+sord_line_flush(SordLineWriter* const writer)
+{
+  if (writer->len && !writer->status &&
+      writer->sink(writer->buf, writer->len, writer->stream) != writer->len) {
+    writer->status = SERD_ERR_UNKNOWN;
+  }
+
+  writer->len = 0u;
+}
+
+static inline void
+sord_line_write(SordLineWriter* const writer,
+                const void* const     buf,
+                const size_t          len)
+{
+  if (writer->len + len > SORD_LINE_BUF_SIZE) {
+    sord_line_flush(writer);
+    if (len > SORD_LINE_BUF_SIZE) {
+      if (!writer->status && writer->sink(buf, len, writer->stream) != len) {
+        writer->status = SERD_ERR_UNKNOWN;
+      }
+      return;
+    }
+  }
+
+  memcpy(writer->buf + writer->len, buf, len);
+  writer->len += len;
+}
+
+static inline bool
+sord_line_must_escape(const SordLineContext ctx, const uint8_t c)
+{
+  if (c < 0x20 || c > 0x7E || c == '"' || c == '\\') {
+    return true;
+  }
+
+  if (ctx == SORD_LINE_URI) {
+    switch (c) {
+    case ' ':
+    case '<':
+    case '>':
+    case '^':
+    case '`':
+    case '{':
+    case '|':
+    case '}':
+      return true;
+    default:
+      break;
+    }
+  }
+
+  return false;
+}
+
+/// Return the number of leading bytes in `str` that need no escaping
+static size_t
+sord_line_scan(const SordLineContext ctx,
+               const uint8_t* const  str,
+               const size_t          len)
+{
+  size_t i = 0u;
+
+#ifdef __SSE2__
+  // Compare 16 bytes at a time, where signed comparison makes any byte with
+  // the high bit set less than a space, so non-ASCII is found as well
+  const __m128i space = _mm_set1_epi8(ctx == SORD_LINE_URI ? 0x21 : 0x20);
+  const __m128i del   = _mm_set1_epi8(0x7F);
+  const __m128i quote = _mm_set1_epi8('"');
+  const __m128i slash = _mm_set1_epi8('\\');
+  for (; i + 16u <= len; i += 16u) {
+    const __m128i v = _mm_loadu_si128((const __m128i*)(str + i));
+    __m128i       m = _mm_or_si128(
+      _mm_or_si128(_mm_cmplt_epi8(v, space), _mm_cmpeq_epi8(v, del)),
+      _mm_or_si128(_mm_cmpeq_epi8(v, quote), _mm_cmpeq_epi8(v, slash)));
+
+    if (ctx == SORD_LINE_URI) {
+      // Also find <, >, ^, `, {, |, and }
+      const __m128i lt = _mm_cmpeq_epi8(v, _mm_set1_epi8('<'));
+      const __m128i gt = _mm_cmpeq_epi8(v, _mm_set1_epi8('>'));
+      const __m128i ct = _mm_cmpeq_epi8(v, _mm_set1_epi8('^'));
+      const __m128i bt = _mm_cmpeq_epi8(v, _mm_set1_epi8('`'));
+      const __m128i br = _mm_and_si128( // { | } are 0x7B to 0x7D
+        _mm_cmpgt_epi8(v, _mm_set1_epi8(0x7A)),
+        _mm_cmplt_epi8(v, _mm_set1_epi8(0x7E)));
+
+      m = _mm_or_si128(
+        m,
+        _mm_or_si128(_mm_or_si128(lt, gt),
+                     _mm_or_si128(_mm_or_si128(ct, bt), br)));
+    }
+
+    const int mask = _mm_movemask_epi8(m);
+    if (mask) {
+      return i + (size_t)__builtin_ctz((unsigned)mask);
+    }
+  }
+#endif
+
+  while (i < len && !sord_line_must_escape(ctx, str[i])) {
+    ++i;
+  }
+
+  return i;
+}
+
+/**
+   Return the code point of the UTF-8 character at the start of `str`.
+
+   @param size Set to the size of the character in bytes, or zero if it is
+   invalid.
+*/
+static uint32_t
+sord_line_parse_utf8(const uint8_t* const str,
+                     const size_t         len,
+                     size_t* const        size)
+{
+  const uint8_t lead = str[0];
+  uint32_t      c    = 0u;
+  if ((lead & 0xE0u) == 0xC0u) {
+    *size = 2u;
+    c     = lead & 0x1Fu;
+  } else if ((lead & 0xF0u) == 0xE0u) {
+    *size = 3u;
+    c     = lead & 0x0Fu;
+  } else if ((lead & 0xF8u) == 0xF0u) {
+    *size = 4u;
+    c     = lead & 0x07u;
+  } else {
+    *size = 0u;
+    return 0u;
+  }
+
+  if (*size > len) {
+    *size = 0u;
+    return 0u;
+  }
+
+  for (size_t i = 1u; i < *size; ++i) {
+    if ((str[i] & 0xC0u) != 0x80u) {
+      *size = 0u;
+      return 0u;
+    }
+
+    c = (c << 6u) | (str[i] & 0x3Fu);
+  }
+
+  return c;
+}
+
+/**
+   Write an escaped string, like the Serd writer in ASCII style.
+
+   Runs of characters that need no escaping are copied at once, so most
+   strings are written with a single scan and copy.
+*/
+static void
+sord_line_write_escaped(SordLineWriter* const writer,
+                        const SordLineContext ctx,
+                        const uint8_t* const  str,
+                        const size_t          len)
+{
+  for (size_t i = 0u; i < len;) {
+    const size_t n = sord_line_scan(ctx, str + i, len - i);
+    sord_line_write(writer, str + i, n);
+    if ((i += n) == len) {
+      break;
+    }
+
+    const uint8_t in = str[i];
+    if (ctx == SORD_LINE_STRING) {
+      const char* escape = NULL;
+      switch (in) {
+      case '\\':
+        escape = "\\\\";
+        break;
+      case '\n':
+        escape = "\\n";
+        break;
+      case '\r':
+        escape = "\\r";
+        break;
+      case '\t':
+        escape = "\\t";
+        break;
+      case '"':
+        escape = "\\\"";
+        break;
+      default:
+        break;
+      }
+
+      if (escape) {
+        sord_line_write(writer, escape, 2u);
+        ++i;
+        continue;
+      }
+    }
+
+    char   buf[SORD_LINE_MAX_ESCAPE + 1u];
+    size_t size = 1u;
+    if (in < 0x80u) {
+      snprintf(buf, sizeof(buf), "\\u%04X", (unsigned)in);
+      sord_line_write(writer, buf, 6u);
+    } else {
+      const uint32_t c = sord_line_parse_utf8(str + i, len - i, &size);
+      if (!size) {
+        // Invalid UTF-8, write a replacement and skip to the next character
+        sord_line_write(writer, "\\uFFFD", 6u);
+        for (size = 1u; i + size < len && (str[i + size] & 0xC0u) == 0x80u;
+             ++size) {
+        }
+      } else if (c <= 0xFFFFu) {
+        snprintf(buf, sizeof(buf), "\\u%04X", c);
+        sord_line_write(writer, buf, 6u);
+      } else {
+        snprintf(buf, sizeof(buf), "\\U%08X", c);
+        sord_line_write(writer, buf, 10u);
+      }
+    }
+
+    i += size;
+  }
+}
+
+static void
+sord_line_write_node(SordLineWriter* const writer, const SordNode* const node)
+{
+  const SerdNode* const snode = sord_node_to_serd_node(node);
+
+  switch (snode->type) {
+  case SERD_URI:
+    sord_line_write(writer, "<", 1u);
+    sord_line_write_escaped(writer, SORD_LINE_URI, snode->buf, snode->n_bytes);
+    sord_line_write(writer, ">", 1u);
+    break;
+
+  case SERD_BLANK:
+    sord_line_write(writer, "_:", 2u);
+    sord_line_write(writer, snode->buf, snode->n_bytes);
+    break;
+
+  case SERD_LITERAL: {
+    sord_line_write(writer, "\"", 1u);
+    sord_line_write_escaped(
+      writer, SORD_LINE_STRING, snode->buf, snode->n_bytes);
+    sord_line_write(writer, "\"", 1u);
+
+    const char* const     lang     = sord_node_get_language(node);
+    const SordNode* const datatype = sord_node_get_datatype(node);
+    if (lang) {
+      sord_line_write(writer, "@", 1u);
+      sord_line_write(writer, lang, strlen(lang));
+    } else if (datatype) {
+      sord_line_write(writer, "^^", 2u);
+      sord_line_write_node(writer, datatype);
+    }
+    break;
+  }
+
+  default:
+    break;
+  }
+}
+
+/**
+   Write lines for the quads from `iter` up to the first with subject `end`.
+
+   This frees `iter`, and stops at the end of the model if `end` is NULL.
+*/
+static void
+sord_line_write_range(SordLineWriter* const writer,
+                      SordIter* const       iter,
+                      const SerdSyntax      syntax,
+                      const SordNode* const end)
+{
+  for (; !writer->status && !sord_iter_end(iter); sord_iter_next(iter)) {
+    SordQuad tup;
+    sord_iter_get(iter, tup);
+    if (tup[SORD_SUBJECT] == end) {
+      break;
+    }
+
+    sord_line_write_node(writer, tup[SORD_SUBJECT]);
+    sord_line_write(writer, " ", 1u);
+    sord_line_write_node(writer, tup[SORD_PREDICATE]);
+    sord_line_write(writer, " ", 1u);
+    sord_line_write_node(writer, tup[SORD_OBJECT]);
+    if (syntax == SERD_NQUADS && tup[SORD_GRAPH]) {
+      sord_line_write(writer, " ", 1u);
+      sord_line_write_node(writer, tup[SORD_GRAPH]);
+    }
+    sord_line_write(writer, " .\n", 3u);
+  }
+
+  sord_iter_free(iter);
+}
+
+SerdStatus
+sord_write_lines(SordIter*  iter,
+                 SerdSyntax syntax,
+                 SerdSink   sink,
+                 void*      stream)
+{
+  if (!iter) {
+    return SERD_FAILURE;
+  }
+
+  if (syntax != SERD_NTRIPLES && syntax != SERD_NQUADS) {
+    sord_iter_free(iter);
+    return SERD_ERR_BAD_ARG;
+  }
+
+  SordLineWriter writer = {
+    sink, stream, (uint8_t*)malloc(SORD_LINE_BUF_SIZE), 0u, SERD_SUCCESS};
+
+  sord_line_write_range(&writer, iter, syntax, NULL);
+  sord_line_flush(&writer);
+  free(writer.buf);
+  return writer.status;
+}
+
+/** A range of the model to write, and its output once written */
+typedef struct {
+  SordIter*       iter;    ///< Start of range, or NULL once written
+  const SordNode* end;     ///< Subject that starts the next range, or NULL
+  uint8_t*        buf;     ///< Output
+  size_t          len;     ///< Length of output in bytes
+  size_t          size;    ///< Allocated size of buf in bytes
+  SerdStatus      status;  ///< Status of writing the range
+  bool            written; ///< True once buf is complete
+} SordExportChunk;
+
+/** Shared state for writing ranges in parallel */
+typedef struct {
+  SordModel*       model;     ///< Model to write
+  SerdEnv*         env;       ///< Environment with prefixes, or NULL for lines
+  SerdURI          base_uri;  ///< Base URI of env
+  SerdSyntax       syntax;    ///< Output syntax
+  SerdStyle        style;     ///< Output style
+  SordAnonPlan*    plan;      ///< Inline statements, built before writing
+  SordExportChunk* chunks;    ///< Ranges in model order
+  size_t           n_chunks;  ///< Number of ranges
+  size_t           max_ahead; ///< Maximum written chunks waiting for output
+  size_t           next;      ///< Index of the next chunk to write
+  size_t           n_output;  ///< Number of chunks passed to the sink
+#if USE_PTHREAD
+  pthread_mutex_t mutex; ///< Protects everything above
+  pthread_cond_t  cond;  ///< Signalled when a chunk is written or output
+#endif
+} SordExporter;
+
+/** The sink for output on the calling thread */
+typedef struct {
+  SerdSink sink;     ///< Sink for output
+  void*    stream;   ///< Stream for sink
+  size_t   n_bytes;  ///< Number of bytes passed to sink so far
+  bool     separate; ///< True if a blank line is due before more output
+} SordExportOutput;
+
+/// Append output to a chunk, compatible with SerdSink
+static size_t
+sord_export_chunk_sink(const void* buf, size_t len, void* stream)
+{
+  SordExportChunk* const chunk = (SordExportChunk*)stream;
+  if (chunk->len + len > chunk->size) {
+    chunk->size = (chunk->len + len) * 2u;
+    chunk->buf  = (uint8_t*)realloc(chunk->buf, chunk->size);
+  }
+
+  memcpy(chunk->buf + chunk->len, buf, len);
+  chunk->len += len;
+  return len;
+}
+
+/**
+   Pass output to the final sink, compatible with SerdSink.
+
+   Separate writers do not know what was written before them, so this writes
+   the blank line that a single writer would write between subjects.
+*/
+static size_t
+sord_export_output_sink(const void* buf, size_t len, void* stream)
+{
+  SordExportOutput* const out = (SordExportOutput*)stream;
+  if (!len) {
+    return 0u;
+  }
+
+  if (out->separate && out->n_bytes) {
+    if (out->sink("\n", 1u, out->stream) != 1u) {
+      return 0u;
+    }
+    ++out->n_bytes;
+  }
+
+  out->separate = false;
+
+  const size_t n = out->sink(buf, len, out->stream);
+  out->n_bytes += n;
+  return n;
+}
+
+/// Write the range from `iter` to the first quad with subject `end`
+static SerdStatus
+sord_export_range(const SordExporter* const exporter,
+                  SordIter* const           iter,
+                  const SordNode* const     end,
+                  const SerdSink            sink,
+                  void* const               stream)
+{
+  if (!exporter->env) {
+    SordLineWriter writer = {
+      sink, stream, (uint8_t*)malloc(SORD_LINE_BUF_SIZE), 0u, SERD_SUCCESS};
+
+    sord_line_write_range(&writer, iter, exporter->syntax, end);
+    sord_line_flush(&writer);
+    free(writer.buf);
+    return writer.status;
+  }
+
+  SerdWriter* const writer = serd_writer_new(exporter->syntax,
+                                             exporter->style,
+                                             exporter->env,
+                                             &exporter->base_uri,
+                                             sink,
+                                             stream);
+
+  SordStatementWriter w = {exporter->model, writer, exporter->plan, NULL, 0u};
+
+  SerdStatus st = SERD_SUCCESS;
+  for (; !st && !sord_iter_end(iter); sord_iter_next(iter)) {
+    SordQuad tup;
+    sord_iter_get(iter, tup);
+    if (tup[SORD_SUBJECT] == end) {
+      break;
+    }
+
+    st = write_statement(&w, tup);
+  }
+
+  const SerdStatus fst = serd_writer_finish(writer);
+  serd_writer_free(writer);
+  sord_iter_free(iter);
+  free(w.stack);
+  return st ? st : fst;
+}
+
+static void
+sord_export_chunk(const SordExporter* const exporter,
+                  SordExportChunk* const    chunk)
+{
+  chunk->status = sord_export_range(
+    exporter, chunk->iter, chunk->end, sord_export_chunk_sink, chunk);
+  chunk->iter = NULL;
+}
+
+#if USE_PTHREAD
+
+static void*
+sord_export_work(void* data)
+{
+  SordExporter* const exporter = (SordExporter*)data;
+
+  pthread_mutex_lock(&exporter->mutex);
+  while (exporter->next < exporter->n_chunks) {
+    if (exporter->next >= exporter->n_output + exporter->max_ahead) {
+      // Too far ahead of output, wait to avoid buffering the whole model
+      pthread_cond_wait(&exporter->cond, &exporter->mutex);
+      continue;
+    }
+
+    SordExportChunk* const chunk = &exporter->chunks[exporter->next++];
+    pthread_mutex_unlock(&exporter->mutex);
+
+    sord_export_chunk(exporter, chunk);
+
+    pthread_mutex_lock(&exporter->mutex);
+    chunk->written = true;
+    pthread_cond_broadcast(&exporter->cond);
+  }
+  pthread_mutex_unlock(&exporter->mutex);
+
+  return NULL;
+}
+
+#endif
+
+/**
+   Write every chunk on up to `n_threads` threads, and output them in order.
+
+   If output fails, the remaining chunks are skipped.
+*/
+static SerdStatus
+sord_export_chunks(SordExporter* const     exporter,
+                   SordExportOutput* const out,
+                   const unsigned          n_threads)
+{
+  unsigned n_workers = 0u;
+
+#if USE_PTHREAD
+  pthread_t* const workers = (pthread_t*)calloc(n_threads, sizeof(pthread_t));
+
+  pthread_mutex_init(&exporter->mutex, NULL);
+  pthread_cond_init(&exporter->cond, NULL);
+  for (unsigned i = 0u; i < n_threads && i < exporter->n_chunks; ++i) {
+    if (!pthread_create(
+          &workers[n_workers], NULL, sord_export_work, exporter)) {
+      ++n_workers;
+    }
+  }
+#else
+  (void)n_threads;
+#endif
+
+  SerdStatus st = SERD_SUCCESS;
+  for (size_t i = 0u; !st && i < exporter->n_chunks; ++i) {
+    SordExportChunk* const chunk = &exporter->chunks[i];
+
+#if USE_PTHREAD
+    pthread_mutex_lock(&exporter->mutex);
+    while (n_workers && !chunk->written) {
+      pthread_cond_wait(&exporter->cond, &exporter->mutex);
+    }
+    pthread_mutex_unlock(&exporter->mutex);
+#endif
+
+    if (!n_workers) {
+      sord_export_chunk(exporter, chunk); // No threads available, write here
+    }
+
+    out->separate = exporter->env != NULL;
+    if (chunk->len && sord_export_output_sink(chunk->buf, chunk->len, out) !=
+                        chunk->len) {
+      st = SERD_ERR_UNKNOWN;
+    } else if (chunk->status > SERD_FAILURE) {
+      st = chunk->status;
+    }
+
+    free(chunk->buf);
+    chunk->buf = NULL;
+
+#if USE_PTHREAD
+    pthread_mutex_lock(&exporter->mutex);
+    ++exporter->n_output;
+    if (st) {
+      exporter->next = exporter->n_chunks; // Stop workers taking more chunks
+    }
+    pthread_cond_broadcast(&exporter->cond);
+    pthread_mutex_unlock(&exporter->mutex);
+#else
+    ++exporter->n_output;
+#endif
+  }
+
+#if USE_PTHREAD
+  for (unsigned i = 0u; i < n_workers; ++i) {
+    pthread_join(workers[i], NULL);
+  }
+
+  pthread_cond_destroy(&exporter->cond);
+  pthread_mutex_destroy(&exporter->mutex);
+  free(workers);
+#endif
+
+  // Free anything left after an error
+  for (size_t i = 0u; i < exporter->n_chunks; ++i) {
+    sord_iter_free(exporter->chunks[i].iter);
+    free(exporter->chunks[i].buf);
+  }
+
+  return st;
+}
+
+SerdStatus
+sord_write_parallel(SordModel* model,
+                    SerdEnv*   env,
+                    SerdSyntax syntax,
+                    SerdStyle  style,
+                    unsigned   n_threads,
+                    SerdSink   sink,
+                    void*      stream)
+{
+  const bool lines = syntax == SERD_NTRIPLES || syntax == SERD_NQUADS;
+  if (!n_threads) {
+    n_threads = sord_default_n_threads();
+  }
+
+  SordExportOutput out = {sink, stream, 0u, false};
+  SordExporter     exporter;
+  memset(&exporter, 0, sizeof(exporter));
+  exporter.model     = model;
+  exporter.base_uri  = SERD_URI_NULL;
+  exporter.syntax    = syntax;
+  exporter.style     = style;
+  exporter.max_ahead = 2u * n_threads;
+
+  SordAnonPlan plan = {NULL, 0u, NULL};
+  SerdNode     base = SERD_NODE_NULL;
+  if (!lines) {
+    // Collect inline statements first, so writers can share them
+    sord_anon_plan_build(&plan, model);
+    exporter.plan = &plan;
+
+    // Write prefixes, and keep them in an environment shared by all writers
+    base = serd_node_copy(serd_env_get_base_uri(env, &exporter.base_uri));
+
+    exporter.env = serd_env_new(&base);
+    serd_env_get_base_uri(exporter.env, &exporter.base_uri);
+
+    SerdWriter* const writer = serd_writer_new(syntax,
+                                               style,
+                                               exporter.env,
+                                               &exporter.base_uri,
+                                               sord_export_output_sink,
+                                               &out);
+
+    serd_env_foreach(env, (SerdPrefixSink)serd_writer_set_prefix, writer);
+    serd_writer_finish(writer);
+    serd_writer_free(writer);
+  }
+
+  // Split into many more chunks than threads, to balance the load
+  size_t n_chunks = n_threads;
+  if (n_threads > 1u && sord_num_quads(model) / SORD_EXPORT_CHUNK_QUADS >
+                          n_chunks) {
+    n_chunks = sord_num_quads(model) / SORD_EXPORT_CHUNK_QUADS;
+  }
+
+  SordIter** const iters = (SordIter**)malloc(n_chunks * sizeof(SordIter*));
+
+  exporter.n_chunks = sord_split(model, n_chunks, iters);
+  exporter.chunks =
+    (SordExportChunk*)calloc(exporter.n_chunks, sizeof(SordExportChunk));
+
+  for (size_t i = 0u; i < exporter.n_chunks; ++i) {
+    exporter.chunks[i].iter = iters[i];
+    exporter.chunks[i].end =
+      (i + 1u < exporter.n_chunks)
+        ? sord_iter_get_node(iters[i + 1u], SORD_SUBJECT)
+        : NULL;
+  }
+
+  SerdStatus st = SERD_SUCCESS;
+  if (n_threads > 1u) {
+    st = sord_export_chunks(&exporter, &out, n_threads);
+  } else if (exporter.n_chunks) {
+    // Write directly to the sink on this thread
+    out.separate = exporter.env != NULL;
+    st           = sord_export_range(
+      &exporter, iters[0], NULL, sord_export_output_sink, &out);
+  }
+
+  free(exporter.chunks);
+  free(iters);
+  sord_anon_plan_clear(&plan);
+  serd_env_free(exporter.env);
+  serd_node_free(&base);
+  return st;
+}
@@ -208,6 +208,29 @@ zix_btree_max_vals(const ZixBTreeNode* const node)
   return node->is_leaf ? ZIX_BTREE_LEAF_VALS : ZIX_BTREE_INODE_VALS;
 }
 
+static void
+zix_btree_stats_rec(const ZixBTreeNode* const n, ZixBTreeStats* const stats)
+{
+  ++stats->n_pages;
+  stats->n_slots += zix_btree_max_vals(n);
+  if (!n->is_leaf) {
+    for (uint16_t i = 0; i < n->n_vals + 1u; ++i) {
+      zix_btree_stats_rec(zix_btree_child(n, i), stats);
+    }
+  }
+}
+
+ZixBTreeStats
+zix_btree_stats(const ZixBTree* const t)
+{
+  ZixBTreeStats stats = {0u, ZIX_BTREE_PAGE_SIZE, 0u};
+  if (t->root) {
+    zix_btree_stats_rec(t->root, &stats);
+  }
+
+  return stats;
+}
+
 static uint16_t
 zix_btree_min_vals(const ZixBTreeNode* const node)
 {
@@ -806,6 +829,72 @@ zix_btree_lower_bound(const ZixBTree* const t,
   return ZIX_STATUS_SUCCESS;
 }
 
+/// Return the number of values in the nodes `depth` levels below `n`
+static size_t
+zix_btree_count_level(const ZixBTreeNode* const n, const unsigned depth)
+{
+  if (!depth) {
+    return n->n_vals;
+  }
+
+  size_t count = 0u;
+  for (unsigned i = 0u; i <= n->n_vals; ++i) {
+    count += zix_btree_count_level(zix_btree_child(n, i), depth - 1u);
+  }
+
+  return count;
+}
+
+/// State for collecting evenly spaced values from one level of the tree
+typedef struct {
+  size_t count; ///< Total number of values on the level
+  size_t n;     ///< Number of values to collect
+  size_t index; ///< Index of the next value on the level
+  size_t n_out; ///< Number of values collected so far
+  void** vals;  ///< Collected values
+} ZixBTreeSample;
+
+static void
+zix_btree_sample_level(const ZixBTreeNode* const n,
+                       const unsigned            depth,
+                       ZixBTreeSample* const     sample)
+{
+  if (depth) {
+    for (unsigned i = 0u; i <= n->n_vals && sample->n_out < sample->n; ++i) {
+      zix_btree_sample_level(zix_btree_child(n, i), depth - 1u, sample);
+    }
+    return;
+  }
+
+  for (unsigned i = 0u; i < n->n_vals && sample->n_out < sample->n; ++i) {
+    // Take the value at each multiple of count / (n + 1) on the level
+    const size_t target =
+      (sample->n_out + 1u) * sample->count / (sample->n + 1u);
+    if (sample->index++ == target) {
+      sample->vals[sample->n_out++] = zix_btree_value(n, i);
+    }
+  }
+}
+
+size_t
+zix_btree_sample(const ZixBTree* const t, const size_t n, void** const vals)
+{
+  if (!t->root || !n) {
+    return 0u;
+  }
+
+  // Find the highest level with enough values, which is cheap to scan
+  unsigned depth = 0u;
+  size_t   count = t->root->n_vals;
+  while (count <= n && depth + 1u < t->height) {
+    count = zix_btree_count_level(t->root, ++depth);
+  }
+
+  ZixBTreeSample sample = {count, n < count ? n : count, 0u, 0u, vals};
+  zix_btree_sample_level(t->root, depth, &sample);
+  return sample.n_out;
+}
+
 void*
 zix_btree_get(const ZixBTreeIter* const ti)
 {
@@ -51,6 +51,15 @@ typedef struct ZixBTreeNodeImpl ZixBTreeNode;
 */
 typedef struct ZixBTreeIterImpl ZixBTreeIter;
 
+/**
+   Statistics about the pages of a B-Tree.
+*/
+typedef struct {
+  size_t n_pages;   ///< Number of pages, including internal ones
+  size_t page_size; ///< Size of each page in bytes
+  size_t n_slots;   ///< Number of elements that fit in every page
+} ZixBTreeStats;
+
 /**
    Create a new (empty) B-Tree.
 */
@@ -72,6 +81,15 @@ ZIX_PURE_API
 size_t
 zix_btree_size(const ZixBTree* t);
 
+/**
+   Return statistics about the pages of `t`.
+
+   This visits every page, so takes time linear in the size of `t`.
+*/
+ZIX_API
+ZixBTreeStats
+zix_btree_stats(const ZixBTree* t);
+
 /**
    Insert the element `e` into `t`.
 */
@@ -122,6 +140,19 @@ ZIX_PURE_API
 void*
 zix_btree_get(const ZixBTreeIter* ti);
 
+/**
+   Sample values that divide `t` into ranges of roughly equal size.
+
+   This sets `vals` to at most `n` distinct values from `t` in order, taken
+   from the highest level of the tree that has enough of them, so the cost
+   depends on `n` rather than the size of `t`.
+
+   @return The number of values written to `vals`.
+*/
+ZIX_API
+size_t
+zix_btree_sample(const ZixBTree* t, size_t n, void** vals);
+
 /**
    Return an iterator to the first (smallest) element in `t`.
 
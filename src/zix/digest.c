@@ -16,126 +16,207 @@
 
 #include "zix/digest.h"
 
-#ifdef __SSE4_2__
-#  include <smmintrin.h>
+#if defined(__SSE4_2__)
+#  define ZIX_DIGEST_CRC32C 1
+#  define ZIX_DIGEST_DISPATCH 0
+#  define ZIX_DIGEST_TARGET
+#elif (defined(__x86_64__) || defined(__i386__)) &&  \
+  (defined(__clang__) ||                             \
+   (defined(__GNUC__) &&                             \
+    (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))))
+#  define ZIX_DIGEST_CRC32C 1
+#  define ZIX_DIGEST_DISPATCH 1
+#  define ZIX_DIGEST_TARGET __attribute__((target("sse4.2")))
+#else
+#  define ZIX_DIGEST_CRC32C 0
+#  define ZIX_DIGEST_DISPATCH 0
+#endif
+
+#if ZIX_DIGEST_CRC32C
+#  include <nmmintrin.h>
 #endif
 
 #include <assert.h>
 #include <stdint.h>
+#include <string.h>
 
-#ifdef __SSE4_2__
+/// Odd 64-bit multiplier (from fasthash)
+#define ZIX_DIGEST_M 0x880355F21E6D1965ull
 
-// SSE 4.2 CRC32
+typedef uint64_t (*ZixDigestFunc)(uint64_t hash, const void* buf, size_t len);
 
-uint32_t
-zix_digest_start(void)
+static inline uint64_t
+zix_digest_load(const uint8_t* const ptr)
 {
-  return 1;
+  uint64_t word = 0u;
+  memcpy(&word, ptr, sizeof(word));
+  return word;
 }
 
-uint32_t
-zix_digest_add(uint32_t hash, const void* const buf, const size_t len)
+// Portable multiply-based hash (fasthash), one 64-bit word at a time
+
+static inline uint64_t
+zix_digest_mix(uint64_t h)
 {
-  const uint8_t* str = (const uint8_t*)buf;
+  h ^= h >> 23u;
+  h *= 0x2127599BF4325C37ull;
+  h ^= h >> 47u;
+  return h;
+}
 
-#  ifdef __x86_64__
-  for (size_t i = 0; i < (len / sizeof(uint64_t)); ++i) {
-    hash = (uint32_t)_mm_crc32_u64(hash, *(const uint64_t*)str);
+static uint64_t
+zix_digest_add_mul(const uint64_t hash, const void* const buf, const size_t len)
+{
+  const uint8_t* str     = (const uint8_t*)buf;
+  const size_t   n_words = len / sizeof(uint64_t);
+
+  uint64_t h = hash ^ ((uint64_t)len * ZIX_DIGEST_M);
+  for (size_t i = 0u; i < n_words; ++i) {
+    h ^= zix_digest_mix(zix_digest_load(str));
+    h *= ZIX_DIGEST_M;
     str += sizeof(uint64_t);
   }
-  if (len & sizeof(uint32_t)) {
-    hash = _mm_crc32_u32(hash, *(const uint32_t*)str);
-    str += sizeof(uint32_t);
+
+  if (len % sizeof(uint64_t)) {
+    uint64_t tail = 0u;
+    memcpy(&tail, str, len % sizeof(uint64_t));
+    h ^= zix_digest_mix(tail);
+    h *= ZIX_DIGEST_M;
   }
+
+  return zix_digest_mix(h);
+}
+
+#if ZIX_DIGEST_CRC32C
+
+/*
+  SSE 4.2 CRC32C, in two 32-bit lanes.
+
+  The high lane hashes each word multiplied by an odd constant, which is a
+  bijection that is not linear over GF(2), so the lanes are independent and
+  together make a full 64-bit hash at about the speed of a single CRC.
+*/
+
+ZIX_DIGEST_TARGET
+static inline uint32_t
+zix_digest_crc_word(const uint32_t crc, const uint64_t word)
+{
+#  ifdef __x86_64__
+  return (uint32_t)_mm_crc32_u64(crc, word);
 #  else
-  for (size_t i = 0; i < (len / sizeof(uint32_t)); ++i) {
-    hash = _mm_crc32_u32(hash, *(const uint32_t*)str);
-    str += sizeof(uint32_t);
-  }
+  return _mm_crc32_u32(_mm_crc32_u32(crc, (uint32_t)word),
+                       (uint32_t)(word >> 32u));
 #  endif
-  if (len & sizeof(uint16_t)) {
-    hash = _mm_crc32_u16(hash, *(const uint16_t*)str);
-    str += sizeof(uint16_t);
-  }
-  if (len & sizeof(uint8_t)) {
-    hash = _mm_crc32_u8(hash, *(const uint8_t*)str);
+}
+
+ZIX_DIGEST_TARGET
+static uint64_t
+zix_digest_add_crc32c(const uint64_t  hash,
+                      const void* const buf,
+                      const size_t      len)
+{
+  const uint8_t* str     = (const uint8_t*)buf;
+  const size_t   n_words = len / sizeof(uint64_t);
+
+  uint32_t lo = (uint32_t)hash;
+  uint32_t hi = (uint32_t)(hash >> 32u);
+  for (size_t i = 0u; i < n_words; ++i) {
+    const uint64_t word = zix_digest_load(str);
+    lo                  = zix_digest_crc_word(lo, word);
+    hi                  = zix_digest_crc_word(hi, word * ZIX_DIGEST_M);
+    str += sizeof(uint64_t);
   }
 
-  return hash;
+  // Finish with the remaining bytes, and the length in the top byte
+  uint64_t tail = 0u;
+  memcpy(&tail, str, len % sizeof(uint64_t));
+  tail ^= (uint64_t)len << 56u;
+  lo = zix_digest_crc_word(lo, tail);
+  hi = zix_digest_crc_word(hi, tail * ZIX_DIGEST_M);
+
+  return ((uint64_t)hi << 32u) | lo;
 }
 
-uint32_t
-zix_digest_add_64(uint32_t hash, const void* const buf, const size_t len)
-{
-  assert((uintptr_t)buf % sizeof(uint64_t) == 0);
-  assert(len % sizeof(uint64_t) == 0);
+#endif
 
-#  ifdef __x86_64__
-  const uint64_t* ptr = (const uint64_t*)buf;
+#if ZIX_DIGEST_DISPATCH
 
-  for (size_t i = 0; i < (len / sizeof(uint64_t)); ++i) {
-    hash = (uint32_t)_mm_crc32_u64(hash, *ptr);
-    ++ptr;
-  }
+/*
+  Runtime CPU dispatch.  This uses a function pointer which is resolved on
+  first use rather than an ifunc, since the latter is specific to ELF and
+  does not work in static programs.  Digests may be calculated on several
+  threads, so the pointer is only accessed atomically.  Resolution is
+  idempotent, so two threads resolving it at once is harmless.
+*/
 
-  return hash;
-#  else
-  const uint32_t* ptr = (const uint32_t*)buf;
+static uint64_t
+zix_digest_add_resolve(uint64_t hash, const void* buf, size_t len);
 
-  for (size_t i = 0; i < (len / sizeof(uint32_t)); ++i) {
-    hash = _mm_crc32_u32(hash, *ptr);
-    ++ptr;
-  }
+static ZixDigestFunc zix_digest_add_impl = zix_digest_add_resolve;
 
-  return hash;
-#  endif
+static ZixDigestFunc
+zix_digest_select(void)
+{
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("sse4.2") ? zix_digest_add_crc32c
+                                          : zix_digest_add_mul;
 }
 
-uint32_t
-zix_digest_add_ptr(const uint32_t hash, const void* const ptr)
+static uint64_t
+zix_digest_add_resolve(const uint64_t    hash,
+                       const void* const buf,
+                       const size_t      len)
 {
-#  ifdef __x86_64__
-  return (uint32_t)_mm_crc32_u64(hash, (uintptr_t)ptr);
-#  else
-  return _mm_crc32_u32(hash, (uintptr_t)ptr);
-#  endif
+  const ZixDigestFunc impl = zix_digest_select();
+
+  __atomic_store_n(&zix_digest_add_impl, impl, __ATOMIC_RELEASE);
+  return impl(hash, buf, len);
 }
 
-#else
+static inline uint64_t
+zix_digest_add_dispatch(const uint64_t    hash,
+                        const void* const buf,
+                        const size_t      len)
+{
+  const ZixDigestFunc impl =
+    __atomic_load_n(&zix_digest_add_impl, __ATOMIC_ACQUIRE);
 
-// Classic DJB hash
+  return impl(hash, buf, len);
+}
+
+#  define ZIX_DIGEST_ADD zix_digest_add_dispatch
+
+#elif ZIX_DIGEST_CRC32C
+#  define ZIX_DIGEST_ADD zix_digest_add_crc32c
+#else
+#  define ZIX_DIGEST_ADD zix_digest_add_mul
+#endif
 
-uint32_t
+uint64_t
 zix_digest_start(void)
 {
-  return 5381;
+  return 0u;
 }
 
-uint32_t
-zix_digest_add(uint32_t hash, const void* const buf, const size_t len)
+uint64_t
+zix_digest_add(const uint64_t hash, const void* const buf, const size_t len)
 {
-  const uint8_t* str = (const uint8_t*)buf;
-
-  for (size_t i = 0; i < len; ++i) {
-    hash = (hash << 5u) + hash + str[i];
-  }
-
-  return hash;
+  return ZIX_DIGEST_ADD(hash, buf, len);
 }
 
-uint32_t
-zix_digest_add_64(uint32_t hash, const void* const buf, const size_t len)
+uint64_t
+zix_digest_add_64(const uint64_t hash, const void* const buf, const size_t len)
 {
   assert((uintptr_t)buf % sizeof(uint64_t) == 0);
   assert(len % sizeof(uint64_t) == 0);
 
-  return zix_digest_add(hash, buf, len);
+  return ZIX_DIGEST_ADD(hash, buf, len);
 }
 
-uint32_t
-zix_digest_add_ptr(const uint32_t hash, const void* const ptr)
+uint64_t
+zix_digest_add_ptr(const uint64_t hash, const void* const ptr)
 {
-  return zix_digest_add(hash, &ptr, sizeof(ptr));
-}
+  const uintptr_t value = (uintptr_t)ptr;
 
-#endif
+  return ZIX_DIGEST_ADD(hash, &value, sizeof(value));
+}
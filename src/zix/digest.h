@@ -30,35 +30,40 @@ extern "C" {
    Return an initial empty digest value.
 */
 ZIX_CONST_API
-uint32_t
+uint64_t
 zix_digest_start(void);
 
 /**
    Update `hash` to include `buf`, a buffer of `len` bytes.
 
-   This can be used for any size or alignment.
+   This can be used for any size or alignment.  The implementation is chosen
+   at runtime based on the features of the CPU, so digests are only stable
+   within a single process and must not be stored.  This is not a pure
+   function, since the implementation is resolved on the first call.
 */
-ZIX_PURE_API
-uint32_t
-zix_digest_add(uint32_t hash, const void* buf, size_t len);
+ZIX_API
+uint64_t
+zix_digest_add(uint64_t hash, const void* buf, size_t len);
 
 /**
    Update `hash` to include `buf`, a 64-bit aligned buffer of `len` bytes.
 
    Both `buf` and `len` must be evenly divisible by 8 (64 bits).
 */
-ZIX_PURE_API
-uint32_t
-zix_digest_add_64(uint32_t hash, const void* buf, size_t len);
+ZIX_API
+uint64_t
+zix_digest_add_64(uint64_t hash, const void* buf, size_t len);
 
 /**
    Update `hash` to include `ptr`.
 
    This hashes the value of the pointer itself, and does not dereference `ptr`.
+   This is not a pure function, since the implementation is resolved on the
+   first call.
 */
-ZIX_CONST_API
-uint32_t
-zix_digest_add_ptr(uint32_t hash, const void* ptr);
+ZIX_API
+uint64_t
+zix_digest_add_ptr(uint64_t hash, const void* ptr);
 
 #ifdef __cplusplus
 } /* extern "C" */
@@ -20,6 +20,12 @@
 #include <stdlib.h>
 #include <string.h>
 
+#if defined(__GNUC__) || defined(__clang__)
+#  define ZIX_PREFETCH(ptr) __builtin_prefetch(ptr)
+#else
+#  define ZIX_PREFETCH(ptr)
+#endif
+
 /**
    Primes, each slightly less than twice its predecessor, and as far away
    from powers of two as possible.
@@ -32,7 +38,7 @@ static const unsigned sizes[] = {
 
 typedef struct ZixHashEntry {
   struct ZixHashEntry* next; ///< Next entry in bucket
-  uint32_t             hash; ///< Non-modulo hash value
+  ZixHashCode          hash; ///< Non-modulo hash value
                              // Value follows here (access with zix_hash_value)
 } ZixHashEntry;
 
@@ -96,6 +102,13 @@ zix_hash_size(const ZixHash* hash)
   return hash->count;
 }
 
+size_t
+zix_hash_num_bytes(const ZixHash* hash)
+{
+  return sizeof(ZixHash) + *hash->n_buckets * sizeof(ZixHashEntry*) +
+         hash->count * (sizeof(ZixHashEntry) + hash->value_size);
+}
+
 static inline void
 insert_entry(ZixHashEntry** bucket, ZixHashEntry* entry)
 {
@@ -116,7 +129,7 @@ rehash(ZixHash* hash, unsigned new_n_buckets)
   for (unsigned b = 0; b < old_n_buckets; ++b) {
     for (ZixHashEntry* e = hash->buckets[b]; e;) {
       ZixHashEntry* const next = e->next;
-      const unsigned      h    = e->hash % new_n_buckets;
+      const unsigned      h    = (unsigned)(e->hash % new_n_buckets);
       insert_entry(&new_buckets[h], e);
       e = next;
     }
@@ -129,10 +142,10 @@ rehash(ZixHash* hash, unsigned new_n_buckets)
 }
 
 static inline ZixHashEntry*
-find_entry(const ZixHash* hash,
-           const void*    key,
-           const unsigned h,
-           const unsigned h_nomod)
+find_entry(const ZixHash*    hash,
+           const void*       key,
+           const unsigned    h,
+           const ZixHashCode h_nomod)
 {
   for (ZixHashEntry* e = hash->buckets[h]; e; e = e->next) {
     if (e->hash == h_nomod && hash->equal_func(zix_hash_value(e), key)) {
@@ -145,17 +158,52 @@ find_entry(const ZixHash* hash,
 void*
 zix_hash_find(const ZixHash* hash, const void* value)
 {
-  const unsigned      h_nomod = hash->hash_func(value);
-  const unsigned      h       = h_nomod % *hash->n_buckets;
-  ZixHashEntry* const entry   = find_entry(hash, value, h, h_nomod);
+  return zix_hash_find_prehashed(hash, value, hash->hash_func(value));
+}
+
+void*
+zix_hash_find_prehashed(const ZixHash*    hash,
+                        const void*       value,
+                        const ZixHashCode code)
+{
+  assert(code == hash->hash_func(value));
+
+  const unsigned      h     = (unsigned)(code % *hash->n_buckets);
+  ZixHashEntry* const entry = find_entry(hash, value, h, code);
   return entry ? zix_hash_value(entry) : 0;
 }
 
+void
+zix_hash_prefetch(const ZixHash* hash, const ZixHashCode code)
+{
+  ZIX_PREFETCH(&hash->buckets[code % *hash->n_buckets]);
+}
+
+void
+zix_hash_prefetch_entry(const ZixHash* hash, const ZixHashCode code)
+{
+  const ZixHashEntry* const head = hash->buckets[code % *hash->n_buckets];
+  if (head) {
+    ZIX_PREFETCH(head);
+  }
+}
+
 ZixStatus
 zix_hash_insert(ZixHash* hash, const void* value, void** inserted)
 {
-  unsigned h_nomod = hash->hash_func(value);
-  unsigned h       = h_nomod % *hash->n_buckets;
+  return zix_hash_insert_prehashed(
+    hash, value, hash->hash_func(value), inserted);
+}
+
+ZixStatus
+zix_hash_insert_prehashed(ZixHash* const    hash,
+                          const void* const value,
+                          const ZixHashCode h_nomod,
+                          void** const      inserted)
+{
+  assert(h_nomod == hash->hash_func(value));
+
+  unsigned h = (unsigned)(h_nomod % *hash->n_buckets);
 
   ZixHashEntry* elem = find_entry(hash, value, h, h_nomod);
   if (elem) {
@@ -177,7 +225,7 @@ zix_hash_insert(ZixHash* hash, const void* value, void** inserted)
   const unsigned next_n_buckets = *(hash->n_buckets + 1);
   if (next_n_buckets != 0 && (hash->count + 1) >= next_n_buckets) {
     if (!rehash(hash, next_n_buckets)) {
-      h = h_nomod % *(++hash->n_buckets);
+      h = (unsigned)(h_nomod % *(++hash->n_buckets));
     }
   }
 
@@ -192,29 +240,30 @@ zix_hash_insert(ZixHash* hash, const void* value, void** inserted)
 ZixStatus
 zix_hash_remove(ZixHash* hash, const void* value)
 {
-  const unsigned h_nomod = hash->hash_func(value);
-  const unsigned h       = h_nomod % *hash->n_buckets;
+  const ZixHashCode h_nomod = hash->hash_func(value);
+  const unsigned    h       = (unsigned)(h_nomod % *hash->n_buckets);
 
   ZixHashEntry** next_ptr = &hash->buckets[h];
   for (ZixHashEntry* e = hash->buckets[h]; e; e = e->next) {
     if (h_nomod == e->hash && hash->equal_func(zix_hash_value(e), value)) {
       *next_ptr = e->next;
       free(e);
-      return ZIX_STATUS_SUCCESS;
-    }
-    next_ptr = &e->next;
-  }
 
-  if (hash->n_buckets != sizes) {
-    const unsigned prev_n_buckets = *(hash->n_buckets - 1);
-    if (hash->count - 1 <= prev_n_buckets) {
-      if (!rehash(hash, prev_n_buckets)) {
-        --hash->n_buckets;
+      if (hash->n_buckets != sizes) {
+        const unsigned prev_n_buckets = *(hash->n_buckets - 1);
+        if (hash->count - 1 <= prev_n_buckets) {
+          if (!rehash(hash, prev_n_buckets)) {
+            --hash->n_buckets;
+          }
+        }
       }
+
+      --hash->count;
+      return ZIX_STATUS_SUCCESS;
     }
+    next_ptr = &e->next;
   }
 
-  --hash->count;
   return ZIX_STATUS_NOT_FOUND;
 }
 
@@ -35,10 +35,15 @@ extern "C" {
 
 typedef struct ZixHashImpl ZixHash;
 
+/**
+   A full hash code for a value, used to find its bucket.
+*/
+typedef uint64_t ZixHashCode;
+
 /**
    Function for computing the hash of an element.
 */
-typedef uint32_t (*ZixHashFunc)(const void* value);
+typedef ZixHashCode (*ZixHashFunc)(const void* value);
 
 /**
    Function to visit a hash element.
@@ -76,6 +81,15 @@ ZIX_PURE_API
 size_t
 zix_hash_size(const ZixHash* hash);
 
+/**
+   Return the number of bytes allocated for `hash` and its entries.
+
+   This does not include any memory that values point to.
+*/
+ZIX_PURE_API
+size_t
+zix_hash_num_bytes(const ZixHash* hash);
+
 /**
    Insert an item into `hash`.
 
@@ -94,6 +108,20 @@ ZIX_API
 ZixStatus
 zix_hash_insert(ZixHash* hash, const void* value, void** inserted);
 
+/**
+   Insert an item into `hash` with a precomputed hash code.
+
+   This is the same as zix_hash_insert(), except `code` must be the result of
+   the hash function of `hash` called on `value`.  This allows callers to hash
+   many values up front, to prefetch their buckets, and so on.
+*/
+ZIX_API
+ZixStatus
+zix_hash_insert_prehashed(ZixHash*    hash,
+                          const void* value,
+                          ZixHashCode code,
+                          void**      inserted);
+
 /**
    Remove an item from `hash`.
 
@@ -115,6 +143,39 @@ ZIX_API
 void*
 zix_hash_find(const ZixHash* hash, const void* value);
 
+/**
+   Search for an item in `hash` with a precomputed hash code.
+
+   @see zix_hash_insert_prehashed()
+*/
+ZIX_API
+void*
+zix_hash_find_prehashed(const ZixHash* hash,
+                        const void*    value,
+                        ZixHashCode    code);
+
+/**
+   Prefetch the bucket for the hash code `code`.
+
+   This is a hint that an item with this hash code will soon be searched for
+   or inserted, which has no effect other than pulling memory into the cache.
+   To prefetch the whole path to an item, call this for several items, then
+   zix_hash_prefetch_entry() for each, then search for them.
+*/
+ZIX_API
+void
+zix_hash_prefetch(const ZixHash* hash, ZixHashCode code);
+
+/**
+   Prefetch the first entry in the bucket for the hash code `code`.
+
+   This reads the bucket, so should be called some time after
+   zix_hash_prefetch() with the same code.
+*/
+ZIX_API
+void
+zix_hash_prefetch_entry(const ZixHash* hash, ZixHashCode code);
+
 /**
    Call `f` on each value in `hash`.
 